@@ -0,0 +1,134 @@
+#pragma once
+#include "RefPtr.h"
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+
+//߳̽reactorɶ:߳ѹ,ֻreactorȡ,
+//ڵǶ(TҪT* completionNextԱ),ѹʱеԭƽ
+//reactorÿ¼ѭȡһ,ֻepoll_waitʱ,ɿձΪǿյǴѹдeventfd
+template<class T>
+class CompletionQueue
+{
+public:
+	CompletionQueue() : head_(nullptr), waiting_(false), completed_(0), batches_(0), signals_(0)
+	{
+		fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (fd_ == -1)perror("eventfd");
+	}
+	~CompletionQueue()
+	{
+		//˳ʱûбreactorȡߵĶ
+		T* p = head_.exchange(nullptr, std::memory_order_acquire);
+		while (p != nullptr)
+		{
+			T* next = p->completionNext;
+			RefPtr<T>::adopt(p);
+			p = next;
+		}
+		if (fd_ != -1)::close(fd_);
+	}
+
+	CompletionQueue(const CompletionQueue&) = delete;
+	CompletionQueue& operator=(const CompletionQueue&) = delete;
+
+	//עᵽreactorepoll,ɶʾɵĶ
+	int fd() const { return fd_; }
+
+	//̵߳
+	void push(RefPtr<T> obj)
+	{
+		T* p = obj.detach();
+		T* old = head_.load(std::memory_order_relaxed);
+		do
+		{
+			p->completionNext = old;
+		} while (!head_.compare_exchange_weak(old, p, std::memory_order_release, std::memory_order_relaxed));
+
+		//֮ǰΪʱ,ѵǰΪǿյǸ߳
+		//prepareWait:Ҫô￴reactor׼ȴ,ҪôreactorڵȴǰΪ
+		if (old == nullptr && waiting_.load(std::memory_order_seq_cst))
+		{
+			uint64_t one = 1;
+			ssize_t n = write(fd_, &one, sizeof(one));
+			(void)n;
+			signals_.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	//reactor(WebSocketỰȴע),eventfdļreactorȡ,ᶪʧ
+	void signal()
+	{
+		uint64_t one = 1;
+		ssize_t n = write(fd_, &one, sizeof(one));
+		(void)n;
+		signals_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	//reactorepoll_wait֮ǰ,falseʾѾɵĶ,һֲӦ
+	bool prepareWait()
+	{
+		waiting_.store(true, std::memory_order_seq_cst);
+		return head_.load(std::memory_order_seq_cst) == nullptr;
+	}
+	//epoll_waitغ,֮ѹ벻дeventfd
+	void finishWait()
+	{
+		waiting_.store(false, std::memory_order_relaxed);
+	}
+	//epollfdɶʱ
+	void clearSignal()
+	{
+		uint64_t count;
+		ssize_t n = read(fd_, &count, sizeof(count));
+		(void)n;
+	}
+
+	//reactor:ѹ˳׷ӵout,ȡĸ
+	size_t drain(std::vector<RefPtr<T>>& out)
+	{
+		if (head_.load(std::memory_order_relaxed) == nullptr)return 0;
+		T* p = head_.exchange(nullptr, std::memory_order_acquire);
+		if (p == nullptr)return 0;
+
+		//Ǻȳ,תɵ˳
+		T* reversed = nullptr;
+		while (p != nullptr)
+		{
+			T* next = p->completionNext;
+			p->completionNext = reversed;
+			reversed = p;
+			p = next;
+		}
+		size_t taken = 0;
+		while (reversed != nullptr)
+		{
+			T* next = reversed->completionNext;
+			reversed->completionNext = nullptr;
+			out.push_back(RefPtr<T>::adopt(reversed));
+			reversed = next;
+			taken++;
+		}
+		//ֻreactorд,ҪԭӼ
+		completed_.store(completed_.load(std::memory_order_relaxed) + taken, std::memory_order_relaxed);
+		batches_.store(batches_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return taken;
+	}
+
+	long completed() const { return completed_.load(std::memory_order_relaxed); }
+	long batches() const { return batches_.load(std::memory_order_relaxed); }
+	long signals() const { return signals_.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<T*> head_;
+	std::atomic<bool> waiting_;		//reactorepoll_wait
+	int fd_;
+	std::atomic<long> completed_;
+	std::atomic<long> batches_;		//reactorȡ,completed/batchesƽÿĸ
+	std::atomic<long> signals_;		//дeventfdĴ
+};
@@ -0,0 +1,288 @@
+#include "Config.h"
+#include "Proxy.h"
+#include "Throttle.h"
+#include <fstream>
+#include <map>
+#include <stdlib.h>
+#include <errno.h>
+#include <stdio.h>
+
+ServerConfig::ServerConfig()
+	: threadMin(4), threadMax(8), priorityAgingMs(200),
+	listenBacklog(128), epollBatch(1024), readBufferSize(8192), maxBufferedBody(1024 * 1024),
+	dirCacheSize(256), fileSmallMax(16 * 1024), fileMmapMax(4 * 1024 * 1024), fileMmapCacheMb(256), fileCalibrate(0),
+	indexBudgetMs(2000), indexMaxEntries(1000000),
+	maxQueue(4096), maxQueueWaitMs(5000), maxConnections(10000), drainTimeoutMs(30000),
+	rateConnIp(0), rateConnIpBurst(0), rateConnNet(0), rateConnNetBurst(0),
+	rateReqIp(0), rateReqIpBurst(0), rateReqNet(0), rateReqNetBurst(0),
+	tlsPort(0), http2(1), traceSample(0), slowlogMs(0), slowlogIntervalSec(60),
+	throttleConnKb(0)
+{
+}
+
+static std::string trim(const std::string& s)
+{
+	size_t b = s.find_first_not_of(" \t\r");
+	if (b == std::string::npos)return "";
+	size_t e = s.find_last_not_of(" \t\r");
+	return s.substr(b, e - b + 1);
+}
+
+//JSONַ:תšбܺͿַ,·͹пܳЩַ
+static void appendString(std::string& json, const std::string& s)
+{
+	json += '"';
+	for (unsigned char c : s)
+	{
+		if (c == '"' || c == '\\')
+		{
+			json += '\\';
+			json += static_cast<char>(c);
+		}
+		else if (c < 0x20)
+		{
+			char buf[8];
+			snprintf(buf, sizeof(buf), "\\u%04x", c);
+			json += buf;
+		}
+		else
+		{
+			json += static_cast<char>(c);
+		}
+	}
+	json += '"';
+}
+
+static bool parseInt(const std::string& value, long long minValue, long long& out)
+{
+	char* end = nullptr;
+	errno = 0;
+	long long v = strtoll(value.c_str(), &end, 10);
+	if (errno != 0 || end == value.c_str() || *end != '\0' || v < minValue)return false;
+	out = v;
+	return true;
+}
+
+bool ServerConfig::loadFile(const std::string& path, std::string& error)
+{
+	std::ifstream in(path.c_str());
+	if (!in)
+	{
+		error = "cannot open " + path;
+		return false;
+	}
+
+	//д,ļϷЧ,°ɵ
+	ServerConfig next = *this;
+	std::map<std::string, int*> ints = {
+		{ "thread_min", &next.threadMin },
+		{ "thread_max", &next.threadMax },
+		{ "priority_aging_ms", &next.priorityAgingMs },
+		{ "listen_backlog", &next.listenBacklog },
+		{ "epoll_batch", &next.epollBatch },
+		{ "read_buffer", &next.readBufferSize },
+		{ "dir_cache_size", &next.dirCacheSize },
+		{ "file_small_max", &next.fileSmallMax },
+		{ "file_mmap_max", &next.fileMmapMax },
+		{ "file_mmap_cache_mb", &next.fileMmapCacheMb },
+		{ "file_calibrate", &next.fileCalibrate },
+		{ "index_budget_ms", &next.indexBudgetMs },
+		{ "index_max_entries", &next.indexMaxEntries },
+		{ "max_queue", &next.maxQueue },
+		{ "max_queue_wait_ms", &next.maxQueueWaitMs },
+		{ "max_connections", &next.maxConnections },
+		{ "drain_timeout_ms", &next.drainTimeoutMs },
+		{ "rate_conn_ip", &next.rateConnIp },
+		{ "rate_conn_ip_burst", &next.rateConnIpBurst },
+		{ "rate_conn_net", &next.rateConnNet },
+		{ "rate_conn_net_burst", &next.rateConnNetBurst },
+		{ "rate_req_ip", &next.rateReqIp },
+		{ "rate_req_ip_burst", &next.rateReqIpBurst },
+		{ "rate_req_net", &next.rateReqNet },
+		{ "rate_req_net_burst", &next.rateReqNetBurst },
+		{ "tls_port", &next.tlsPort },
+		{ "http2", &next.http2 },
+		{ "trace_sample", &next.traceSample },
+		{ "slowlog_ms", &next.slowlogMs },
+		{ "slowlog_interval", &next.slowlogIntervalSec },
+		{ "throttle_conn_kb", &next.throttleConnKb },
+	};
+
+	std::string line;
+	int lineNo = 0;
+	bool sawProxy = false;
+	bool sawThrottle = false;
+	bool sawThrottleClass = false;
+	while (std::getline(in, line))
+	{
+		lineNo++;
+		size_t hash = line.find('#');
+		if (hash != std::string::npos)line.resize(hash);
+		line = trim(line);
+		if (line.empty())continue;
+
+		size_t eq = line.find('=');
+		if (eq == std::string::npos)
+		{
+			error = path + ":" + std::to_string(lineNo) + ": missing '='";
+			return false;
+		}
+		std::string key = trim(line.substr(0, eq));
+		std::string value = trim(line.substr(eq + 1));
+
+		long long v = 0;
+		auto it = ints.find(key);
+		if (it != ints.end())
+		{
+			if (!parseInt(value, 0, v) || v > 0x7fffffff)
+			{
+				error = path + ":" + std::to_string(lineNo) + ": bad value for " + key;
+				return false;
+			}
+			*it->second = static_cast<int>(v);
+		}
+		else if (key == "max_buffered_body")
+		{
+			if (!parseInt(value, 0, v))
+			{
+				error = path + ":" + std::to_string(lineNo) + ": bad value for " + key;
+				return false;
+			}
+			next.maxBufferedBody = v;
+		}
+		else if (key == "upload_dir")
+		{
+			next.uploadDir = value;
+		}
+		else if (key == "admin_token")
+		{
+			next.adminToken = value;
+		}
+		else if (key == "tls_cert")
+		{
+			next.tlsCert = value;
+		}
+		else if (key == "tls_key")
+		{
+			next.tlsKey = value;
+		}
+		else if (key == "proxy")
+		{
+			std::string routeError;
+			if (!Proxy::checkRoute(value, routeError))
+			{
+				error = path + ":" + std::to_string(lineNo) + ": " + routeError;
+				return false;
+			}
+			if (!sawProxy)next.proxyRoutes.clear();
+			sawProxy = true;
+			next.proxyRoutes.push_back(value);
+		}
+		else if (key == "throttle" || key == "throttle_class")
+		{
+			std::string specError;
+			bool isClass = key == "throttle_class";
+			if (!(isClass ? Throttle::checkClass(value, specError) : Throttle::checkRule(value, specError)))
+			{
+				error = path + ":" + std::to_string(lineNo) + ": " + specError;
+				return false;
+			}
+			bool& saw = isClass ? sawThrottleClass : sawThrottle;
+			std::vector<std::string>& specs = isClass ? next.throttleClasses : next.throttleRoutes;
+			if (!saw)specs.clear();
+			saw = true;
+			specs.push_back(value);
+		}
+		else
+		{
+			error = path + ":" + std::to_string(lineNo) + ": unknown key " + key;
+			return false;
+		}
+	}
+
+	if (next.threadMin < 1 || next.threadMax < next.threadMin)
+	{
+		error = path + ": thread_min must be >= 1 and <= thread_max";
+		return false;
+	}
+	if (next.epollBatch < 1 || next.readBufferSize < 1024)
+	{
+		error = path + ": epoll_batch must be >= 1 and read_buffer >= 1024";
+		return false;
+	}
+	if (next.tlsPort > 65535 || (next.tlsPort > 0 && (next.tlsCert.empty() || next.tlsKey.empty())))
+	{
+		error = path + ": tls_port must be <= 65535 and needs tls_cert and tls_key";
+		return false;
+	}
+
+	*this = next;
+	return true;
+}
+
+std::string ServerConfig::toJson() const
+{
+	std::string json = "{";
+	json += "\"thread_min\":" + std::to_string(threadMin) + ",";
+	json += "\"thread_max\":" + std::to_string(threadMax) + ",";
+	json += "\"priority_aging_ms\":" + std::to_string(priorityAgingMs) + ",";
+	json += "\"listen_backlog\":" + std::to_string(listenBacklog) + ",";
+	json += "\"epoll_batch\":" + std::to_string(epollBatch) + ",";
+	json += "\"read_buffer\":" + std::to_string(readBufferSize) + ",";
+	json += "\"max_buffered_body\":" + std::to_string(maxBufferedBody) + ",";
+	json += "\"dir_cache_size\":" + std::to_string(dirCacheSize) + ",";
+	json += "\"file_small_max\":" + std::to_string(fileSmallMax) + ",";
+	json += "\"file_mmap_max\":" + std::to_string(fileMmapMax) + ",";
+	json += "\"file_mmap_cache_mb\":" + std::to_string(fileMmapCacheMb) + ",";
+	json += "\"file_calibrate\":" + std::to_string(fileCalibrate) + ",";
+	json += "\"index_budget_ms\":" + std::to_string(indexBudgetMs) + ",";
+	json += "\"index_max_entries\":" + std::to_string(indexMaxEntries) + ",";
+	json += "\"max_queue\":" + std::to_string(maxQueue) + ",";
+	json += "\"max_queue_wait_ms\":" + std::to_string(maxQueueWaitMs) + ",";
+	json += "\"max_connections\":" + std::to_string(maxConnections) + ",";
+	json += "\"drain_timeout_ms\":" + std::to_string(drainTimeoutMs) + ",";
+	json += "\"rate_conn_ip\":" + std::to_string(rateConnIp) + ",";
+	json += "\"rate_conn_ip_burst\":" + std::to_string(rateConnIpBurst) + ",";
+	json += "\"rate_conn_net\":" + std::to_string(rateConnNet) + ",";
+	json += "\"rate_conn_net_burst\":" + std::to_string(rateConnNetBurst) + ",";
+	json += "\"rate_req_ip\":" + std::to_string(rateReqIp) + ",";
+	json += "\"rate_req_ip_burst\":" + std::to_string(rateReqIpBurst) + ",";
+	json += "\"rate_req_net\":" + std::to_string(rateReqNet) + ",";
+	json += "\"rate_req_net_burst\":" + std::to_string(rateReqNetBurst) + ",";
+	json += "\"tls_port\":" + std::to_string(tlsPort) + ",";
+	json += "\"tls_cert\":";
+	appendString(json, tlsCert);
+	json += ",";
+	json += "\"http2\":" + std::to_string(http2) + ",";
+	json += "\"trace_sample\":" + std::to_string(traceSample) + ",";
+	json += "\"slowlog_ms\":" + std::to_string(slowlogMs) + ",";
+	json += "\"slowlog_interval\":" + std::to_string(slowlogIntervalSec) + ",";
+	json += "\"upload_dir\":";
+	appendString(json, uploadDir);
+	json += ",";
+	json += std::string("\"admin_token\":") + (adminToken.empty() ? "\"\"" : "\"***\"") + ",";
+	json += "\"proxy\":[";
+	for (size_t i = 0; i < proxyRoutes.size(); i++)
+	{
+		if (i > 0)json += ",";
+		appendString(json, proxyRoutes[i]);
+	}
+	json += "],";
+	json += "\"throttle_conn_kb\":" + std::to_string(throttleConnKb) + ",";
+	json += "\"throttle\":[";
+	for (size_t i = 0; i < throttleRoutes.size(); i++)
+	{
+		if (i > 0)json += ",";
+		appendString(json, throttleRoutes[i]);
+	}
+	json += "],";
+	json += "\"throttle_class\":[";
+	for (size_t i = 0; i < throttleClasses.size(); i++)
+	{
+		if (i > 0)json += ",";
+		appendString(json, throttleClasses[i]);
+	}
+	json += "]";
+	json += "}";
+	return json;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+
+//,ļʽΪÿһkey = value,#ͷΪע
+//ʱ,յSIGHUP/admin/reloadʱ¼
+struct ServerConfig
+{
+	ServerConfig();
+
+	//ļ,δֵkeyԭֵ;ʧʱerrorΪ
+	bool loadFile(const std::string& path, std::string& error);
+
+	std::string toJson() const;
+
+	//̳߳
+	int threadMin;
+	int threadMax;
+	int priorityAgingMs;
+
+	//
+	int listenBacklog;
+	int epollBatch;			//ÿepoll_wait෵ص¼
+	int readBufferSize;		//reactorĶС,ԼĻӳз
+	int64_t maxBufferedBody;	//óȵʽ
+
+	//
+	int dirCacheSize;		//Ŀ¼б
+	int fileSmallMax;		//ôСļreadwritev,ΪһƬ(256KB)
+	int fileMmapMax;		//ôСȵļmmap
+	int fileMmapCacheMb;	//mmapӳ
+	int fileCalibrate;		//0ʱʱû׼¼ֵ
+	int indexBudgetMs;		//·Ԥ,ֻʱЧ
+	int indexMaxEntries;
+
+	//׼볬ʱ
+	int maxQueue;
+	int maxQueueWaitMs;
+	int maxConnections;
+	int drainTimeoutMs;
+
+	//ͻ˵ַ,Ϊÿ,0ʾ;ΪIPv4 /24IPv6 /64
+	int rateConnIp;
+	int rateConnIpBurst;
+	int rateConnNet;
+	int rateConnNetBurst;
+	int rateReqIp;
+	int rateReqIpBurst;
+	int rateReqNet;
+	int rateReqNetBurst;
+
+	//HTTPS,ֻʱЧ;tlsPortΪ0ʱ
+	int tlsPort;
+	std::string tlsCert;
+	std::string tlsKey;
+
+	//0ʱHTTP/2:Ķ˿ʶǰ,HTTPS˿ALPNṩh2
+	int http2;
+
+	//·׷,ÿtraceSampleһ,0ʾر;/admin/trace
+	int traceSample;
+	//־:slowlogMs/admin/slowlog,ÿslowlogIntervalSec;0ʾر(Ĭ)
+	//ÿ󶼼¼׶εʱ,Լ8clock_gettime
+	int slowlogMs;
+	int slowlogIntervalSec;
+
+	std::string uploadDir;
+
+	//޸ķ״̬Ĺӿ(¼ءУ׼㲥)ֻܱ,ͷ"X-Admin-Token"adminToken
+	//Ϊʱֻܱ;/admin/configвʾֵ
+	std::string adminToken;
+
+	//·,ÿһ"proxy = ǰ׺ [,...] [round_robin|least_outstanding]"
+	//ļгproxyʱ滻ԭ·
+	std::vector<std::string> proxyRoutes;
+
+	//,ΪKB/s:throttleConnKbΪÿӵĬ,0ʾ
+	//"throttle = ǰ׺ ÿKB/s []","throttle_class =  KB/s",ͬӹ
+	//ļгthrottlethrottle_classʱ滻ԭеͬ
+	int throttleConnKb;
+	std::vector<std::string> throttleRoutes;
+	std::vector<std::string> throttleClasses;
+};
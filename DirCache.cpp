@@ -0,0 +1,294 @@
+#include "DirCache.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <ctype.h>
+#include <algorithm>
+#include <iostream>
+
+DirCache::DirCache(FileWatcher& watcher, size_t maxDirs)
+	: watcher_(watcher), maxDirs_(maxDirs), tick_(0), clearEpoch_(0)
+{
+	pthread_mutex_init(&mutex_, NULL);
+
+	//Ŀ¼ݱ仯ʱʹӦбʧЧ,dirΪձʾ¼Ҫȫ
+	watcher_.addListener([this](const std::string& dir, const std::string&, uint32_t) {
+		if (dir.empty())
+		{
+			clear();
+		}
+		else
+		{
+			invalidate(dir);
+		}
+		});
+}
+
+DirCache::~DirCache()
+{
+	pthread_mutex_destroy(&mutex_);
+}
+
+DirCache::ListingPtr DirCache::get(const std::string& dirPath, std::string_view urlPath, bool* hit, const Emit& emit)
+{
+	pthread_mutex_lock(&mutex_);
+	auto it = slots_.find(dirPath);
+	if (hit != nullptr)*hit = it != slots_.end();
+	if (it != slots_.end())
+	{
+		Slot& slot = it->second;
+		slot.lastUsed = ++tick_;
+		ListingPtr listing = slot.listing;
+		if (sameUrl(listing->urlPath, urlPath))
+		{
+			pthread_mutex_unlock(&mutex_);
+			return listing;
+		}
+		if (slot.alias && sameUrl(slot.alias->urlPath, urlPath))
+		{
+			listing = slot.alias;
+			pthread_mutex_unlock(&mutex_);
+			return listing;
+		}
+		pthread_mutex_unlock(&mutex_);
+
+		//ͬһĿ¼ͨһurl(),ֻȾ,ɨ
+		auto copy = std::make_shared<Listing>(*listing);
+		copy->urlPath = rowPrefix(std::string(urlPath));
+		copy->html = renderHtml(copy->entries, copy->urlPath);
+
+		//ڼĿ¼ѾʧЧ,ֻлĻͬһݽʱű
+		pthread_mutex_lock(&mutex_);
+		it = slots_.find(dirPath);
+		if (it != slots_.end() && it->second.listing == listing)it->second.alias = copy;
+		pthread_mutex_unlock(&mutex_);
+		return copy;
+	}
+	//ֻǼĿ¼,Ŀ¼ʧЧӰ챾ɨĽܷ뻺
+	Pending& pending = pending_.emplace(dirPath, Pending{ 0, 0 }).first->second;
+	pending.scans++;
+	unsigned long epoch = pending.epoch;
+	unsigned long clearEpoch = clearEpoch_;
+	pthread_mutex_unlock(&mutex_);
+
+	//Ƚwatchɨ,ɨڼ޸һʧЧ¼
+	watcher_.watchDir(dirPath);
+
+	ListingPtr listing = load(dirPath, rowPrefix(std::string(urlPath)), emit);
+
+	pthread_mutex_lock(&mutex_);
+	auto pit = pending_.find(dirPath);
+	bool fresh = pit->second.epoch == epoch && clearEpoch == clearEpoch_;
+	if (--pit->second.scans == 0)pending_.erase(pit);
+	if (listing && fresh)
+	{
+		slots_[dirPath] = Slot{ listing, nullptr, ++tick_ };
+		evictLocked();
+	}
+	pthread_mutex_unlock(&mutex_);
+	return listing;
+}
+
+void DirCache::setMaxDirs(size_t maxDirs)
+{
+	pthread_mutex_lock(&mutex_);
+	maxDirs_ = maxDirs;
+	evictLocked();
+	pthread_mutex_unlock(&mutex_);
+}
+
+void DirCache::invalidate(const std::string& dirPath)
+{
+	pthread_mutex_lock(&mutex_);
+	auto it = pending_.find(dirPath);
+	if (it != pending_.end())it->second.epoch++;
+	slots_.erase(dirPath);
+	pthread_mutex_unlock(&mutex_);
+}
+
+void DirCache::clear()
+{
+	pthread_mutex_lock(&mutex_);
+	clearEpoch_++;
+	slots_.clear();
+	pthread_mutex_unlock(&mutex_);
+}
+
+DirCache::ListingPtr DirCache::load(const std::string& dirPath, const std::string& urlPath, const Emit& emit)
+{
+	int dfd = open(dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dfd == -1)
+	{
+		return nullptr;
+	}
+	//fdopendirӹdfd,closedirʱһر
+	DIR* dir = fdopendir(dfd);
+	if (dir == NULL)
+	{
+		close(dfd);
+		return nullptr;
+	}
+
+	auto listing = std::make_shared<Listing>();
+	listing->dirPath = dirPath;
+	listing->urlPath = urlPath;
+
+	//ʽʱȷҳ濪ͷ,ȡĿ¼ڼͻѾʼ
+	std::string& out = listing->html;
+	renderHead(out, urlPath);
+	bool streaming = emit && emit(out);
+
+	//ֲֻ,fstatatȾͽ
+	struct dirent* entry;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)continue;
+		Entry e;
+		e.name = entry->d_name;
+		listing->entries.push_back(std::move(e));
+	}
+	std::sort(listing->entries.begin(), listing->entries.end(),
+		[](const Entry& a, const Entry& b) { return a.name < b.name; });
+
+	//ÿдԼֽ,Ԥȷⷴ
+	out.reserve(256 + listing->entries.size() * 128);
+	size_t emitted = out.size();
+
+	std::string prefix;
+	appendEncoded(prefix, rowPrefix(urlPath));
+	size_t kept = 0;
+	for (size_t i = 0; i < listing->entries.size(); i++)
+	{
+		Entry& e = listing->entries[i];
+		struct stat st;
+		if (fstatat(dfd, e.name.c_str(), &st, 0) == -1)continue;
+		e.isDir = S_ISDIR(st.st_mode);
+		e.size = st.st_size;
+		e.mtime = st.st_mtime;
+		renderRow(out, e, prefix);
+		if (kept != i)listing->entries[kept] = std::move(e);
+		kept++;
+
+		if (streaming && out.size() - emitted >= CHUNK_SIZE)
+		{
+			streaming = emit(std::string_view(out).substr(emitted));
+			emitted = out.size();
+		}
+	}
+	closedir(dir);
+	listing->entries.resize(kept);
+	renderTail(out);
+	if (streaming)emit(std::string_view(out).substr(emitted));
+
+	std::cout << "Ŀ¼бѻ:" << dirPath << ",Ŀ:" << listing->entries.size() << std::endl;
+	return listing;
+}
+
+void DirCache::evictLocked()
+{
+	while (slots_.size() > maxDirs_)
+	{
+		auto victim = slots_.begin();
+		for (auto it = slots_.begin(); it != slots_.end(); ++it)
+		{
+			if (it->second.lastUsed < victim->second.lastUsed)victim = it;
+		}
+		slots_.erase(victim);
+	}
+}
+
+std::string DirCache::rowPrefix(const std::string& urlPath)
+{
+	std::string prefix = urlPath;
+	if (prefix.empty() || prefix.back() != '/')prefix += "/";
+	return prefix;
+}
+
+bool DirCache::sameUrl(const std::string& cached, std::string_view url)
+{
+	if (cached.size() == url.size())return url == cached;
+	return cached.size() == url.size() + 1 && cached.back() == '/' && cached.compare(0, url.size(), url) == 0;
+}
+
+void DirCache::appendEscaped(std::string& out, std::string_view s)
+{
+	for (char c : s)
+	{
+		switch (c)
+		{
+		case '&': out += "&amp;"; break;
+		case '<': out += "&lt;"; break;
+		case '>': out += "&gt;"; break;
+		case '"': out += "&quot;"; break;
+		case '\'': out += "&#39;"; break;
+		default: out += c; break;
+		}
+	}
+}
+
+void DirCache::appendEncoded(std::string& out, std::string_view s)
+{
+	//ֻҪַ·ָ,ûźͼ,ֱӷŽ
+	static const char HEX[] = "0123456789ABCDEF";
+	for (char c : s)
+	{
+		unsigned char u = static_cast<unsigned char>(c);
+		if (isalnum(u) || c == '-' || c == '_' || c == '.' || c == '~' || c == '/')
+		{
+			out += c;
+		}
+		else
+		{
+			out += '%';
+			out += HEX[u >> 4];
+			out += HEX[u & 0xf];
+		}
+	}
+}
+
+void DirCache::renderHead(std::string& out, const std::string& urlPath)
+{
+	out += "<html><head><title>Index of";
+	appendEscaped(out, urlPath);
+	out += "</title></head><body><h1>Index of";
+	appendEscaped(out, urlPath);
+	out += "</h1><hr><table>";
+}
+
+//prefixΪѾurlǰ׺
+void DirCache::renderRow(std::string& out, const Entry& e, const std::string& prefix)
+{
+	out += "<tr><td><a href=\"";
+	out += prefix;
+	appendEncoded(out, e.name);
+	if (e.isDir)out += "/";
+	out += "\">";
+	appendEscaped(out, e.name);
+	if (e.isDir)out += "/";
+	out += "</a></td><td>";
+	out += std::to_string(e.size);
+	out += "</td></tr>";
+}
+
+void DirCache::renderTail(std::string& out)
+{
+	out += "</table><hr></body></html>";
+}
+
+std::string DirCache::renderHtml(const std::vector<Entry>& entries, const std::string& urlPath)
+{
+	std::string prefix;
+	appendEncoded(prefix, rowPrefix(urlPath));
+	std::string buf;
+	//ÿдԼֽ,Ԥȷⷴ
+	buf.reserve(256 + entries.size() * 128);
+	renderHead(buf, urlPath);
+	for (const Entry& e : entries)
+	{
+		renderRow(buf, e, prefix);
+	}
+	renderTail(buf);
+	return buf;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include "FileWatcher.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <functional>
+#include <string_view>
+#include <sys/types.h>
+#include <time.h>
+#include <pthread.h>
+
+
+//Ŀ¼б:ȾõHTMLĿԪ,inotifyʧЧ
+class DirCache
+{
+public:
+	struct Entry
+	{
+		std::string name;
+		bool isDir;
+		off_t size;
+		time_t mtime;
+	};
+
+	struct Listing
+	{
+		std::string dirPath;
+		std::string urlPath;		//Ⱦhtmlʱʹõurl,ͳһ/β
+		std::string html;
+		std::vector<Entry> entries;	//,ڷҳ
+	};
+	using ListingPtr = std::shared_ptr<const Listing>;
+	//ʽȾ,falseʾͻѾϿ,֮ٵ
+	using Emit = std::function<bool(std::string_view piece)>;
+
+	DirCache(FileWatcher& watcher, size_t maxDirs = 256);
+	~DirCache();
+
+	//ȡĿ¼б,δʱɨĿ¼뻺,ʧܷnullptr;hitǿʱǷ
+	//urlPathĩβû/õͬһݽ;ͨһurl()ʱȾһ,alias
+	//emitǿδʱ,ҳ濪ͷڴĿ¼,֮߶ȡĿԪݱ߰CHUNK_SIZEֶ;
+	//ʱemit,ɵ߷listing->html
+	ListingPtr get(const std::string& dirPath, std::string_view urlPath, bool* hit = nullptr, const Emit& emit = Emit());
+
+	//໺Ŀ¼
+	void setMaxDirs(size_t maxDirs);
+
+	//ʹĳĿ¼ĻʧЧ
+	void invalidate(const std::string& dirPath);
+	void clear();
+
+	//ĿȾHTML(漰ϵͳ);ֺurlHTMLת,ٷֺű
+	static std::string renderHtml(const std::vector<Entry>& entries, const std::string& urlPath);
+
+	static const size_t CHUNK_SIZE = 16 * 1024;
+
+private:
+	struct Slot
+	{
+		ListingPtr listing;
+		ListingPtr alias;		//һͨurlʱȾĽ,ֻһ
+		unsigned long lastUsed;
+	};
+
+	//ɨĿ¼:ɨڼĿ¼ÿʧЧһepoch+1,ֻepochʱɨŷ뻺
+	struct Pending
+	{
+		unsigned long epoch;
+		int scans;			//ͬһĿ¼ͬʱеɨ,Ϊ0ʱɾ
+	};
+
+	//ɨĿ¼,ʹĿ¼fdϵfstatatÿĿ½·
+	ListingPtr load(const std::string& dirPath, const std::string& urlPath, const Emit& emit);
+
+	static void renderHead(std::string& out, const std::string& urlPath);
+	static void renderRow(std::string& out, const Entry& e, const std::string& prefix);
+	static void renderTail(std::string& out);
+	static std::string rowPrefix(const std::string& urlPath);
+	static void appendEscaped(std::string& out, std::string_view s);
+	static void appendEncoded(std::string& out, std::string_view s);
+	//urlͻurl(/β)Ƿָͬһҳ,ڴ
+	static bool sameUrl(const std::string& cached, std::string_view url);
+	void evictLocked();
+
+	FileWatcher& watcher_;
+	size_t maxDirs_;
+	pthread_mutex_t mutex_;
+	std::unordered_map<std::string, Slot> slots_;
+	std::unordered_map<std::string, Pending> pending_;
+	unsigned long tick_;	//ڽLRU
+	unsigned long clearEpoch_;	//ÿȫ+1,¼ʱڽеɨ趼
+};
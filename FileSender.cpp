@@ -0,0 +1,611 @@
+#include "FileSender.h"
+#include "RingBuffer.h"
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+//ûreactorֵĵڷͻʱȴ
+static const int WRITE_WAIT_MS = 5000;
+//READԵջϻ;һδBufferPoolȡһ󵵵Ŀ,ֶζȡ
+static const size_t READ_STACK_BUF = 16 * 1024;
+
+static bool waitWritable(int cfd)
+{
+	struct pollfd pfd = { cfd, POLLOUT, 0 };
+	int ret;
+	do {
+		ret = poll(&pfd, 1, WRITE_WAIT_MS);
+	} while (ret == -1 && errno == EINTR);
+	return ret > 0 && !(pfd.revents & (POLLERR | POLLHUP));
+}
+
+static bool sameFile(const struct stat& st, dev_t dev, ino_t ino, size_t len, const struct timespec& mtime)
+{
+	return st.st_dev == dev && st.st_ino == ino && static_cast<size_t>(st.st_size) == len &&
+		st.st_mtim.tv_sec == mtime.tv_sec && st.st_mtim.tv_nsec == mtime.tv_nsec;
+}
+
+FileSender::Mapping::~Mapping()
+{
+	if (addr != nullptr)munmap(addr, len);
+}
+
+FileSender::Transfer::~Transfer()
+{
+	if (fd_ != -1)close(fd_);
+}
+
+FileSender::FileSender()
+	: smallMax_(16 * 1024), mmapMax_(4 * 1024 * 1024), mmapCacheBytes_(256 * 1024 * 1024),
+	mappedBytes_(0), tick_(0), loads_(0), coalesced_(0)
+{
+	pthread_mutex_init(&mutex_, NULL);
+	for (int i = 0; i < STRATEGY_COUNT; i++)
+	{
+		files_[i] = 0;
+		bytes_[i] = 0;
+	}
+}
+
+FileSender::~FileSender()
+{
+	pthread_mutex_destroy(&mutex_);
+}
+
+void FileSender::setThresholds(size_t smallMax, size_t mmapMax, size_t mmapCacheBytes)
+{
+	//READڹ߳ļ,ܳһƬ
+	smallMax_ = smallMax < SLICE_BYTES ? smallMax : SLICE_BYTES;
+	mmapMax_ = mmapMax;
+	pthread_mutex_lock(&mutex_);
+	mmapCacheBytes_ = mmapCacheBytes;
+	evictLocked();
+	pthread_mutex_unlock(&mutex_);
+}
+
+FileSender::Strategy FileSender::choose(const std::string& path, const struct stat& st)
+{
+	size_t size = static_cast<size_t>(st.st_size);
+	if (size <= smallMax_)return Strategy::READ;
+	if (size > mmapMax_)return Strategy::SENDFILE;
+
+	//еȴС:Ѿӳ߷ʴmmap,ļȻsendfile
+	pthread_mutex_lock(&mutex_);
+	bool hot = maps_.count(path) > 0;
+	if (!hot)
+	{
+		if (hits_.size() >= MAX_TRACKED_HITS && hits_.find(path) == hits_.end())hits_.clear();
+		hot = ++hits_[path] >= HOT_HITS;
+	}
+	pthread_mutex_unlock(&mutex_);
+	return hot ? Strategy::MMAP : Strategy::SENDFILE;
+}
+
+bool FileSender::prepare(const std::string& path, int fd, const struct stat& st, Continuation then)
+{
+	//ֻMMAPиļؽ,READSENDFILEԶļ
+	size_t size = static_cast<size_t>(st.st_size);
+	if (size <= smallMax_ || size > mmapMax_)return true;
+
+	pthread_mutex_lock(&mutex_);
+	//ӳڶҳ֮ǰѷŽmaps_,ؽǰȻҪȴ
+	auto flight = loading_.find(path);
+	if (flight != loading_.end())
+	{
+		flight->second.push_back(std::move(then));
+		pthread_mutex_unlock(&mutex_);
+		coalesced_++;
+		return false;
+	}
+	auto mapped = maps_.find(path);
+	if (mapped != maps_.end() && sameFile(st, mapped->second->dev, mapped->second->ino, mapped->second->len, mapped->second->mtime))
+	{
+		pthread_mutex_unlock(&mutex_);
+		return true;
+	}
+	//chooseжһ:Ѿӳ(ļ仯Ҫӳ)ηʺΪȵļҪ
+	bool hot = mapped != maps_.end();
+	if (!hot)
+	{
+		auto hit = hits_.find(path);
+		hot = hit != hits_.end() && hit->second + 1 >= HOT_HITS;
+	}
+	if (!hot)
+	{
+		pthread_mutex_unlock(&mutex_);
+		return true;
+	}
+	loading_.emplace(path, std::vector<Continuation>());
+	pthread_mutex_unlock(&mutex_);
+
+	//ӳ䲢ҳ,֮ȴֱӴӹӳ䷢,ٸԴȱҳ
+	MappingPtr mapping = acquireMapping(path, fd, st);
+	if (mapping)
+	{
+#ifdef MADV_POPULATE_READ
+		if (madvise(mapping->addr, mapping->len, MADV_POPULATE_READ) == -1)
+#endif
+		{
+			//ںûMADV_POPULATE_READ,ҳһֽ
+			volatile const char* p = static_cast<const char*>(mapping->addr);
+			long page = sysconf(_SC_PAGESIZE);
+			for (size_t off = 0; off < mapping->len; off += page)(void)p[off];
+		}
+	}
+	loads_++;
+
+	pthread_mutex_lock(&mutex_);
+	std::vector<Continuation> waiters = std::move(loading_[path]);
+	loading_.erase(path);
+	pthread_mutex_unlock(&mutex_);
+
+	//ӳʧʱȴһ,send˻sendfile
+	for (Continuation& c : waiters)c(nullptr);
+	return true;
+}
+
+bool FileSender::send(int cfd, const std::string& path, int fd, const struct stat& st, std::string_view head, bool* cached,
+	TransferPtr* transfer, size_t budget)
+{
+	Strategy strategy = choose(path, st);
+	if (cached != nullptr)*cached = false;
+	MappingPtr mapping;
+	if (strategy == Strategy::MMAP)
+	{
+		mapping = acquireMapping(path, fd, st, cached);
+		//ӳʧ(ַռ䲻)ʱ˻sendfile
+		if (!mapping)strategy = Strategy::SENDFILE;
+	}
+	int idx = static_cast<int>(strategy);
+	files_[idx]++;
+
+	//ջϵĽֱӷ,һηʱڴ;fdõߵ,ǰ黹
+	Transfer local;
+	local.head_ = head;
+	local.mapping_ = mapping;
+	local.fd_ = fd;
+	local.size_ = st.st_size;
+	local.strategy_ = strategy;
+
+	bool ok;
+	if (transfer == nullptr)
+	{
+		//ûreactorֵĵֻܵsocketд
+		ok = sendAll(cfd, local);
+		if (ok)bytes_[idx] += st.st_size;
+	}
+	else
+	{
+		//budgetsocketдʱͣ,ʣಿַŵ*transfer,֮䲻ռù߳;ļֽڷʱresume
+		Progress progress = resume(cfd, local, budget);
+		ok = progress != Progress::FAILED;
+		if (progress == Progress::PENDING)
+		{
+			TransferPtr t(new Transfer());
+			t->buffer_.assign(head.data() + local.headSent_, head.size() - local.headSent_);
+			t->head_ = t->buffer_;
+			t->sentBefore_ = local.headSent_;
+			t->mapping_ = mapping;
+			t->offset_ = local.offset_;
+			t->size_ = st.st_size;
+			t->strategy_ = strategy;
+			if (!mapping)
+			{
+				//߷͵һƬͻرfd
+				t->fd_ = dup(fd);
+				if (t->fd_ == -1)perror("dup");
+			}
+			if (mapping || t->fd_ != -1)*transfer = std::move(t);
+			else ok = false;
+		}
+	}
+	local.fd_ = -1;
+	return ok;
+}
+
+FileSender::TransferPtr FileSender::bufferTransfer(std::string data, uint64_t sentBefore)
+{
+	TransferPtr t(new Transfer());
+	t->buffer_ = std::move(data);
+	t->head_ = t->buffer_;
+	t->sentBefore_ = sentBefore;
+	return t;
+}
+
+FileSender::Progress FileSender::resume(int cfd, Transfer& t, size_t budget)
+{
+	Progress progress = pump(cfd, t, budget);
+	if (progress == Progress::DONE)bytes_[static_cast<int>(t.strategy_)] += t.size_;
+	return progress;
+}
+
+FileSender::Progress FileSender::pump(int cfd, Transfer& t, size_t budget)
+{
+	//ͷռbudget,ٵʱûʱҲÿͻյͷ
+	while (!t.done() && (budget > 0 || t.headSent_ < t.head_.size()))
+	{
+		size_t headLeft = t.head_.size() - t.headSent_;
+		size_t body = static_cast<size_t>(std::min<off_t>(t.size_ - t.offset_, static_cast<off_t>(budget)));
+		ssize_t n;
+		if (t.mapping_)
+		{
+			struct iovec iov[2];
+			int count = 0;
+			if (headLeft > 0)
+			{
+				iov[count].iov_base = const_cast<char*>(t.head_.data() + t.headSent_);
+				iov[count++].iov_len = headLeft;
+			}
+			if (body > 0)
+			{
+				iov[count].iov_base = static_cast<char*>(t.mapping_->addr) + t.offset_;
+				iov[count++].iov_len = body;
+			}
+			n = writev(cfd, iov, count);
+		}
+		else if (t.strategy_ == Strategy::READ && t.offset_ < t.size_)
+		{
+			n = writeRead(cfd, t, headLeft, body);
+		}
+		else if (headLeft > 0)
+		{
+			//滹ļʱͷMSG_MORE,ļĵһκϲһ
+			int flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+			if (t.offset_ < t.size_)flags |= MSG_MORE;
+			n = ::send(cfd, t.head_.data() + t.headSent_, headLeft, flags);
+		}
+		else
+		{
+			off_t offset = t.offset_;
+			n = sendfile(cfd, t.fd_, &offset, body);
+			//ļڷڼ䱻ض
+			if (n == 0)return Progress::FAILED;
+		}
+		if (n < 0)
+		{
+			if (errno == EINTR)continue;
+			//socketд:صߵȴд,ȴ
+			if (errno == EAGAIN || errno == EWOULDBLOCK)return Progress::PENDING;
+			return Progress::FAILED;
+		}
+
+		size_t fromHead = std::min(static_cast<size_t>(n), headLeft);
+		size_t fromBody = static_cast<size_t>(n) - fromHead;
+		t.headSent_ += fromHead;
+		t.offset_ += fromBody;
+		budget -= std::min(budget, fromBody);
+	}
+	return t.done() ? Progress::DONE : Progress::PENDING;
+}
+
+bool FileSender::sendAll(int cfd, Transfer& t)
+{
+	for (;;)
+	{
+		Progress progress = pump(cfd, t, SIZE_MAX);
+		if (progress == Progress::DONE)return true;
+		if (progress == Progress::FAILED || !waitWritable(cfd))return false;
+	}
+}
+
+ssize_t FileSender::writeRead(int cfd, const Transfer& t, size_t headLeft, size_t body)
+{
+	char stackBuf[READ_STACK_BUF];
+	char* buf = stackBuf;
+	size_t cap = sizeof(stackBuf);
+	if (body > cap)
+	{
+		cap = BufferPool::MAX_POOLED;
+		buf = BufferPool::instance().acquire(cap);
+	}
+
+	//ͷļһһwritev,Сļֻһ;ûдsocketĲ´¶
+	size_t want = std::min(cap, body);
+	size_t got = 0;
+	while (got < want)
+	{
+		ssize_t r = pread(t.fd_, buf + got, want - got, t.offset_ + got);
+		if (r < 0 && errno == EINTR)continue;
+		if (r <= 0)break;
+		got += r;
+	}
+
+	ssize_t n;
+	if (got < want)
+	{
+		//ļڷڼ䱻ض,ͷĳѾ޷
+		perror("pread");
+		n = -1;
+	}
+	else
+	{
+		struct iovec iov[2];
+		int count = 0;
+		if (headLeft > 0)
+		{
+			iov[count].iov_base = const_cast<char*>(t.head_.data() + t.headSent_);
+			iov[count++].iov_len = headLeft;
+		}
+		if (want > 0)
+		{
+			iov[count].iov_base = buf;
+			iov[count++].iov_len = want;
+		}
+		n = writev(cfd, iov, count);
+	}
+	int saved = errno;
+	if (buf != stackBuf)BufferPool::instance().release(buf, cap);
+	//ضϰ,õߵsocketд
+	errno = got < want ? EIO : saved;
+	return n;
+}
+
+FileSender::MappingPtr FileSender::acquireMapping(const std::string& path, int fd, const struct stat& st, bool* reused)
+{
+	pthread_mutex_lock(&mutex_);
+	auto it = maps_.find(path);
+	if (it != maps_.end())
+	{
+		MappingPtr mapping = it->second;
+		if (sameFile(st, mapping->dev, mapping->ino, mapping->len, mapping->mtime))
+		{
+			mapping->lastUsed = ++tick_;
+			pthread_mutex_unlock(&mutex_);
+			if (reused != nullptr)*reused = true;
+			return mapping;
+		}
+		//ļѱ滻޸,ӳɻʹ߳ͷ
+		mappedBytes_ -= mapping->len;
+		maps_.erase(it);
+	}
+	pthread_mutex_unlock(&mutex_);
+
+	//ע:ӳڼļԭؽضϻᵼ·ʱSIGBUS,ĵĿ¼µļӦ滻(rename)ԭظд
+	//ӳ,߳ͬʱӳͬһļʱߵĽֱӶ
+	void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED)
+	{
+		perror("mmap");
+		return nullptr;
+	}
+	//鲻ܰλ,Ҫֱ
+	madvise(addr, st.st_size, MADV_SEQUENTIAL);
+	madvise(addr, st.st_size, MADV_WILLNEED);
+
+	MappingPtr mapping = std::make_shared<Mapping>();
+	mapping->addr = addr;
+	mapping->len = st.st_size;
+	mapping->dev = st.st_dev;
+	mapping->ino = st.st_ino;
+	mapping->mtime = st.st_mtim;
+
+	pthread_mutex_lock(&mutex_);
+	auto inserted = maps_.emplace(path, mapping);
+	if (inserted.second)
+	{
+		mappedBytes_ += mapping->len;
+		hits_.erase(path);
+	}
+	else
+	{
+		mapping = inserted.first->second;
+	}
+	mapping->lastUsed = ++tick_;
+	evictLocked();
+	pthread_mutex_unlock(&mutex_);
+	return mapping;
+}
+
+void FileSender::evictLocked()
+{
+	while (mappedBytes_ > mmapCacheBytes_ && !maps_.empty())
+	{
+		auto oldest = maps_.begin();
+		for (auto it = maps_.begin(); it != maps_.end(); ++it)
+		{
+			if (it->second->lastUsed < oldest->second->lastUsed)oldest = it;
+		}
+		mappedBytes_ -= oldest->second->len;
+		maps_.erase(oldest);
+	}
+}
+
+FileSender::Stats FileSender::stats()
+{
+	Stats s;
+	for (int i = 0; i < STRATEGY_COUNT; i++)
+	{
+		s.files[i] = files_[i];
+		s.bytes[i] = bytes_[i];
+	}
+	pthread_mutex_lock(&mutex_);
+	s.mappedFiles = maps_.size();
+	s.mappedBytes = mappedBytes_;
+	pthread_mutex_unlock(&mutex_);
+	s.smallMax = smallMax_;
+	s.mmapMax = mmapMax_;
+	s.loads = loads_;
+	s.coalesced = coalesced_;
+	return s;
+}
+
+std::string FileSender::statsJson()
+{
+	Stats s = stats();
+	std::string json = "{\"smallMax\":" + std::to_string(s.smallMax) +
+		",\"mmapMax\":" + std::to_string(s.mmapMax) +
+		",\"mappedFiles\":" + std::to_string(s.mappedFiles) +
+		",\"mappedBytes\":" + std::to_string(s.mappedBytes) +
+		",\"loads\":" + std::to_string(s.loads) +
+		",\"coalesced\":" + std::to_string(s.coalesced) + ",\"strategies\":{";
+	for (int i = 0; i < STRATEGY_COUNT; i++)
+	{
+		if (i > 0)json += ",";
+		json += "\"" + std::string(strategyName(static_cast<Strategy>(i))) + "\":{\"files\":" +
+			std::to_string(s.files[i]) + ",\"bytes\":" + std::to_string(s.bytes[i]) + "}";
+	}
+	json += "}}";
+	return json;
+}
+
+const char* FileSender::strategyName(Strategy s)
+{
+	switch (s)
+	{
+	case Strategy::READ: return "read";
+	case Strategy::MMAP: return "mmap";
+	case Strategy::SENDFILE: return "sendfile";
+	}
+	return "unknown";
+}
+
+//׼жȡsocketpairһ˵߳
+static void* drainSocket(void* arg)
+{
+	int fd = *static_cast<int*>(arg);
+	char buf[65536];
+	while (read(fd, buf, sizeof(buf)) > 0) {}
+	return NULL;
+}
+
+static double nowUs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+bool FileSender::calibrate()
+{
+	//ԵļС,ֵֻЩ
+	static const size_t SIZES[] = { 1024, 4096, 16384, 65536, 262144, 1048576, 4194304, 16777216 };
+	static const int SIZE_COUNT = sizeof(SIZES) / sizeof(SIZES[0]);
+	//ÿСÿֲԴԼ͵ֽ
+	static const size_t BYTES_PER_RUN = 32 * 1024 * 1024;
+
+	char tmpl[] = "/tmp/filesender-XXXXXX";
+	int fd = mkstemp(tmpl);
+	if (fd == -1)
+	{
+		perror("mkstemp");
+		return false;
+	}
+	unlink(tmpl);
+	std::vector<char> data(SIZES[SIZE_COUNT - 1], 'x');
+	if (write(fd, data.data(), data.size()) != static_cast<ssize_t>(data.size()))
+	{
+		perror("write");
+		close(fd);
+		return false;
+	}
+
+	int sv[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) == -1)
+	{
+		perror("socketpair");
+		close(fd);
+		return false;
+	}
+	pthread_t reader;
+	if (pthread_create(&reader, NULL, drainSocket, &sv[1]) != 0)
+	{
+		close(sv[0]);
+		close(sv[1]);
+		close(fd);
+		return false;
+	}
+
+	std::string head = "HTTP/1.1 200 OK\r\nContent-Type:application/octet-stream\r\nContent-Length:0\r\n\r\n";
+	size_t newSmallMax = 0, newMmapMax = 0;
+	bool readWins = true, mmapWins = true;
+	bool ok = true;
+	for (int i = 0; i < SIZE_COUNT && ok; i++)
+	{
+		size_t size = SIZES[i];
+		//׼ļضϵǰС,֤mmapsendfileͬһļ
+		if (ftruncate(fd, size) == -1)
+		{
+			ok = false;
+			break;
+		}
+		struct stat st;
+		fstat(fd, &st);
+		void* addr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+		if (addr == MAP_FAILED)
+		{
+			ok = false;
+			break;
+		}
+		MappingPtr mapping = std::make_shared<Mapping>();
+		mapping->addr = addr;
+		mapping->len = size;
+
+		size_t rounds = BYTES_PER_RUN / size;
+		if (rounds < 8)rounds = 8;
+		if (rounds > 4096)rounds = 4096;
+
+		double cost[STRATEGY_COUNT];
+		for (int s = 0; s < STRATEGY_COUNT && ok; s++)
+		{
+			double start = nowUs();
+			for (size_t r = 0; r < rounds && ok; r++)
+			{
+				Transfer t;
+				t.head_ = head;
+				if (s == static_cast<int>(Strategy::MMAP))t.mapping_ = mapping;
+				t.fd_ = fd;
+				t.size_ = st.st_size;
+				t.strategy_ = static_cast<Strategy>(s);
+				ok = sendAll(sv[0], t);
+				t.fd_ = -1;
+			}
+			cost[s] = (nowUs() - start) / rounds;
+		}
+		if (!ok)break;
+
+		std::cout << "׼ " << size << "ֽ: read " << cost[0] << "us, mmap " << cost[1]
+			<< "us, sendfile " << cost[2] << "us" << std::endl;
+
+		//ֵȡСռŵһС
+		if (readWins && cost[0] <= cost[1] && cost[0] <= cost[2])
+		{
+			newSmallMax = size;
+		}
+		else
+		{
+			readWins = false;
+			if (mmapWins && cost[1] <= cost[2])newMmapMax = size;
+			else mmapWins = false;
+		}
+	}
+
+	shutdown(sv[0], SHUT_WR);
+	pthread_join(reader, NULL);
+	close(sv[0]);
+	close(sv[1]);
+	close(fd);
+	if (!ok)
+	{
+		std::cout << "׼ʧ,ֲֵ" << std::endl;
+		return false;
+	}
+
+	if (newSmallMax > SLICE_BYTES)newSmallMax = SLICE_BYTES;
+	if (newMmapMax < newSmallMax)newMmapMax = newSmallMax;
+	smallMax_ = newSmallMax;
+	mmapMax_ = newMmapMax;
+	std::cout << "ļֵ: read <= " << newSmallMax << ", mmap <= " << newMmapMax << std::endl;
+	return true;
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include "TaskQueue.h"
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdint.h>
+#include <pthread.h>
+
+
+//ļӦķͲ:
+//Сļreadͷһwritev;еȴСȵļmmapй̼߳乲;
+//ļļsendfile,û̬
+class FileSender
+{
+public:
+	enum class Strategy { READ = 0, MMAP, SENDFILE };
+	static const int STRATEGY_COUNT = 3;
+
+	struct Stats
+	{
+		uint64_t files[STRATEGY_COUNT];
+		uint64_t bytes[STRATEGY_COUNT];
+		size_t mappedFiles;
+		size_t mappedBytes;
+		size_t smallMax;
+		size_t mmapMax;
+		uint64_t loads;		//һɵش
+		uint64_t coalesced;	//ڱ˵ļϵȴ
+	};
+	//̳߳һ,ʱڴ;ʱΪnullptr
+	using Continuation = TaskFunction;
+
+	enum class Progress { DONE, PENDING, FAILED };
+
+private:
+	struct Mapping;
+	using MappingPtr = std::shared_ptr<Mapping>;
+
+public:
+	//ƬеӦ:ͷļķͽ,ӹرʱͷ
+	class Transfer
+	{
+	public:
+		~Transfer();
+		bool done() const { return headSent_ >= head_.size() && offset_ >= size_; }
+		//Ѿдsocketֽ(ͷļ)
+		uint64_t bytesSent() const { return sentBefore_ + headSent_ + static_cast<uint64_t>(offset_); }
+		//Ѿ͵ļֽ,ֻļ
+		uint64_t bodySent() const { return static_cast<uint64_t>(offset_); }
+
+	private:
+		friend class FileSender;
+		Transfer() : headSent_(0), sentBefore_(0), fd_(-1), offset_(0), size_(0), strategy_(Strategy::SENDFILE) {}
+
+		std::string_view head_;	//ļ֮ǰ,ָbuffer_
+		std::string buffer_;
+		size_t headSent_;
+		uint64_t sentBefore_;	//֮ǰѾֽ
+		MappingPtr mapping_;	//MMAPԴӹӳ䷢
+		int fd_;				//READSENDFILEʹdupfd
+		off_t offset_;
+		off_t size_;
+		Strategy strategy_;
+	};
+	using TransferPtr = std::unique_ptr<Transfer>;
+
+	FileSender();
+	~FileSender();
+
+	FileSender(const FileSender&) = delete;
+	FileSender& operator=(const FileSender&) = delete;
+
+	//smallMaxREAD,mmapMaxڵȵļMMAP,mmapCacheBytesΪӳ
+	void setThresholds(size_t smallMax, size_t mmapMax, size_t mmapCacheBytes);
+
+	//ΪļѡͲ,¸ļķʼ
+	Strategy choose(const std::string& path, const struct stat& st);
+
+	//ǰ:ȵļûйӳʱҪ(ӳ䲢ҳ),ͬһļͬʱֻһ
+	//trueʾԵsend;falseʾһڼļ,thenѹǴμ,
+	//ؽɼص̵߳,߲ٷ,ҲӦȴ
+	bool prepare(const std::string& path, int fd, const struct stat& st, Continuation then);
+
+	//ͷļ,fdɵߴ򿪺͹ر;falseʾӳ
+	//cachedǿʱļǷеĹӳ
+	//transferǿʱȴ:budgetļֻ͵һƬ,socketдһƬͣ,ʣಿַ*transfer,
+	//ɵsocketдʱresume;ļһηʱ*transferΪ
+	//ٵӰõƴСbudget,Ϊ0
+	bool send(int cfd, const std::string& path, int fd, const struct stat& st, std::string_view head, bool* cached = nullptr,
+		TransferPtr* transfer = nullptr, size_t budget = SLICE_BYTES);
+	//,budgetֽ,ȴsocketд
+	Progress resume(int cfd, Transfer& transfer, size_t budget = SLICE_BYTES);
+	//ڴûзӦ(socketдʱĿ¼б)Ҳڿдʱresume
+	static TransferPtr bufferTransfer(std::string data, uint64_t sentBefore);
+
+	//ÿֵһƬ͵ʱ෢͵ļֽ,ҲREADԵ
+	static const size_t SLICE_BYTES = 256 * 1024;
+
+	//û׼:socketpairϱȽֲ,ݴֵ
+	bool calibrate();
+
+	Stats stats();
+	std::string statsJson();
+
+	static const char* strategyName(Strategy s);
+
+	//mmapļﵽٴηʲȵ
+	static const unsigned HOT_HITS = 2;
+
+private:
+	struct Mapping
+	{
+		void* addr;
+		size_t len;
+		dev_t dev;
+		ino_t ino;
+		struct timespec mtime;
+		unsigned long lastUsed;
+
+		Mapping() : addr(nullptr), len(0), dev(0), ino(0), mtime(), lastUsed(0) {}
+		~Mapping();
+	};
+
+	//ȡļĹӳ,ļѱ仯ʱӳ,ʧܷnullptr
+	MappingPtr acquireMapping(const std::string& path, int fd, const struct stat& st, bool* reused = nullptr);
+	void evictLocked();
+
+	//transferĲԷ,budgetֽ,ͳ
+	Progress pump(int cfd, Transfer& transfer, size_t budget);
+	//һֱ͵,socketдʱȴд
+	bool sendAll(int cfd, Transfer& transfer);
+	//READ:ļһ,ûͷһwritev
+	ssize_t writeRead(int cfd, const Transfer& transfer, size_t headLeft, size_t body);
+
+	std::atomic<size_t> smallMax_;
+	std::atomic<size_t> mmapMax_;
+	size_t mmapCacheBytes_;
+
+	pthread_mutex_t mutex_;
+	std::unordered_map<std::string, MappingPtr> maps_;
+	std::unordered_map<std::string, unsigned> hits_;
+	std::unordered_map<std::string, std::vector<Continuation>> loading_;	//ڼصļ͵ȴ
+	size_t mappedBytes_;
+	unsigned long tick_;	//ڽLRU
+
+	std::atomic<uint64_t> files_[STRATEGY_COUNT];
+	std::atomic<uint64_t> bytes_[STRATEGY_COUNT];
+	std::atomic<uint64_t> loads_;
+	std::atomic<uint64_t> coalesced_;
+
+	static const size_t MAX_TRACKED_HITS = 4096;
+};
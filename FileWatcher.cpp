@@ -0,0 +1,114 @@
+#include "FileWatcher.h"
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <iostream>
+
+//Ŀ¼ݻĿ¼仯ʱҪĵ¼
+static const uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB |
+	IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+
+FileWatcher::FileWatcher()
+{
+	pthread_mutex_init(&mutex_, NULL);
+	inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotifyFd_ == -1)
+	{
+		perror("inotify_init1");
+	}
+}
+
+FileWatcher::~FileWatcher()
+{
+	if (inotifyFd_ != -1)close(inotifyFd_);
+	pthread_mutex_destroy(&mutex_);
+}
+
+bool FileWatcher::watchDir(const std::string& dir)
+{
+	if (inotifyFd_ == -1)return false;
+
+	pthread_mutex_lock(&mutex_);
+	if (dirToWd_.count(dir))
+	{
+		pthread_mutex_unlock(&mutex_);
+		return true;
+	}
+
+	int wd = inotify_add_watch(inotifyFd_, dir.c_str(), WATCH_MASK | IN_ONLYDIR);
+	if (wd == -1)
+	{
+		pthread_mutex_unlock(&mutex_);
+		perror("inotify_add_watch");
+		return false;
+	}
+	wdToDir_[wd] = dir;
+	dirToWd_[dir] = wd;
+	pthread_mutex_unlock(&mutex_);
+	return true;
+}
+
+void FileWatcher::addListener(Listener listener)
+{
+	listeners_.push_back(listener);
+}
+
+void FileWatcher::handleEvents()
+{
+	//inotify_event䳤ļ,ٷ뻺
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+	while (true)
+	{
+		ssize_t len = read(inotifyFd_, buf, sizeof(buf));
+		if (len <= 0)
+		{
+			if (len == -1 && errno != EAGAIN && errno != EINTR)
+			{
+				perror("read inotify");
+			}
+			break;
+		}
+
+		for (char* p = buf; p < buf + len; )
+		{
+			const struct inotify_event* ev = reinterpret_cast<const struct inotify_event*>(p);
+			p += sizeof(struct inotify_event) + ev->len;
+
+			if (ev->mask & IN_Q_OVERFLOW)
+			{
+				//¼ʧ,޷֪ЩĿ¼,֪ͨȫʧЧ
+				std::cout << "inotify,ȫʧЧ" << std::endl;
+				dispatch("", "", ev->mask);
+				continue;
+			}
+
+			std::string dir;
+			pthread_mutex_lock(&mutex_);
+			auto it = wdToDir_.find(ev->wd);
+			if (it != wdToDir_.end())
+			{
+				dir = it->second;
+				//watchѱںƳ(Ŀ¼ɾ)
+				if (ev->mask & IN_IGNORED)
+				{
+					dirToWd_.erase(dir);
+					wdToDir_.erase(it);
+				}
+			}
+			pthread_mutex_unlock(&mutex_);
+
+			if (dir.empty())continue;
+			dispatch(dir, ev->len > 0 ? std::string(ev->name) : std::string(), ev->mask);
+		}
+	}
+}
+
+void FileWatcher::dispatch(const std::string& dir, const std::string& name, uint32_t mask)
+{
+	for (auto& listener : listeners_)
+	{
+		listener(dir, name, mask);
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <string>
+#include <map>
+#include <vector>
+#include <functional>
+#include <stdint.h>
+#include <pthread.h>
+
+
+//inotifyװ:watchһfd,reactorעᵽepollͳһַ
+class FileWatcher
+{
+public:
+	//ص:仯Ŀ¼,Ŀ¼±仯ļ(Ŀ¼仯ʱΪ),¼
+	//(IN_Q_OVERFLOW)ʱdirΪ,ʾл涼ӦʧЧ
+	using Listener = std::function<void(const std::string& dir, const std::string& name, uint32_t mask)>;
+
+	FileWatcher();
+	~FileWatcher();
+
+	int fd() const { return inotifyFd_; }
+
+	//һĿ¼(ǵݹ),Ѽֱӷtrue,ڹ߳е
+	bool watchDir(const std::string& dir);
+
+	//עص,Ӧreactorǰ
+	void addListener(Listener listener);
+
+	//ȡַд¼(reactor߳е)
+	void handleEvents();
+
+private:
+	void dispatch(const std::string& dir, const std::string& name, uint32_t mask);
+
+	int inotifyFd_;
+	pthread_mutex_t mutex_;
+	std::map<int, std::string> wdToDir_;
+	std::map<std::string, int> dirToWd_;
+	std::vector<Listener> listeners_;
+};
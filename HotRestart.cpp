@@ -0,0 +1,231 @@
+#include "HotRestart.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <iostream>
+
+//һഫݵļsocket
+static const int MAX_HANDOFF_FDS = 16;
+//Ϣͷ:ħ + socket + ճ
+static const char HANDOFF_MAGIC[4] = { 'H', 'R', 'v', '1' };
+
+struct HandoffHeader
+{
+	char magic[4];
+	uint32_t fdCount;
+	uint32_t snapshotLen;
+};
+
+static bool fillAddr(const std::string& path, struct sockaddr_un& addr)
+{
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path))
+	{
+		std::cout << "socket·:" << path << std::endl;
+		return false;
+	}
+	strcpy(addr.sun_path, path.c_str());
+	return true;
+}
+
+static void setTimeout(int fd, int timeoutMs)
+{
+	struct timeval tv;
+	tv.tv_sec = timeoutMs / 1000;
+	tv.tv_usec = (timeoutMs % 1000) * 1000;
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+HotRestart::HotRestart(const std::string& path)
+	: path_(path), controlFd_(-1)
+{
+}
+
+HotRestart::~HotRestart()
+{
+	if (controlFd_ != -1)::close(controlFd_);
+}
+
+bool HotRestart::takeover(std::vector<int>& fds, std::string& snapshot, int timeoutMs)
+{
+	struct sockaddr_un addr;
+	if (!fillAddr(path_, addr))return false;
+
+	int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (sock == -1)
+	{
+		perror("socket:hot restart");
+		return false;
+	}
+	//ûоɽڼ(ļڻܾ),
+	if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == -1)
+	{
+		::close(sock);
+		return false;
+	}
+	setTimeout(sock, timeoutMs);
+
+	HandoffHeader header;
+	char control[CMSG_SPACE(sizeof(int) * MAX_HANDOFF_FDS)];
+	struct iovec iov = { &header, sizeof(header) };
+	struct msghdr msg = {};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	ssize_t n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+	if (n != static_cast<ssize_t>(sizeof(header)) || memcmp(header.magic, HANDOFF_MAGIC, 4) != 0)
+	{
+		std::cout << "ʧ" << std::endl;
+		::close(sock);
+		return false;
+	}
+
+	fds.clear();
+	for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+	{
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+		{
+			size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			const int* p = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+			fds.assign(p, p + count);
+		}
+	}
+
+	//տܽϴ,fd֮ȡ
+	snapshot.clear();
+	snapshot.resize(header.snapshotLen);
+	size_t got = 0;
+	while (got < snapshot.size())
+	{
+		ssize_t r = recv(sock, &snapshot[got], snapshot.size() - got, 0);
+		if (r <= 0)
+		{
+			if (r < 0 && errno == EINTR)continue;
+			//ֻԤ,ʧӰӹ
+			snapshot.resize(got);
+			break;
+		}
+		got += r;
+	}
+	::close(sock);
+
+	std::cout << "ѴӾɽ̽ӹ" << fds.size() << "socket," << snapshot.size() << "ֽ" << std::endl;
+	return !fds.empty();
+}
+
+bool HotRestart::listen()
+{
+	struct sockaddr_un addr;
+	if (!fillAddr(path_, addr))return false;
+
+	controlFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (controlFd_ == -1)
+	{
+		perror("socket:hot restart");
+		return false;
+	}
+	//ǰνµsocketļ,ʱѾɽ
+	unlink(path_.c_str());
+	if (bind(controlFd_, (struct sockaddr*)&addr, sizeof(addr)) == -1 ||
+		::listen(controlFd_, 1) == -1)
+	{
+		perror("bind:hot restart");
+		::close(controlFd_);
+		controlFd_ = -1;
+		return false;
+	}
+	return true;
+}
+
+bool HotRestart::handoff(const std::vector<int>& fds, const std::string& snapshot)
+{
+	int sock = accept4(controlFd_, NULL, NULL, SOCK_CLOEXEC);
+	if (sock == -1)
+	{
+		if (errno != EAGAIN && errno != EWOULDBLOCK)perror("accept:hot restart");
+		return false;
+	}
+	if (fds.empty() || fds.size() > static_cast<size_t>(MAX_HANDOFF_FDS))
+	{
+		::close(sock);
+		return false;
+	}
+	//socketֻͬһû(root)Ľ,socketļȨ޲Ա֤һ
+	struct ucred cred;
+	socklen_t credLen = sizeof(cred);
+	if (getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &credLen) == -1)
+	{
+		perror("getsockopt:SO_PEERCRED");
+		::close(sock);
+		return false;
+	}
+	if (cred.uid != 0 && cred.uid != geteuid())
+	{
+		std::cout << "ܾ:Զ˽" << cred.pid << "uidΪ" << cred.uid << std::endl;
+		::close(sock);
+		return false;
+	}
+	setTimeout(sock, 2000);
+
+	HandoffHeader header;
+	memcpy(header.magic, HANDOFF_MAGIC, 4);
+	header.fdCount = static_cast<uint32_t>(fds.size());
+	header.snapshotLen = static_cast<uint32_t>(snapshot.size());
+
+	char control[CMSG_SPACE(sizeof(int) * MAX_HANDOFF_FDS)];
+	memset(control, 0, sizeof(control));
+	struct iovec iov = { &header, sizeof(header) };
+	struct msghdr msg = {};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+	memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+
+	if (sendmsg(sock, &msg, MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(header)))
+	{
+		perror("sendmsg:hot restart");
+		::close(sock);
+		return false;
+	}
+
+	size_t sent = 0;
+	while (sent < snapshot.size())
+	{
+		ssize_t n = send(sock, snapshot.data() + sent, snapshot.size() - sent, MSG_NOSIGNAL);
+		if (n <= 0)
+		{
+			if (n < 0 && errno == EINTR)continue;
+			break;
+		}
+		sent += n;
+	}
+	::close(sock);
+	std::cout << "socketѽν" << std::endl;
+	return true;
+}
+
+void HotRestart::close(bool unlinkPath)
+{
+	if (controlFd_ != -1)
+	{
+		::close(controlFd_);
+		controlFd_ = -1;
+		if (unlinkPath)unlink(path_.c_str());
+	}
+}
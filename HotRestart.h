@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <vector>
+
+
+//:½ͨUNIX socketӾɽ̽ӹܼsocket(SCM_RIGHTS),
+//ɽֹͣacceptڴ
+class HotRestart
+{
+public:
+	explicit HotRestart(const std::string& path);
+	~HotRestart();
+
+	//ԴӾɽ̽ӹܼsocket,·ûоɽʱfalse
+	//snapshotΪɽ̸ȵļб(ÿһurl)
+	bool takeover(std::vector<int>& fds, std::string& snapshot, int timeoutMs);
+
+	//socket,ȴν
+	bool listen();
+	int fd() const { return controlFd_; }
+
+	//socketɶʱ:ѼsocketͿսν
+	bool handoff(const std::vector<int>& fds, const std::string& snapshot);
+
+	//رտsocket,unlinkPathΪtrueʱͬʱɾsocketļ
+	void close(bool unlinkPath);
+
+	const std::string& path() const { return path_; }
+
+private:
+	std::string path_;
+	int controlFd_;
+};
@@ -0,0 +1,440 @@
+#include "Hpack.h"
+#include <unordered_map>
+#include <string.h>
+
+struct StaticEntry
+{
+	const char* name;
+	const char* value;
+};
+
+//RFC 7541¼Aľ̬,1ʼ
+static const StaticEntry STATIC_TABLE[] = {
+	{ ":authority", "" },
+	{ ":method", "GET" },
+	{ ":method", "POST" },
+	{ ":path", "/" },
+	{ ":path", "/index.html" },
+	{ ":scheme", "http" },
+	{ ":scheme", "https" },
+	{ ":status", "200" },
+	{ ":status", "204" },
+	{ ":status", "206" },
+	{ ":status", "304" },
+	{ ":status", "400" },
+	{ ":status", "404" },
+	{ ":status", "500" },
+	{ "accept-charset", "" },
+	{ "accept-encoding", "gzip, deflate" },
+	{ "accept-language", "" },
+	{ "accept-ranges", "" },
+	{ "accept", "" },
+	{ "access-control-allow-origin", "" },
+	{ "age", "" },
+	{ "allow", "" },
+	{ "authorization", "" },
+	{ "cache-control", "" },
+	{ "content-disposition", "" },
+	{ "content-encoding", "" },
+	{ "content-language", "" },
+	{ "content-length", "" },
+	{ "content-location", "" },
+	{ "content-range", "" },
+	{ "content-type", "" },
+	{ "cookie", "" },
+	{ "date", "" },
+	{ "etag", "" },
+	{ "expect", "" },
+	{ "expires", "" },
+	{ "from", "" },
+	{ "host", "" },
+	{ "if-match", "" },
+	{ "if-modified-since", "" },
+	{ "if-none-match", "" },
+	{ "if-range", "" },
+	{ "if-unmodified-since", "" },
+	{ "last-modified", "" },
+	{ "link", "" },
+	{ "location", "" },
+	{ "max-forwards", "" },
+	{ "proxy-authenticate", "" },
+	{ "proxy-authorization", "" },
+	{ "range", "" },
+	{ "referer", "" },
+	{ "refresh", "" },
+	{ "retry-after", "" },
+	{ "server", "" },
+	{ "set-cookie", "" },
+	{ "strict-transport-security", "" },
+	{ "transfer-encoding", "" },
+	{ "user-agent", "" },
+	{ "vary", "" },
+	{ "via", "" },
+	{ "www-authenticate", "" },
+};
+
+static const size_t STATIC_COUNT = sizeof(STATIC_TABLE) / sizeof(STATIC_TABLE[0]);
+
+//RFC 7541¼BĻ,±Ϊֵֽ
+static const uint32_t HUFFMAN_CODES[256] = {
+	0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+	0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+	0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+	0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+	0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+	0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+	0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+	0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+	0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+	0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+	0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+	0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+	0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+	0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+	0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+	0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+	0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+	0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+	0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+	0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+	0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+	0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+	0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+	0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+	0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+	0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+	0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+	0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+	0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+	0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+	0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+	0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+};
+static const uint8_t HUFFMAN_LENGTHS[256] = {
+	13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+	28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+	6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+	5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+	13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+	15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+	6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+	20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+	24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+	22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+	21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+	26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+	19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+	20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+	26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+};
+
+//ʱõľ̬:ֵһͬĿ,ֵּȫƥĿ
+struct StaticIndex
+{
+	std::unordered_map<std::string, int> names;
+	std::unordered_map<std::string, int> pairs;
+
+	StaticIndex()
+	{
+		for (size_t i = STATIC_COUNT; i > 0; i--)
+		{
+			std::string name = STATIC_TABLE[i - 1].name;
+			names[name] = static_cast<int>(i);
+			pairs[name + '\0' + STATIC_TABLE[i - 1].value] = static_cast<int>(i);
+		}
+	}
+
+	static const StaticIndex& instance()
+	{
+		static StaticIndex index;
+		return index;
+	}
+};
+
+//,λӸߵҶ
+struct HuffmanTree
+{
+	struct Node
+	{
+		int child[2] = { -1, -1 };
+		int symbol = -1;
+	};
+	std::vector<Node> nodes;
+
+	HuffmanTree()
+	{
+		nodes.emplace_back();
+		for (int sym = 0; sym < 256; sym++)
+		{
+			int cur = 0;
+			for (int bit = HUFFMAN_LENGTHS[sym] - 1; bit >= 0; bit--)
+			{
+				int b = (HUFFMAN_CODES[sym] >> bit) & 1;
+				if (nodes[cur].child[b] == -1)
+				{
+					nodes[cur].child[b] = static_cast<int>(nodes.size());
+					nodes.emplace_back();
+				}
+				cur = nodes[cur].child[b];
+			}
+			nodes[cur].symbol = sym;
+		}
+	}
+
+	static const HuffmanTree& instance()
+	{
+		static HuffmanTree tree;
+		return tree;
+	}
+};
+
+namespace hpack
+{
+	void encodeInt(uint64_t value, int prefixBits, uint8_t firstByte, std::string& out)
+	{
+		uint64_t max = (1u << prefixBits) - 1;
+		if (value < max)
+		{
+			out += static_cast<char>(firstByte | value);
+			return;
+		}
+		out += static_cast<char>(firstByte | max);
+		value -= max;
+		while (value >= 128)
+		{
+			out += static_cast<char>((value & 0x7f) | 0x80);
+			value >>= 7;
+		}
+		out += static_cast<char>(value);
+	}
+
+	bool decodeInt(const uint8_t*& p, const uint8_t* end, int prefixBits, uint64_t& value)
+	{
+		if (p >= end)return false;
+		uint64_t max = (1u << prefixBits) - 1;
+		value = *p++ & max;
+		if (value < max)return true;
+		int shift = 0;
+		while (p < end)
+		{
+			uint8_t b = *p++;
+			value += static_cast<uint64_t>(b & 0x7f) << shift;
+			if (!(b & 0x80))return true;
+			shift += 7;
+			if (shift > 56)return false;
+		}
+		return false;
+	}
+
+	void encodeString(std::string_view s, std::string& out)
+	{
+		//Ӧͷܶ,
+		encodeInt(s.size(), 7, 0x00, out);
+		out.append(s.data(), s.size());
+	}
+
+	bool decodeString(const uint8_t*& p, const uint8_t* end, std::string& out)
+	{
+		if (p >= end)return false;
+		bool huffman = (*p & 0x80) != 0;
+		uint64_t len = 0;
+		if (!decodeInt(p, end, 7, len) || len > static_cast<uint64_t>(end - p))return false;
+		out.clear();
+		bool ok = true;
+		if (huffman)ok = huffmanDecode(p, static_cast<size_t>(len), out);
+		else out.assign(reinterpret_cast<const char*>(p), static_cast<size_t>(len));
+		p += len;
+		return ok;
+	}
+
+	bool huffmanDecode(const uint8_t* p, size_t len, std::string& out)
+	{
+		const HuffmanTree& tree = HuffmanTree::instance();
+		int cur = 0;
+		int depth = 0;		//ǰδɵѾ˼λ
+		bool allOnes = true;	//⼸λǷȫΪ1(ֻǺϷ)
+		for (size_t i = 0; i < len; i++)
+		{
+			for (int bit = 7; bit >= 0; bit--)
+			{
+				int b = (p[i] >> bit) & 1;
+				cur = tree.nodes[cur].child[b];
+				//ߵڵķֻ֧EOS(301)
+				if (cur == -1)return false;
+				depth++;
+				allOnes = allOnes && b == 1;
+				if (tree.nodes[cur].symbol != -1)
+				{
+					out += static_cast<char>(tree.nodes[cur].symbol);
+					cur = 0;
+					depth = 0;
+					allOnes = true;
+				}
+			}
+		}
+		//βEOSǰ׺,Ҳ7λ
+		return depth < 8 && allOnes;
+	}
+}
+
+void HpackTable::evict(size_t limit)
+{
+	while (size_ > limit && !entries_.empty())
+	{
+		size_ -= entries_.back().first.size() + entries_.back().second.size() + 32;
+		entries_.pop_back();
+	}
+}
+
+void HpackTable::add(const std::string& name, const std::string& value)
+{
+	size_t entry = name.size() + value.size() + 32;
+	//Ŀձ
+	if (entry > maxSize_)
+	{
+		evict(0);
+		return;
+	}
+	evict(maxSize_ - entry);
+	entries_.emplace_front(name, value);
+	size_ += entry;
+}
+
+void HpackTable::setMaxSize(size_t maxSize)
+{
+	maxSize_ = maxSize;
+	evict(maxSize_);
+}
+
+bool HpackDecoder::lookup(uint64_t index, std::string& name, std::string& value) const
+{
+	if (index == 0)return false;
+	if (index <= STATIC_COUNT)
+	{
+		name = STATIC_TABLE[index - 1].name;
+		value = STATIC_TABLE[index - 1].value;
+		return true;
+	}
+	index -= STATIC_COUNT + 1;
+	if (index >= table_.count())return false;
+	name = table_.at(static_cast<size_t>(index)).first;
+	value = table_.at(static_cast<size_t>(index)).second;
+	return true;
+}
+
+bool HpackDecoder::decode(const uint8_t* p, size_t len, HeaderList& headers)
+{
+	const uint8_t* end = p + len;
+	bool sawHeader = false;
+	while (p < end)
+	{
+		uint8_t b = *p;
+		std::string name, value;
+		if (b & 0x80)
+		{
+			//
+			uint64_t index;
+			if (!hpack::decodeInt(p, end, 7, index) || !lookup(index, name, value))return false;
+		}
+		else if ((b & 0xe0) == 0x20)
+		{
+			//̬Сֻܳͷ鿪ͷ
+			uint64_t size;
+			if (sawHeader || !hpack::decodeInt(p, end, 5, size) || size > limit_)return false;
+			table_.setMaxSize(static_cast<size_t>(size));
+			continue;
+		}
+		else
+		{
+			//0x40:붯̬;0x00:;0x10:
+			bool addToTable = (b & 0xc0) == 0x40;
+			uint64_t index;
+			if (!hpack::decodeInt(p, end, addToTable ? 6 : 4, index))return false;
+			if (index == 0)
+			{
+				if (!hpack::decodeString(p, end, name))return false;
+			}
+			else if (!lookup(index, name, value))
+			{
+				return false;
+			}
+			if (!hpack::decodeString(p, end, value))return false;
+			if (addToTable)table_.add(name, value);
+		}
+		sawHeader = true;
+		headers.emplace_back(std::move(name), std::move(value));
+	}
+	return true;
+}
+
+void HpackEncoder::setMaxTableSize(size_t size)
+{
+	//ʹ4096ֽ,ԶҲ
+	if (size > 4096)size = 4096;
+	if (size == table_.maxSize())return;
+	table_.setMaxSize(size);
+	pendingResize_ = true;
+}
+
+void HpackEncoder::beginBlock(std::string& out)
+{
+	if (!pendingResize_)return;
+	hpack::encodeInt(table_.maxSize(), 5, 0x20, out);
+	pendingResize_ = false;
+}
+
+void HpackEncoder::encodeStatus(int status, std::string& out)
+{
+	//̬8~14
+	switch (status)
+	{
+	case 200: out += static_cast<char>(0x88); return;
+	case 204: out += static_cast<char>(0x89); return;
+	case 206: out += static_cast<char>(0x8a); return;
+	case 304: out += static_cast<char>(0x8b); return;
+	case 400: out += static_cast<char>(0x8c); return;
+	case 404: out += static_cast<char>(0x8d); return;
+	case 500: out += static_cast<char>(0x8e); return;
+	default: break;
+	}
+	encode(":status", std::to_string(status), out, true);
+}
+
+void HpackEncoder::encode(std::string_view name, std::string_view value, std::string& out, bool index)
+{
+	const StaticIndex& statics = StaticIndex::instance();
+	std::string key(name);
+
+	//̬ȫͬĿ:һֽ
+	uint64_t nameIndex = 0;
+	for (size_t i = 0; i < table_.count(); i++)
+	{
+		const auto& entry = table_.at(i);
+		if (entry.first != name)continue;
+		if (entry.second == value)
+		{
+			hpack::encodeInt(STATIC_COUNT + 1 + i, 7, 0x80, out);
+			return;
+		}
+		if (nameIndex == 0)nameIndex = STATIC_COUNT + 1 + i;
+	}
+
+	key += '\0';
+	key.append(value.data(), value.size());
+	auto exact = statics.pairs.find(key);
+	if (exact != statics.pairs.end())
+	{
+		hpack::encodeInt(exact->second, 7, 0x80, out);
+		return;
+	}
+	key.resize(name.size());
+	auto named = statics.names.find(key);
+	if (named != statics.names.end())nameIndex = named->second;
+
+	if (index)hpack::encodeInt(nameIndex, 6, 0x40, out);
+	else hpack::encodeInt(nameIndex, 4, 0x00, out);
+	if (nameIndex == 0)hpack::encodeString(name, out);
+	hpack::encodeString(value, out);
+	if (index)table_.add(std::string(name), std::string(value));
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <utility>
+#include <stdint.h>
+#include <stddef.h>
+
+
+//HTTP/2ͷѹ(RFC 7541)
+using HeaderList = std::vector<std::pair<std::string, std::string>>;
+
+//̬,Ŀǰ;ÿĿֳ+ֵ+32С
+class HpackTable
+{
+public:
+	explicit HpackTable(size_t maxSize) : size_(0), maxSize_(maxSize) {}
+
+	void add(const std::string& name, const std::string& value);
+	void setMaxSize(size_t maxSize);
+	size_t maxSize() const { return maxSize_; }
+
+	size_t count() const { return entries_.size(); }
+	//index0ʼ,0ΪµĿ
+	const std::pair<std::string, std::string>& at(size_t index) const { return entries_[index]; }
+
+private:
+	void evict(size_t limit);
+
+	std::deque<std::pair<std::string, std::string>> entries_;
+	size_t size_;
+	size_t maxSize_;
+};
+
+class HpackDecoder
+{
+public:
+	//maxSizeΪͨSETTINGS_HEADER_TABLE_SIZE
+	explicit HpackDecoder(size_t maxSize = 4096) : table_(maxSize), limit_(maxSize) {}
+
+	//һͷ(HEADERSCONTINUATION),ʧܱʾӼCOMPRESSION_ERROR
+	bool decode(const uint8_t* p, size_t len, HeaderList& headers);
+
+private:
+	bool lookup(uint64_t index, std::string& name, std::string& value) const;
+
+	HpackTable table_;
+	size_t limit_;
+};
+
+class HpackEncoder
+{
+public:
+	HpackEncoder() : table_(4096), pendingResize_(false) {}
+
+	//Զ˵SETTINGS_HEADER_TABLE_SIZE,һͷ鿪ͷС
+	void setMaxTableSize(size_t size);
+
+	//״̬þ̬ĵֽڱ,״̬붯̬
+	void encodeStatus(int status, std::string& out);
+	//indexΪfalseʱ붯̬(ÿζֵͬ,content-length)
+	void encode(std::string_view name, std::string_view value, std::string& out, bool index = true);
+
+	//ÿͷ鿪ʼʱ,ıС
+	void beginBlock(std::string& out);
+
+private:
+	HpackTable table_;
+	bool pendingResize_;
+};
+
+//ַĻ,HTTP/2ҲԸ
+namespace hpack
+{
+	void encodeInt(uint64_t value, int prefixBits, uint8_t firstByte, std::string& out);
+	bool decodeInt(const uint8_t*& p, const uint8_t* end, int prefixBits, uint64_t& value);
+	void encodeString(std::string_view s, std::string& out);
+	bool decodeString(const uint8_t*& p, const uint8_t* end, std::string& out);
+	bool huffmanDecode(const uint8_t* p, size_t len, std::string& out);
+}
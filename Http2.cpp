@@ -0,0 +1,837 @@
+#include "Http2.h"
+#include "TlsTerminator.h"
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <algorithm>
+
+static const char PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+static const size_t PREFACE_LEN = sizeof(PREFACE) - 1;
+static const size_t FRAME_HEADER_LEN = 9;
+//һserve,ټ,һռùڴ
+static const size_t INPUT_LIMIT = 256 * 1024;
+static const int64_t MAX_WINDOW = 0x7fffffff;
+
+enum FrameType : uint8_t
+{
+	FRAME_DATA = 0,
+	FRAME_HEADERS = 1,
+	FRAME_PRIORITY = 2,
+	FRAME_RST_STREAM = 3,
+	FRAME_SETTINGS = 4,
+	FRAME_PUSH_PROMISE = 5,
+	FRAME_PING = 6,
+	FRAME_GOAWAY = 7,
+	FRAME_WINDOW_UPDATE = 8,
+	FRAME_CONTINUATION = 9
+};
+
+enum FrameFlag : uint8_t
+{
+	FLAG_END_STREAM = 0x1,
+	FLAG_ACK = 0x1,
+	FLAG_END_HEADERS = 0x4,
+	FLAG_PADDED = 0x8,
+	FLAG_PRIORITY = 0x20
+};
+
+enum ErrorCode : uint32_t
+{
+	H2_NO_ERROR = 0x0,
+	H2_PROTOCOL_ERROR = 0x1,
+	H2_INTERNAL_ERROR = 0x2,
+	H2_FLOW_CONTROL_ERROR = 0x3,
+	H2_STREAM_CLOSED = 0x5,
+	H2_FRAME_SIZE_ERROR = 0x6,
+	H2_REFUSED_STREAM = 0x7,
+	H2_COMPRESSION_ERROR = 0x9,
+	H2_ENHANCE_YOUR_CALM = 0xb
+};
+
+enum SettingId : uint16_t
+{
+	SETTINGS_HEADER_TABLE_SIZE = 0x1,
+	SETTINGS_ENABLE_PUSH = 0x2,
+	SETTINGS_MAX_CONCURRENT_STREAMS = 0x3,
+	SETTINGS_INITIAL_WINDOW_SIZE = 0x4,
+	SETTINGS_MAX_FRAME_SIZE = 0x5
+};
+
+std::atomic<long> Http2Session::sessions_{ 0 };
+std::atomic<long> Http2Session::streamsTotal_{ 0 };
+std::atomic<long> Http2Session::refused_{ 0 };
+std::atomic<long> Http2Session::protocolErrors_{ 0 };
+
+static uint32_t get32(const uint8_t* p)
+{
+	return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+		(static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+static void put32(uint8_t* p, uint32_t v)
+{
+	p[0] = static_cast<uint8_t>(v >> 24);
+	p[1] = static_cast<uint8_t>(v >> 16);
+	p[2] = static_cast<uint8_t>(v >> 8);
+	p[3] = static_cast<uint8_t>(v);
+}
+
+static void appendFrameHeader(std::string& out, size_t len, uint8_t type, uint8_t flags, uint32_t id)
+{
+	uint8_t h[FRAME_HEADER_LEN];
+	h[0] = static_cast<uint8_t>(len >> 16);
+	h[1] = static_cast<uint8_t>(len >> 8);
+	h[2] = static_cast<uint8_t>(len);
+	h[3] = type;
+	h[4] = flags;
+	put32(h + 5, id & 0x7fffffff);
+	out.append(reinterpret_cast<const char*>(h), sizeof(h));
+}
+
+//HTTP/2вֵͷ
+static bool isConnectionHeader(const std::string& name)
+{
+	return name == "connection" || name == "keep-alive" || name == "proxy-connection" ||
+		name == "transfer-encoding" || name == "upgrade";
+}
+
+static std::string errorBody(int status, const char* descr)
+{
+	return "<html><body><h1>" + std::to_string(status) + " " + descr + "</h1></body></html>";
+}
+
+Http2Session::Http2Session(int fd, SSL* ssl, int64_t maxBody, RequestCallback onRequest)
+	: fd_(fd), ssl_(ssl), maxBody_(maxBody), onRequest_(std::move(onRequest)), result_(Result::WAIT_READ),
+	outOffset_(0), prefaceDone_(false), settingsSent_(false), eof_(false), closing_(false), peerGoaway_(false),
+	headerStream_(0), headerFlags_(0), lastStreamId_(0),
+	connSendWindow_(65535), peerInitialWindow_(65535), peerMaxFrame_(MAX_FRAME_SIZE)
+{
+	sessions_++;
+}
+
+Http2Session::~Http2Session()
+{
+	for (auto& pair : streams_)
+	{
+		if (pair.second.fileFd != -1)close(pair.second.fileFd);
+	}
+}
+
+int Http2Session::matchPreface(const char* p, size_t n)
+{
+	size_t m = n < PREFACE_LEN ? n : PREFACE_LEN;
+	if (memcmp(p, PREFACE, m) != 0)return -1;
+	return n >= PREFACE_LEN ? 1 : 0;
+}
+
+void Http2Session::feed(const char* p, size_t n)
+{
+	in_.append(p, n);
+}
+
+Http2Session::Result Http2Session::serve()
+{
+	if (result_ == Result::CLOSE)return result_;
+
+	if (!settingsSent_)
+	{
+		//˵SETTINGSǵһ֡;ͬʱŴӼմ,ϴʱÿ64KBһWINDOW_UPDATE
+		settingsSent_ = true;
+		uint8_t settings[6] = { 0, SETTINGS_MAX_CONCURRENT_STREAMS };
+		put32(settings + 2, MAX_CONCURRENT_STREAMS);
+		writeFrame(FRAME_SETTINGS, 0, 0, settings, sizeof(settings));
+		uint8_t inc[4];
+		put32(inc, RECV_WINDOW - 65535);
+		writeFrame(FRAME_WINDOW_UPDATE, 0, 0, inc, sizeof(inc));
+	}
+
+	for (;;)
+	{
+		int r = (eof_ || closing_) ? 0 : readInput();
+		if (r < 0)eof_ = true;
+
+		if (!prefaceDone_)
+		{
+			int m = matchPreface(in_.data(), in_.size());
+			if (m < 0 || (m == 0 && eof_))return result_ = Result::CLOSE;
+			if (m == 1)
+			{
+				prefaceDone_ = true;
+				in_.erase(0, PREFACE_LEN);
+			}
+		}
+		if (prefaceDone_ && !closing_ && processInput())
+		{
+			runRequests();
+		}
+
+		fillOutput();
+		int f = flush();
+		if (f < 0)return result_ = Result::CLOSE;
+		if (f == 0)return result_ = Result::WAIT_WRITE;
+
+		//GOAWAYѾ,߶Զѹر,߶Զ˷GOAWAY
+		if (closing_ || eof_ || (peerGoaway_ && streams_.empty()))return result_ = Result::CLOSE;
+		//socketѶ,ûпԷ͵(ʹʱȶԶ˵WINDOW_UPDATE)
+		if (r == 0 && (ready_.empty() || connSendWindow_ <= 0))return result_ = Result::WAIT_READ;
+	}
+}
+
+int Http2Session::readInput()
+{
+	char buf[16384];
+	bool got = false;
+	for (;;)
+	{
+		if (in_.size() >= INPUT_LIMIT)return 1;
+		ssize_t n = ssl_ != nullptr ? TlsTerminator::read(ssl_, buf, sizeof(buf)) : recv(fd_, buf, sizeof(buf), 0);
+		if (n > 0)
+		{
+			in_.append(buf, n);
+			got = true;
+			continue;
+		}
+		if (n == 0)return -1;
+		if (errno == EINTR)continue;
+		if (errno == EAGAIN || errno == EWOULDBLOCK)return got ? 1 : 0;
+		return -1;
+	}
+}
+
+bool Http2Session::processInput()
+{
+	size_t pos = 0;
+	bool ok = true;
+	while (ok && in_.size() - pos >= FRAME_HEADER_LEN)
+	{
+		const uint8_t* h = reinterpret_cast<const uint8_t*>(in_.data()) + pos;
+		uint32_t len = (static_cast<uint32_t>(h[0]) << 16) | (static_cast<uint32_t>(h[1]) << 8) | h[2];
+		uint8_t type = h[3];
+		uint8_t flags = h[4];
+		uint32_t id = get32(h + 5) & 0x7fffffff;
+		if (len > MAX_FRAME_SIZE)
+		{
+			ok = connectionError(H2_FRAME_SIZE_ERROR);
+			break;
+		}
+		if (in_.size() - pos < FRAME_HEADER_LEN + len)break;
+		const uint8_t* p = h + FRAME_HEADER_LEN;
+		pos += FRAME_HEADER_LEN + len;
+
+		//ͷ,м䲻ܲ֡
+		if (headerStream_ != 0 && (type != FRAME_CONTINUATION || id != headerStream_))
+		{
+			ok = connectionError(H2_PROTOCOL_ERROR);
+			break;
+		}
+
+		switch (type)
+		{
+		case FRAME_DATA:
+			ok = onData(flags, id, p, len);
+			break;
+		case FRAME_HEADERS:
+			ok = onHeaders(flags, id, p, len);
+			break;
+		case FRAME_PRIORITY:
+			//ȼ,
+			if (id == 0)ok = connectionError(H2_PROTOCOL_ERROR);
+			else if (len != 5)resetStream(id, H2_FRAME_SIZE_ERROR);
+			break;
+		case FRAME_RST_STREAM:
+			if (id == 0 || id > lastStreamId_)ok = connectionError(H2_PROTOCOL_ERROR);
+			else if (len != 4)ok = connectionError(H2_FRAME_SIZE_ERROR);
+			else closeStream(id);
+			break;
+		case FRAME_SETTINGS:
+			ok = onSettings(flags, id, p, len);
+			break;
+		case FRAME_PUSH_PROMISE:
+			//ͻ˲
+			ok = connectionError(H2_PROTOCOL_ERROR);
+			break;
+		case FRAME_PING:
+			if (id != 0)ok = connectionError(H2_PROTOCOL_ERROR);
+			else if (len != 8)ok = connectionError(H2_FRAME_SIZE_ERROR);
+			else if (!(flags & FLAG_ACK))writeFrame(FRAME_PING, FLAG_ACK, 0, p, len);
+			break;
+		case FRAME_GOAWAY:
+			if (id != 0)ok = connectionError(H2_PROTOCOL_ERROR);
+			else peerGoaway_ = true;
+			break;
+		case FRAME_WINDOW_UPDATE:
+			ok = onWindowUpdate(id, p, len);
+			break;
+		case FRAME_CONTINUATION:
+			if (headerStream_ == 0)
+			{
+				ok = connectionError(H2_PROTOCOL_ERROR);
+				break;
+			}
+			headerBlock_.append(reinterpret_cast<const char*>(p), len);
+			if (headerBlock_.size() > MAX_HEADER_BLOCK)ok = connectionError(H2_ENHANCE_YOUR_CALM);
+			else if (flags & FLAG_END_HEADERS)ok = finishHeaders();
+			break;
+		default:
+			//δ֪͵֡
+			break;
+		}
+	}
+	in_.erase(0, pos);
+	return ok;
+}
+
+bool Http2Session::onData(uint8_t flags, uint32_t id, const uint8_t* p, uint32_t len)
+{
+	if (id == 0)return connectionError(H2_PROTOCOL_ERROR);
+	const uint8_t* data = p;
+	uint32_t dataLen = len;
+	if (flags & FLAG_PADDED)
+	{
+		if (len < 1 || p[0] >= len)return connectionError(H2_PROTOCOL_ERROR);
+		data = p + 1;
+		dataLen = len - 1 - p[0];
+	}
+
+	//֡(),Ӽ黹
+	uint8_t inc[4];
+	put32(inc, len);
+	if (len > 0)writeFrame(FRAME_WINDOW_UPDATE, 0, 0, inc, sizeof(inc));
+
+	auto it = streams_.find(id);
+	if (it == streams_.end())
+	{
+		//Ѿûɵ,Զ˿ܻ;
+		if (id > lastStreamId_)return connectionError(H2_PROTOCOL_ERROR);
+		return true;
+	}
+	Stream& s = it->second;
+	if (s.remoteClosed)
+	{
+		resetStream(id, H2_STREAM_CLOSED);
+		return true;
+	}
+
+	if (!s.tooLarge)
+	{
+		if (static_cast<int64_t>(s.request.body.size() + dataLen) > maxBody_)
+		{
+			s.tooLarge = true;
+			std::string().swap(s.request.body);
+		}
+		else
+		{
+			s.request.body.append(reinterpret_cast<const char*>(data), dataLen);
+		}
+	}
+
+	if (flags & FLAG_END_STREAM)
+	{
+		s.remoteClosed = true;
+		pending_.push_back(id);
+	}
+	else if (len > 0)
+	{
+		writeFrame(FRAME_WINDOW_UPDATE, 0, id, inc, sizeof(inc));
+	}
+	return true;
+}
+
+bool Http2Session::onHeaders(uint8_t flags, uint32_t id, const uint8_t* p, uint32_t len)
+{
+	//ͻ˷
+	if (id == 0 || (id & 1) == 0)return connectionError(H2_PROTOCOL_ERROR);
+	const uint8_t* end = p + len;
+	uint32_t pad = 0;
+	if (flags & FLAG_PADDED)
+	{
+		if (p == end)return connectionError(H2_PROTOCOL_ERROR);
+		pad = *p++;
+	}
+	if (flags & FLAG_PRIORITY)
+	{
+		if (end - p < 5)return connectionError(H2_PROTOCOL_ERROR);
+		p += 5;
+	}
+	if (pad > static_cast<uint32_t>(end - p))return connectionError(H2_PROTOCOL_ERROR);
+	end -= pad;
+
+	auto it = streams_.find(id);
+	if (it != streams_.end())
+	{
+		//֮βֶ,
+		if (it->second.remoteClosed || !(flags & FLAG_END_STREAM))return connectionError(H2_PROTOCOL_ERROR);
+	}
+	else if (id <= lastStreamId_)
+	{
+		return connectionError(H2_STREAM_CLOSED);
+	}
+
+	headerBlock_.assign(reinterpret_cast<const char*>(p), end - p);
+	headerStream_ = id;
+	headerFlags_ = flags;
+	if (headerBlock_.size() > MAX_HEADER_BLOCK)return connectionError(H2_ENHANCE_YOUR_CALM);
+	if (flags & FLAG_END_HEADERS)return finishHeaders();
+	return true;
+}
+
+bool Http2Session::finishHeaders()
+{
+	uint32_t id = headerStream_;
+	uint8_t flags = headerFlags_;
+	headerStream_ = 0;
+
+	//ܾҲҪ,̬ͶԶ˱һ
+	HeaderList headers;
+	bool decoded = decoder_.decode(reinterpret_cast<const uint8_t*>(headerBlock_.data()), headerBlock_.size(), headers);
+	headerBlock_.clear();
+	if (!decoded)return connectionError(H2_COMPRESSION_ERROR);
+
+	auto it = streams_.find(id);
+	if (it != streams_.end())
+	{
+		//βֶβ
+		it->second.remoteClosed = true;
+		pending_.push_back(id);
+		return true;
+	}
+
+	lastStreamId_ = id;
+	if (streams_.size() >= MAX_CONCURRENT_STREAMS)
+	{
+		refused_++;
+		resetStream(id, H2_REFUSED_STREAM);
+		return true;
+	}
+
+	Stream& s = streams_[id];
+	s.id = id;
+	s.sendWindow = peerInitialWindow_;
+	HttpRequest& req = s.request;
+	std::string scheme;
+	bool regular = false;
+	bool hasAuthority = false;
+	bool bad = false;
+	for (auto& h : headers)
+	{
+		const std::string& name = h.first;
+		const std::string& value = h.second;
+		if (!name.empty() && name[0] == ':')
+		{
+			//αͷͨͷ֮ǰ
+			if (regular)bad = true;
+			if (name == ":method")req.method = value;
+			else if (name == ":path")req.url = value;
+			else if (name == ":scheme")scheme = value;
+			else if (name == ":authority")
+			{
+				req.headers += "host: " + value + "\n";
+				hasAuthority = true;
+			}
+			else bad = true;
+			continue;
+		}
+		regular = true;
+
+		//ͷֱСд,صͷܳ
+		for (char c : name)
+		{
+			if (c >= 'A' && c <= 'Z')bad = true;
+		}
+		if (isConnectionHeader(name) || (name == "te" && value != "trailers"))bad = true;
+		if (name == "host" && hasAuthority)continue;
+		if (name == "content-length")req.content_length = strtoll(value.c_str(), nullptr, 10);
+		req.headers += name + ": " + value + "\n";
+	}
+	//֧CONNECT,ͨαͷȱһ
+	if (req.method.empty() || scheme.empty() || req.url.empty() || req.url[0] != '/')bad = true;
+	if (bad)
+	{
+		resetStream(id, H2_PROTOCOL_ERROR);
+		return true;
+	}
+
+	req.version = "HTTP/2.0";
+	req.state = HttpState::DONE;
+	req.keep_alive = true;
+	s.isHead = req.method == "HEAD";
+	streamsTotal_++;
+	if (flags & FLAG_END_STREAM)
+	{
+		s.remoteClosed = true;
+		pending_.push_back(id);
+	}
+	return true;
+}
+
+bool Http2Session::onSettings(uint8_t flags, uint32_t id, const uint8_t* p, uint32_t len)
+{
+	if (id != 0)return connectionError(H2_PROTOCOL_ERROR);
+	if (flags & FLAG_ACK)
+	{
+		if (len != 0)return connectionError(H2_FRAME_SIZE_ERROR);
+		return true;
+	}
+	if (len % 6 != 0)return connectionError(H2_FRAME_SIZE_ERROR);
+
+	for (uint32_t i = 0; i < len; i += 6)
+	{
+		uint16_t key = static_cast<uint16_t>((p[i] << 8) | p[i + 1]);
+		uint32_t value = get32(p + i + 2);
+		switch (key)
+		{
+		case SETTINGS_HEADER_TABLE_SIZE:
+			encoder_.setMaxTableSize(value);
+			break;
+		case SETTINGS_ENABLE_PUSH:
+			if (value > 1)return connectionError(H2_PROTOCOL_ERROR);
+			break;
+		case SETTINGS_INITIAL_WINDOW_SIZE:
+		{
+			if (value > MAX_WINDOW)return connectionError(H2_FLOW_CONTROL_ERROR);
+			//ֵѴ򿪵,ڿ˱ɸ
+			int64_t delta = static_cast<int64_t>(value) - peerInitialWindow_;
+			peerInitialWindow_ = value;
+			for (auto& pair : streams_)
+			{
+				Stream& s = pair.second;
+				s.sendWindow += delta;
+				if (s.sendWindow > MAX_WINDOW)return connectionError(H2_FLOW_CONTROL_ERROR);
+				if (s.sendWindow > 0)schedule(s);
+			}
+			break;
+		}
+		case SETTINGS_MAX_FRAME_SIZE:
+			if (value < 16384 || value > 16777215)return connectionError(H2_PROTOCOL_ERROR);
+			//DATA֡Բ16KB,֡ԽСתԽ
+			peerMaxFrame_ = std::min<uint32_t>(value, MAX_FRAME_SIZE);
+			break;
+		default:
+			break;
+		}
+	}
+	writeFrame(FRAME_SETTINGS, FLAG_ACK, 0, nullptr, 0);
+	return true;
+}
+
+bool Http2Session::onWindowUpdate(uint32_t id, const uint8_t* p, uint32_t len)
+{
+	if (len != 4)return connectionError(H2_FRAME_SIZE_ERROR);
+	uint32_t inc = get32(p) & 0x7fffffff;
+	if (id == 0)
+	{
+		if (inc == 0)return connectionError(H2_PROTOCOL_ERROR);
+		connSendWindow_ += inc;
+		if (connSendWindow_ > MAX_WINDOW)return connectionError(H2_FLOW_CONTROL_ERROR);
+		return true;
+	}
+
+	auto it = streams_.find(id);
+	if (it == streams_.end())
+	{
+		if (id > lastStreamId_)return connectionError(H2_PROTOCOL_ERROR);
+		return true;
+	}
+	Stream& s = it->second;
+	if (inc == 0)
+	{
+		resetStream(id, H2_PROTOCOL_ERROR);
+		return true;
+	}
+	s.sendWindow += inc;
+	if (s.sendWindow > MAX_WINDOW)
+	{
+		resetStream(id, H2_FLOW_CONTROL_ERROR);
+		return true;
+	}
+	if (s.sendWindow > 0)schedule(s);
+	return true;
+}
+
+void Http2Session::runRequests()
+{
+	std::vector<uint32_t> ids;
+	ids.swap(pending_);
+	for (uint32_t id : ids)
+	{
+		auto it = streams_.find(id);
+		if (it == streams_.end())continue;
+		Stream& s = it->second;
+		if (s.tooLarge)
+		{
+			respond(id, 413, { { "content-type", "text/html" } }, errorBody(413, "Payload Too Large"));
+			continue;
+		}
+
+		s.request.content_length = static_cast<int64_t>(s.request.body.size());
+		s.request.body_received = s.request.content_length;
+		onRequest_(id, s.request);
+
+		//ûдӦʱһӦ,ͻһֱȴ
+		it = streams_.find(id);
+		if (it != streams_.end() && !it->second.responded)respond(id, 204, HeaderList(), std::string());
+	}
+}
+
+Http2Session::Stream* Http2Session::beginResponse(uint32_t id)
+{
+	auto it = streams_.find(id);
+	if (it == streams_.end() || it->second.responded)return nullptr;
+	it->second.responded = true;
+	return &it->second;
+}
+
+std::string Http2Session::encodeHeaders(int status, const HeaderList& headers, int64_t contentLength)
+{
+	std::string block;
+	encoder_.beginBlock(block);
+	encoder_.encodeStatus(status, block);
+	for (auto& h : headers)
+	{
+		std::string name = h.first;
+		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+		if (isConnectionHeader(name) || name == "content-length")continue;
+		//ÿζֵ̬ͬ,content-typeԸõĿȥ
+		bool index = name != "date" && name != "etag" && name != "last-modified" &&
+			name != "set-cookie" && name != "location" && name != "content-range";
+		encoder_.encode(name, h.second, block, index);
+	}
+	if (contentLength >= 0)encoder_.encode("content-length", std::to_string(contentLength), block, false);
+	return block;
+}
+
+void Http2Session::respond(uint32_t id, int status, const HeaderList& headers, std::string body)
+{
+	Stream* s = beginResponse(id);
+	if (s == nullptr)return;
+
+	//HEADֻͷ,content-lengthʵʳ;204content-length
+	bool noBody = s->isHead || body.empty();
+	writeHeaders(id, encodeHeaders(status, headers, status == 204 ? -1 : static_cast<int64_t>(body.size())), noBody);
+	if (noBody)
+	{
+		closeStream(id);
+		return;
+	}
+	s->remaining = static_cast<int64_t>(body.size());
+	s->body = std::move(body);
+	schedule(*s);
+}
+
+void Http2Session::respondFile(uint32_t id, int status, const HeaderList& headers, int fd, int64_t size)
+{
+	Stream* s = beginResponse(id);
+	if (s == nullptr)
+	{
+		close(fd);
+		return;
+	}
+
+	bool noBody = s->isHead || size == 0;
+	writeHeaders(id, encodeHeaders(status, headers, size), noBody);
+	if (noBody)
+	{
+		close(fd);
+		closeStream(id);
+		return;
+	}
+	s->fileFd = fd;
+	s->fileOffset = 0;
+	s->remaining = size;
+	schedule(*s);
+}
+
+void Http2Session::respondHttp1(uint32_t id, const std::string& raw)
+{
+	size_t headEnd = raw.find("\r\n\r\n");
+	int status = raw.size() > 12 ? atoi(raw.c_str() + 9) : 0;
+	if (headEnd == std::string::npos || status < 200)
+	{
+		respond(id, 502, { { "content-type", "text/html" } }, errorBody(502, "Bad Gateway"));
+		return;
+	}
+
+	HeaderList headers;
+	bool chunked = false;
+	size_t pos = raw.find("\r\n") + 2;
+	while (pos < headEnd)
+	{
+		size_t eol = raw.find("\r\n", pos);
+		std::string line = raw.substr(pos, eol - pos);
+		pos = eol + 2;
+		size_t colon = line.find(':');
+		if (colon == std::string::npos)continue;
+		std::string name = line.substr(0, colon);
+		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+		size_t v = line.find_first_not_of(" \t", colon + 1);
+		std::string value = v == std::string::npos ? std::string() : line.substr(v);
+		if (name == "transfer-encoding")
+		{
+			chunked = strcasestr(value.c_str(), "chunked") != nullptr;
+			continue;
+		}
+		headers.emplace_back(std::move(name), std::move(value));
+	}
+
+	std::string body = raw.substr(headEnd + 4);
+	if (chunked)
+	{
+		//HTTP/2֡綨Ӧ,ȥchunked
+		HttpRequest decoder;
+		decoder.state = HttpState::BODY;
+		decoder.chunked = true;
+		if (decoder.parseBody(body.data(), static_cast<int>(body.size())) == -1)
+		{
+			respond(id, 502, { { "content-type", "text/html" } }, errorBody(502, "Bad Gateway"));
+			return;
+		}
+		body.swap(decoder.body);
+	}
+	respond(id, status, headers, std::move(body));
+}
+
+void Http2Session::schedule(Stream& s)
+{
+	if (s.queued || s.remaining <= 0)return;
+	s.queued = true;
+	ready_.push_back(s.id);
+}
+
+void Http2Session::fillOutput()
+{
+	//ÿδӶȡһһ֡,ҴδʱŻضβ,ļһֱȴ
+	while (!ready_.empty() && connSendWindow_ > 0 && out_.size() - outOffset_ < OUTPUT_HIGH_WATER)
+	{
+		uint32_t id = ready_.front();
+		ready_.pop_front();
+		auto it = streams_.find(id);
+		if (it == streams_.end())continue;
+		Stream& s = it->second;
+		s.queued = false;
+		//Ĵ,յWINDOW_UPDATEŶ
+		if (s.sendWindow <= 0)continue;
+
+		int64_t n = std::min({ s.remaining, static_cast<int64_t>(peerMaxFrame_), s.sendWindow, connSendWindow_ });
+		bool last = n == s.remaining;
+		size_t start = out_.size();
+		appendFrameHeader(out_, static_cast<size_t>(n), FRAME_DATA, last ? FLAG_END_STREAM : 0, id);
+		if (s.fileFd != -1)
+		{
+			//ļֱӶͻ,м俽
+			out_.resize(start + FRAME_HEADER_LEN + n);
+			ssize_t got = pread(s.fileFd, &out_[start + FRAME_HEADER_LEN], n, s.fileOffset);
+			if (got != n)
+			{
+				out_.resize(start);
+				resetStream(id, H2_INTERNAL_ERROR);
+				continue;
+			}
+			s.fileOffset += n;
+		}
+		else
+		{
+			out_.append(s.body, s.bodyOffset, n);
+			s.bodyOffset += n;
+		}
+		s.remaining -= n;
+		s.sendWindow -= n;
+		connSendWindow_ -= n;
+
+		if (last)closeStream(id);
+		else if (s.sendWindow > 0)schedule(s);
+	}
+}
+
+int Http2Session::flush()
+{
+	while (outOffset_ < out_.size())
+	{
+		ssize_t n = send(fd_, out_.data() + outOffset_, out_.size() - outOffset_, MSG_NOSIGNAL);
+		if (n > 0)
+		{
+			outOffset_ += n;
+			continue;
+		}
+		if (n < 0 && errno == EINTR)continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			//ѷĲֳһʱٰᶯ,ÿζʣ
+			if (outOffset_ > out_.size() / 2)
+			{
+				out_.erase(0, outOffset_);
+				outOffset_ = 0;
+			}
+			return 0;
+		}
+		return -1;
+	}
+	out_.clear();
+	outOffset_ = 0;
+	return 1;
+}
+
+void Http2Session::writeFrame(uint8_t type, uint8_t flags, uint32_t id, const void* payload, size_t len)
+{
+	appendFrameHeader(out_, len, type, flags, id);
+	if (len > 0)out_.append(static_cast<const char*>(payload), len);
+}
+
+void Http2Session::writeHeaders(uint32_t id, const std::string& block, bool endStream)
+{
+	//Զ֡ȵͷHEADERSCONTINUATION,м䲻ܲ֡
+	size_t pos = 0;
+	bool first = true;
+	do
+	{
+		size_t n = std::min(block.size() - pos, static_cast<size_t>(peerMaxFrame_));
+		uint8_t flags = pos + n == block.size() ? FLAG_END_HEADERS : 0;
+		if (first && endStream)flags |= FLAG_END_STREAM;
+		writeFrame(first ? FRAME_HEADERS : FRAME_CONTINUATION, flags, id, block.data() + pos, n);
+		pos += n;
+		first = false;
+	} while (pos < block.size());
+}
+
+bool Http2Session::connectionError(uint32_t code)
+{
+	if (!closing_)
+	{
+		uint8_t payload[8];
+		put32(payload, lastStreamId_);
+		put32(payload + 4, code);
+		writeFrame(FRAME_GOAWAY, 0, 0, payload, sizeof(payload));
+		closing_ = true;
+		if (code != H2_NO_ERROR)protocolErrors_++;
+	}
+	return false;
+}
+
+void Http2Session::resetStream(uint32_t id, uint32_t code)
+{
+	uint8_t payload[4];
+	put32(payload, code);
+	writeFrame(FRAME_RST_STREAM, 0, id, payload, sizeof(payload));
+	closeStream(id);
+}
+
+void Http2Session::closeStream(uint32_t id)
+{
+	auto it = streams_.find(id);
+	if (it == streams_.end())return;
+	if (it->second.fileFd != -1)close(it->second.fileFd);
+	streams_.erase(it);
+}
+
+std::string Http2Session::statsJson()
+{
+	std::string json = "{";
+	json += "\"sessions\":" + std::to_string(sessions_.load()) + ",";
+	json += "\"streams\":" + std::to_string(streamsTotal_.load()) + ",";
+	json += "\"refusedStreams\":" + std::to_string(refused_.load()) + ",";
+	json += "\"protocolErrors\":" + std::to_string(protocolErrors_.load());
+	json += "}";
+	return json;
+}
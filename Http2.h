@@ -0,0 +1,141 @@
+#pragma once
+#include "Hpack.h"
+#include "HttpRequest.h"
+#include <string>
+#include <map>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+#include <sys/types.h>
+#include <openssl/ssl.h>
+
+
+//һHTTP/2(RFC 9113):ǰʶ(h2c prior knowledge),TLSALPNЭ
+//ỰֻڳӵĹ߳з,EPOLLONESHOT֤ͬһʱֻһ߳serve
+class Http2Session
+{
+public:
+	//(END_STREAM),Ӧrespondϵк֮һ
+	using RequestCallback = std::function<void(uint32_t streamId, HttpRequest& req)>;
+
+	enum class Result
+	{
+		WAIT_READ,		//socketû,ȴEPOLLIN
+		WAIT_WRITE,		//ͻ,ȴEPOLLOUT
+		CLOSE			//ӽ(Զ˹رաGOAWAYЭ)
+	};
+
+	//sslǿʱȡҪOpenSSL(kTLSֻж˷ͷ)
+	Http2Session(int fd, SSL* ssl, int64_t maxBody, RequestCallback onRequest);
+	~Http2Session();
+
+	Http2Session(const Http2Session&) = delete;
+	Http2Session& operator=(const Http2Session&) = delete;
+
+	//1:ǰԿͷ 0:ǰԵǰ׺,Ҫ -1:HTTP/2
+	static int matchPreface(const char* p, size_t n);
+
+	//reactorѾ(ǰԿʼ)
+	void feed(const char* p, size_t n);
+
+	//EAGAIN,յ֡,͸Ӧ,ֱҪȴsocket
+	Result serve();
+	Result lastResult() const { return result_; }
+	//Ŷӳʱֱӽ
+	void abort() { result_ = Result::CLOSE; }
+
+	//ڴеӦ;ֻתСд,صͷcontent-lengthɻỰ
+	void respond(uint32_t id, int status, const HeaderList& headers, std::string body);
+	//ļӦ尴DATA֡Ƭ,;fdȨỰ
+	void respondFile(uint32_t id, int status, const HeaderList& headers, int fd, int64_t size);
+	//HTTP/1.1Ӧ(Ľ)תHTTP/2Ӧ
+	void respondHttp1(uint32_t id, const std::string& raw);
+
+	static std::string statsJson();
+
+	//constexpr:std::minȰȡֵ,ĳ-O0Ҫⶨ
+	static constexpr uint32_t MAX_CONCURRENT_STREAMS = 128;
+	static constexpr uint32_t MAX_FRAME_SIZE = 16384;			//˽ܵ֡,ЭĬֵ
+	static constexpr size_t MAX_HEADER_BLOCK = 64 * 1024;		//ͷ(CONTINUATION)
+	static constexpr size_t OUTPUT_HIGH_WATER = 256 * 1024;		//ͻֵʱдsocketټ֡
+	static constexpr int32_t RECV_WINDOW = 1024 * 1024;			//Ӽմ,Ĭϵ65535
+
+private:
+	struct Stream
+	{
+		uint32_t id = 0;
+		HttpRequest request;
+		bool remoteClosed = false;	//յEND_STREAM
+		bool responded = false;
+		bool isHead = false;
+		bool tooLarge = false;		//峬,413
+		int64_t sendWindow = 0;
+
+		//͵Ӧ:ڴݻļ
+		std::string body;
+		size_t bodyOffset = 0;
+		int fileFd = -1;
+		int64_t fileOffset = 0;
+		int64_t remaining = 0;
+		bool queued = false;		//ھ
+	};
+
+	//Ӽ,GOAWAYر
+	bool connectionError(uint32_t code);
+	void resetStream(uint32_t id, uint32_t code);
+	void closeStream(uint32_t id);
+
+	int readInput();
+	bool processInput();
+	bool onData(uint8_t flags, uint32_t id, const uint8_t* p, uint32_t len);
+	bool onHeaders(uint8_t flags, uint32_t id, const uint8_t* p, uint32_t len);
+	bool onSettings(uint8_t flags, uint32_t id, const uint8_t* p, uint32_t len);
+	bool onWindowUpdate(uint32_t id, const uint8_t* p, uint32_t len);
+	bool finishHeaders();
+	void runRequests();
+
+	void writeFrame(uint8_t type, uint8_t flags, uint32_t id, const void* payload, size_t len);
+	void writeHeaders(uint32_t id, const std::string& block, bool endStream);
+	std::string encodeHeaders(int status, const HeaderList& headers, int64_t contentLength);
+	Stream* beginResponse(uint32_t id);
+	void schedule(Stream& s);
+	void fillOutput();
+	//1:ȫд 0:socket -1:
+	int flush();
+
+	int fd_;
+	SSL* ssl_;
+	int64_t maxBody_;
+	RequestCallback onRequest_;
+	Result result_;
+
+	std::string in_;
+	std::string out_;
+	size_t outOffset_;
+	bool prefaceDone_;
+	bool settingsSent_;
+	bool eof_;
+	bool closing_;			//ѷGOAWAY
+	bool peerGoaway_;
+
+	HpackDecoder decoder_;
+	HpackEncoder encoder_;
+	std::string headerBlock_;	//ƴӵͷ
+	uint32_t headerStream_;		//ȴCONTINUATION,0ʾû
+	uint8_t headerFlags_;
+
+	std::map<uint32_t, Stream> streams_;
+	std::deque<uint32_t> ready_;			//Ӧ͵,ת˳
+	std::vector<uint32_t> pending_;			//ûд
+	uint32_t lastStreamId_;
+	int64_t connSendWindow_;
+	int64_t peerInitialWindow_;
+	uint32_t peerMaxFrame_;
+
+	static std::atomic<long> sessions_;
+	static std::atomic<long> streamsTotal_;
+	static std::atomic<long> refused_;
+	static std::atomic<long> protocolErrors_;
+};
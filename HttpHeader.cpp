@@ -0,0 +1,202 @@
+#include "HttpHeader.h"
+#include <string.h>
+#include <stdio.h>
+
+namespace
+{
+	struct StatusEntry
+	{
+		int status;
+		std::string_view line;
+	};
+
+#define STATUS_LINE(code, reason) { code, "HTTP/1.1 " #code " " reason "\r\n" }
+	constexpr StatusEntry STATUS_LINES[] = {
+		STATUS_LINE(100, "Continue"),
+		STATUS_LINE(101, "Switching Protocols"),
+		STATUS_LINE(200, "OK"),
+		STATUS_LINE(201, "Created"),
+		STATUS_LINE(202, "Accepted"),
+		STATUS_LINE(204, "No Content"),
+		STATUS_LINE(206, "Partial Content"),
+		STATUS_LINE(301, "Moved Permanently"),
+		STATUS_LINE(302, "Found"),
+		STATUS_LINE(304, "Not Modified"),
+		STATUS_LINE(307, "Temporary Redirect"),
+		STATUS_LINE(308, "Permanent Redirect"),
+		STATUS_LINE(400, "Bad Request"),
+		STATUS_LINE(401, "Unauthorized"),
+		STATUS_LINE(403, "Forbidden"),
+		STATUS_LINE(404, "Not Found"),
+		STATUS_LINE(405, "Method Not Allowed"),
+		STATUS_LINE(408, "Request Timeout"),
+		STATUS_LINE(411, "Length Required"),
+		STATUS_LINE(413, "Payload Too Large"),
+		STATUS_LINE(414, "URI Too Long"),
+		STATUS_LINE(416, "Range Not Satisfiable"),
+		STATUS_LINE(426, "Upgrade Required"),
+		STATUS_LINE(429, "Too Many Requests"),
+		STATUS_LINE(431, "Request Header Fields Too Large"),
+		STATUS_LINE(500, "Internal Server Error"),
+		STATUS_LINE(501, "Not Implemented"),
+		STATUS_LINE(502, "Bad Gateway"),
+		STATUS_LINE(503, "Service Unavailable"),
+		STATUS_LINE(504, "Gateway Timeout"),
+		STATUS_LINE(505, "HTTP Version Not Supported"),
+	};
+#undef STATUS_LINE
+
+	//״ֱ̬±
+	struct StatusTable
+	{
+		std::string_view lines[600];
+		constexpr StatusTable() : lines()
+		{
+			for (const StatusEntry& e : STATUS_LINES)lines[e.status] = e.line;
+		}
+	};
+	constexpr StatusTable STATUS_TABLE;
+
+	const char SERVER_HEADER[] = "Server:Reactor-HttpServer\r\n";
+}
+
+std::string_view statusLine(int status)
+{
+	if (status < 0 || status >= 600)return std::string_view();
+	return STATUS_TABLE.lines[status];
+}
+
+std::atomic<uint32_t> HttpDate::seq_{ 0 };
+std::atomic<int64_t> HttpDate::second_{ -1 };
+std::atomic<uint64_t> HttpDate::words_[4];
+
+void HttpDate::format(time_t t, char* out)
+{
+	static const char DAYS[] = "SunMonTueWedThuFriSat";
+	static const char MONTHS[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+	struct tm tm;
+	gmtime_r(&t, &tm);
+	auto two = [](char* p, int v) {
+		p[0] = static_cast<char>('0' + v / 10);
+		p[1] = static_cast<char>('0' + v % 10);
+	};
+	memcpy(out, DAYS + tm.tm_wday * 3, 3);
+	out[3] = ',';
+	out[4] = ' ';
+	two(out + 5, tm.tm_mday);
+	out[7] = ' ';
+	memcpy(out + 8, MONTHS + tm.tm_mon * 3, 3);
+	out[11] = ' ';
+	int year = tm.tm_year + 1900;
+	two(out + 12, year / 100 % 100);
+	two(out + 14, year % 100);
+	out[16] = ' ';
+	two(out + 17, tm.tm_hour);
+	out[19] = ':';
+	two(out + 20, tm.tm_min);
+	out[22] = ':';
+	two(out + 23, tm.tm_sec);
+	memcpy(out + 25, " GMT", 4);
+}
+
+void HttpDate::refresh()
+{
+	time_t now = time(nullptr);
+	if (second_.load(std::memory_order_relaxed) == now)return;
+
+	uint64_t words[4] = {};
+	format(now, reinterpret_cast<char*>(words));
+	uint32_t s = seq_.load(std::memory_order_relaxed);
+	seq_.store(s + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	for (int i = 0; i < 4; i++)words_[i].store(words[i], std::memory_order_relaxed);
+	second_.store(now, std::memory_order_relaxed);
+	seq_.store(s + 2, std::memory_order_release);
+}
+
+void HttpDate::copy(char* out)
+{
+	uint64_t words[4];
+	int64_t second;
+	for (;;)
+	{
+		uint32_t s = seq_.load(std::memory_order_acquire);
+		if (s & 1)continue;
+		for (int i = 0; i < 4; i++)words[i] = words_[i].load(std::memory_order_relaxed);
+		second = second_.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (seq_.load(std::memory_order_relaxed) == s)break;
+	}
+
+	//reactorʱepoll_wait,Ѿ,ʱԼʽһ
+	time_t now = time(nullptr);
+	if (second != now)
+	{
+		format(now, out);
+		return;
+	}
+	memcpy(out, words, LENGTH);
+}
+
+void ResponseHead::begin(int status, std::string_view reason)
+{
+	len_ = 0;
+	spill_.clear();
+	std::string_view line = statusLine(status);
+	if (!line.empty())
+	{
+		raw(line);
+	}
+	else
+	{
+		char code[16];
+		int n = snprintf(code, sizeof(code), "HTTP/1.1 %d ", status);
+		append(code, n);
+		raw(reason);
+		raw("\r\n");
+	}
+
+	char date[5 + HttpDate::LENGTH + 2];
+	memcpy(date, "Date:", 5);
+	HttpDate::copy(date + 5);
+	memcpy(date + 5 + HttpDate::LENGTH, "\r\n", 2);
+	append(date, sizeof(date));
+	append(SERVER_HEADER, sizeof(SERVER_HEADER) - 1);
+}
+
+void ResponseHead::header(std::string_view name, std::string_view value)
+{
+	raw(name);
+	raw(":");
+	raw(value);
+	raw("\r\n");
+}
+
+void ResponseHead::contentLength(uint64_t len)
+{
+	//Ӻǰдʮ
+	char buf[40];
+	char* end = buf + sizeof(buf);
+	char* p = end;
+	*--p = '\n';
+	*--p = '\r';
+	do
+	{
+		*--p = static_cast<char>('0' + len % 10);
+		len /= 10;
+	} while (len != 0);
+	raw("Content-Length:");
+	append(p, end - p);
+}
+
+void ResponseHead::append(const char* p, size_t n)
+{
+	if (spill_.empty() && len_ + n <= CAPACITY)
+	{
+		memcpy(buf_ + len_, p, n);
+		len_ += n;
+		return;
+	}
+	if (spill_.empty())spill_.assign(buf_, len_);
+	spill_.append(p, n);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+
+//HTTP/1.1ӦͷĹ:Ԥɵ״̬СÿʽһεDate̶Server
+//״̬뷵״̬"HTTP/1.1 200 OK\r\n",;ʶ״̬뷵ؿ
+std::string_view statusLine(int status);
+
+//Dateͷֵ,"Sun, 06 Nov 1994 08:49:37 GMT"
+//ֻreactorд:ÿ¼ѭrefresh,仯ʱ¸ʽ;У,
+class HttpDate
+{
+public:
+	static const size_t LENGTH = 29;
+
+	//reactor
+	static void refresh();
+	//дLENGTHַ,ӽβ'\0'
+	static void copy(char* out);
+
+private:
+	static void format(time_t t, char* out);
+
+	static std::atomic<uint32_t> seq_;		//ʾд
+	static std::atomic<int64_t> second_;
+	static std::atomic<uint64_t> words_[4];	//8ֽڴŵĸʽ
+};
+
+//ڹ̶ƴӦͷ,ֻ,ڴ
+//˺ܳͷʱת
+class ResponseHead
+{
+public:
+	static const size_t CAPACITY = 512;
+
+	ResponseHead() : len_(0) {}
+	ResponseHead(const ResponseHead&) = delete;
+	ResponseHead& operator=(const ResponseHead&) = delete;
+
+	//״̬кDateServerͷ;reasonֻ״̬벻ڱʱʹ
+	void begin(int status, std::string_view reason = std::string_view());
+	void header(std::string_view name, std::string_view value);
+	void contentLength(uint64_t len);
+	//׷Ѿʽõ":ֵ\r\n"
+	void raw(std::string_view text) { append(text.data(), text.size()); }
+	//ConnectionͷͽͷĿ;ʱӦĳȱȷ
+	void finish(bool keepAlive = false) { raw(keepAlive ? "Connection:keep-alive\r\n\r\n" : "Connection:close\r\n\r\n"); }
+
+	const char* data() const { return spill_.empty() ? buf_ : spill_.data(); }
+	size_t size() const { return spill_.empty() ? len_ : spill_.size(); }
+	std::string_view view() const { return std::string_view(data(), size()); }
+
+private:
+	void append(const char* p, size_t n);
+
+	char buf_[CAPACITY];
+	size_t len_;
+	std::string spill_;
+};
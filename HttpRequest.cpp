@@ -3,10 +3,35 @@
 #include <string>
 #include <cstring>
 #include <cctype>
+#include <cstdlib>
+#include <strings.h>
 
 using namespace std;
 
+//Ĭϳ1MBʽ
+static const int64_t DEFAULT_MAX_BUFFERED_BODY = 1024 * 1024;
+//chunkС/βֶеĳ,ֹĳռڴ
+static const size_t MAX_CHUNK_LINE = 4096;
+
+//ڳΪlenĻв\r\n,Ҫ\0β
+static const char* findCRLF(const char* p, int len)
+{
+	return static_cast<const char*>(memmem(p, len, "\r\n", 2));
+}
+
+//ͷֵǷĳѡ,ԴСд,"Keep-Alive, Upgrade"еkeep-alive
+static bool hasToken(std::string_view value, std::string_view token)
+{
+	for (size_t i = 0; i + token.size() <= value.size(); i++)
+	{
+		if (strncasecmp(value.data() + i, token.data(), token.size()) == 0)return true;
+	}
+	return false;
+}
+
 HttpRequest::HttpRequest()
+	: method(&arena), url(&arena), version(&arena), headers(&arena), chunk_line(&arena),
+	max_buffered_body(DEFAULT_MAX_BUFFERED_BODY)
 {
 	reset();
 }
@@ -14,41 +39,55 @@ HttpRequest::HttpRequest()
 void HttpRequest::reset()
 {
 	state = HttpState::REQUEST_LINE;
-	method.clear();
-	url.clear();
-	version.clear();
-	headers.clear();
+	//ַarenaеĻ,黹;clearƶֵһմᱣָarena,ֻܽ
+	std::pmr::string(&arena).swap(method);
+	std::pmr::string(&arena).swap(url);
+	std::pmr::string(&arena).swap(version);
+	std::pmr::string(&arena).swap(headers);
+	std::pmr::string(&arena).swap(chunk_line);
+	arena.release();
 	content_length = 0;
 	body.clear();
 	body_received = 0;
 	keep_alive = false;
+	consumed_bytes = 0;
+	head_bytes = 0;
+	chunked = false;
+	stream_body = false;
+	chunk_state = ChunkState::SIZE;
+	chunk_remaining = 0;
+	body_sink = nullptr;
 }
 
 int HttpRequest::parse(const char* buf, int len)
 {
 	cout << "׼ʼ" << endl;
 	int i = 0;
+	consumed_bytes = 0;
 	while (i < len)
 	{
 		switch (state)
 		{
 		case HttpState::REQUEST_LINE:
 		{
-			const char* line_end = strstr(buf + i, "\r\n");
-			if (!line_end)return 0;
+			const char* line_end = findCRLF(buf + i, len - i);
+			if (!line_end) {
+				consumed_bytes = i;
+				return 0;
+			}
 
 			ptrdiff_t line_len = line_end - (buf + i);//intᵼָľȶʧָĽptrdiff_t(ͨlong int)
-			std::string line(buf + i, line_len);
+			std::string_view line(buf + i, line_len);
 
 			//򵥵н
 			size_t pos1 = line.find(' ');
-			if (pos1 == std::string::npos) {
+			if (pos1 == std::string_view::npos) {
 				state = HttpState::ERROR;
 				return -1;
 			}
 
 			size_t pos2 = line.find(' ', pos1 + 1);
-			if (pos2 == std::string::npos)
+			if (pos2 == std::string_view::npos)
 			{
 				state = HttpState::ERROR;
 				return -1;
@@ -59,73 +98,213 @@ int HttpRequest::parse(const char* buf, int len)
 			version = line.substr(pos2 + 1);
 
 			state = HttpState::HEADER;
+			head_bytes += line_len + 2;
 			i += static_cast<int>(line_len) + 2;//ҪתΪiint
 			break; 
 		}
 		case HttpState::HEADER:
 		{
-			const char* line_end = strstr(buf + i, "\r\n");
-			if (!line_end)return 0;
+			const char* line_end = findCRLF(buf + i, len - i);
+			if (!line_end) {
+				consumed_bytes = i;
+				return 0;
+			}
 
 			if (line_end == buf + i)
 			{
 				//,ͷ
-				state = (content_length > 0) ? HttpState::BODY : HttpState::DONE;
+				state = (content_length > 0 || chunked) ? HttpState::BODY : HttpState::DONE;
+				head_bytes += 2;
 				i += 2;
 				if (state == HttpState::DONE) {
+					consumed_bytes = i;
 					return 1;
 				}
+				//δ֪彻ʽ,ѶĲݴbody
+				if (chunked || content_length > max_buffered_body) {
+					stream_body = true;
+					body.assign(buf + i, len - i);
+					consumed_bytes = len;
+					return 2;
+				}
 				break;
 			}
 
 			ptrdiff_t line_len = line_end - (buf + i); //intᵼָľȶʧָĽptrdiff_t(ͨlong int)
-			std::string header_line(buf + i, line_len);
+			std::string_view header_line(buf + i, line_len);
 
 			//content-Length
-			if (header_line.find("Content-Length:") == 0 ||
-				header_line.find("Content-length:") == 0) {
-				content_length = std::stoi(header_line.substr(15));
+			if (header_line.compare(0, 15, "Content-Length:") == 0 ||
+				header_line.compare(0, 15, "Content-length:") == 0) {
+				//β\r\n,֮Ľ\rֹͣ
+				char* end = nullptr;
+				content_length = strtoll(buf + i + 15, &end, 10);
+				if (end == buf + i + 15 || content_length < 0) {
+					state = HttpState::ERROR;
+					return -1;
+				}
+			}
+			//Transfer-Encoding
+			else if (header_line.compare(0, 18, "Transfer-Encoding:") == 0 ||
+				header_line.compare(0, 18, "Transfer-encoding:") == 0) {
+				if (header_line.find("chunked") != std::string_view::npos) {
+					chunked = true;
+				}
 			}
-			//Connection
-			else if (header_line.find("Conneciton:") == 0) {
-				if (header_line.find("keep-alive") != std::string::npos) {
+			//Connection,ͷִСд;closekeep-alive
+			else if (line_len >= 11 && strncasecmp(buf + i, "Connection:", 11) == 0) {
+				std::string_view value = header_line.substr(11);
+				if (hasToken(value, "close")) {
+					keep_alive = false;
+				}
+				else if (hasToken(value, "keep-alive")) {
 					keep_alive = true;
 				}
 			}
 
-			headers += header_line + "\n";
+			headers.append(header_line).push_back('\n');
+			head_bytes += line_len + 2;
 			i += static_cast<int>(line_len) + 2;
 			break;
 		}
 		case HttpState::BODY:
 		{
-			int remain = len - i;
-			int need = content_length - body_received;
-			int copy_len = (remain < need) ? remain : need;
+			int ret = parseBody(buf + i, len - i);
+			consumed_bytes += i;
+			return ret;
+		}
+		case HttpState::DONE:
+			consumed_bytes = i;
+			return 1;
+		case HttpState::ERROR:
+			return -1;
+		}	
+	}
+	//޸:ѭķ
+	//ѭδɣ0ʾҪ
+	consumed_bytes = i;
+	return (state == HttpState::DONE) ? 1 : 0;
+}
+
+int HttpRequest::parseBody(const char* buf, int len)
+{
+	int i = 0;
+	while (i < len && state == HttpState::BODY)
+	{
+		if (!chunked)
+		{
+			int64_t need = content_length - body_received;
+			int copy_len = (len - i < need) ? len - i : static_cast<int>(need);
 
-			body.append(buf + i, copy_len);
+			if (!deliverBody(buf + i, copy_len))return -1;
 			body_received += copy_len;
 			i += copy_len;
 
 			if (body_received >= content_length) {
 				state = HttpState::DONE;
 			}
+			continue;
+		}
+
+		switch (chunk_state)
+		{
+		case ChunkState::SIZE:
+		case ChunkState::TRAILER:
+		{
+			//һпܱڶζȡ,ܵchunk_line
+			const char* nl = static_cast<const char*>(memchr(buf + i, '\n', len - i));
+			if (!nl) {
+				chunk_line.append(buf + i, len - i);
+				i = len;
+				if (chunk_line.size() > MAX_CHUNK_LINE) {
+					state = HttpState::ERROR;
+					return -1;
+				}
+				break;
+			}
+			chunk_line.append(buf + i, nl - (buf + i));
+			i = static_cast<int>(nl - buf) + 1;
+			if (!chunk_line.empty() && chunk_line.back() == '\r')chunk_line.pop_back();
+
+			if (chunk_state == ChunkState::SIZE)
+			{
+				//chunkչ(;֮)
+				char* end = nullptr;
+				unsigned long long size = strtoull(chunk_line.c_str(), &end, 16);
+				if (end == chunk_line.c_str()) {
+					state = HttpState::ERROR;
+					return -1;
+				}
+				chunk_line.clear();
+				if (size == 0) {
+					chunk_state = ChunkState::TRAILER;
+				}
+				else {
+					chunk_remaining = size;
+					chunk_state = ChunkState::DATA;
+				}
+			}
+			else
+			{
+				//бʾβֶν,
+				bool empty = chunk_line.empty();
+				chunk_line.clear();
+				if (empty) {
+					state = HttpState::DONE;
+				}
+			}
 			break;
 		}
-		case HttpState::DONE:
-			return 1;
-		case HttpState::ERROR:
-			return -1;
-		}	
+		case ChunkState::DATA:
+		{
+			int copy_len = (static_cast<uint64_t>(len - i) < chunk_remaining) ? len - i : static_cast<int>(chunk_remaining);
+			if (!deliverBody(buf + i, copy_len))return -1;
+			chunk_remaining -= copy_len;
+			body_received += copy_len;
+			i += copy_len;
+			if (chunk_remaining == 0) {
+				chunk_state = ChunkState::DATA_CRLF;
+			}
+			break;
+		}
+		case ChunkState::DATA_CRLF:
+		{
+			char c = buf[i++];
+			if (c == '\n') {
+				chunk_state = ChunkState::SIZE;
+			}
+			else if (c != '\r') {
+				state = HttpState::ERROR;
+				return -1;
+			}
+			break;
+		}
+		}
 	}
-	//޸:ѭķ
-	//ѭδɣ0ʾҪ
+	consumed_bytes = i;
+	if (state == HttpState::ERROR)return -1;
 	return (state == HttpState::DONE) ? 1 : 0;
 }
 
-void HttpRequest::urlDecode(std::string& dst, const std::string& src)
+bool HttpRequest::deliverBody(const char* data, size_t len)
+{
+	if (len == 0)return true;
+	if (body_sink) {
+		if (!body_sink(data, len)) {
+			state = HttpState::ERROR;
+			return false;
+		}
+		return true;
+	}
+	body.append(data, len);
+	return true;
+}
+
+void HttpRequest::urlDecode(std::pmr::string& dst, std::string_view src)
 {
 	dst.clear();
+	//󲻻ԭ,һη䵽λ
+	dst.reserve(src.size());
 	char a, b;
 
 	for (size_t i = 0; i < src.length(); i++)
@@ -1,6 +1,11 @@
 #pragma once 
+#include "RequestArena.h"
 #include <string>
+#include <string_view>
+#include <memory_resource>
 #include <map>
+#include <functional>
+#include <stdint.h>
 
 
 
@@ -13,26 +18,62 @@ enum class HttpState
 	ERROR
 };
 
+//chunkedĽ״̬
+enum class ChunkState
+{
+	SIZE,		//С
+	DATA,		//
+	DATA_CRLF,	//ݺ\r\n
+	TRAILER		//һ֮βֶ
+};
+
 class HttpRequest
 {
 public:
 	HttpRequest();
+	HttpRequest(const HttpRequest&) = delete;
+	HttpRequest& operator=(const HttpRequest&) = delete;
+	//黹arenaڴ
 	void reset();
 
-	//HTTP
+	//HTTP,ѵֽconsumed_bytes,
+	//ûѵ(粻һ)ɵ߱,´κһ
+	//1: 0:Ҫ -1:
+	//2:ͷ,Ҫʽ(chunked򳬹max_buffered_body),
+	//      ͷ֮յݴbody
 	int parse(const char* buf, int len);
 
+	//(content-lengthchunked),ݽbody_sink,δʱ׷ӵbody
+	int parseBody(const char* buf, int len);
+
 	//URL
-	static void urlDecode(std::string& dst, const std::string& src);
+	static void urlDecode(std::pmr::string& dst, std::string_view src);
 
 	//Ա
+	//Сͷʹеʱַarena,Щַ֮ǰ졢֮
+	//ͨstring:ɿͻ˾,һ彻ϴʹ
+	RequestArena arena;
 	HttpState state;
-	std::string method;
-	std::string url;
-	std::string version;
-	std::string headers;
-	int content_length;
+	std::pmr::string method;
+	std::pmr::string url;
+	std::pmr::string version;
+	std::pmr::string headers;
+	int64_t content_length;
 	std::string body;
-	int body_received;
+	int64_t body_received;
 	bool keep_alive;
+	int consumed_bytes;		//һparse/parseBodyѵֽ
+	int64_t head_bytes;		//ѽкͷܳ
+
+	//ʽ
+	bool chunked;
+	bool stream_body;
+	ChunkState chunk_state;
+	uint64_t chunk_remaining;
+	std::pmr::string chunk_line;
+	int64_t max_buffered_body;	//óȵ岻ٻ浽body(reset)
+	std::function<bool(const char* data, size_t len)> body_sink;	//falseʾ߳
+
+private:
+	bool deliverBody(const char* data, size_t len);
 };
\ No newline at end of file
@@ -8,12 +8,32 @@
 #include <string.h>
 #include <limits.h>
 #include <sys/stat.h>
-#include <dirent.h>
-#include <sys/sendfile.h>
+#include <algorithm>
+#include <signal.h>
+#include <errno.h>
+#include <stdio.h>
+
+//ǰѾһļ,sendFile,ɻصȡ
+static thread_local bool taskParked = false;
+
+//SIGHUPֻ첽źŰȫĲ,֪ͨܵͨreactor¼
+static int g_reloadPipeWrite = -1;
+
+static void onSighup(int)
+{
+	int savedErrno = errno;
+	char c = 1;
+	if (g_reloadPipeWrite != -1)
+	{
+		ssize_t n = write(g_reloadPipeWrite, &c, 1);
+		(void)n;
+	}
+	errno = savedErrno;
+}
 
 
 HttpServer::HttpServer(unsigned short port, const std::string& baseDir)
-	: port_(port), baseDir_(baseDir), running_(false),
+	: listenFd_(-1), epollFd_(-1), port_(port), baseDir_(baseDir), running_(false),
 	threadPool_(
 		//ʹlamabdaȷֻһӲ
 		[] {
@@ -24,12 +44,58 @@ HttpServer::HttpServer(unsigned short port, const std::string& baseDir)
 			unsigned num = std::thread::hardware_concurrency();
 			return num > 0 ? num * 2 : 8;
 		}()
-)
+),
+	dirCache_(fileWatcher_),
+	drainTimeoutMs_(0), draining_(false), handedOff_(false), drainDeadline_(0),
+	pathIndex_(baseDir, fileWatcher_, [this](const std::string& fileName) {
+		return getFileType(fileName);
+		}),
+	indexBudgetMs_(DEFAULT_INDEX_BUDGET_MS), indexMaxEntries_(DEFAULT_INDEX_MAX_ENTRIES)
 {
-	//ɻص
-	threadPool_.setTaskCallback([this](std::shared_ptr<Connection> conn) {
-		this->onTaskComplete(conn);
+	pthread_mutex_init(&hotMutex_, NULL);
+	reloadPipe_[0] = reloadPipe_[1] = -1;
+
+	//ɻص:ֻ߳ӽreactor,رաɾ¼reactor
+	threadPool_.setTaskCallback([this](ConnectionPtr conn) {
+		//ɼɺύ񽻻
+		if (taskParked)
+		{
+			taskParked = false;
+			return;
+		}
+		completions_.push(std::move(conn));
+		});
+
+	//Ŷӳʱֱӻ503ر
+	threadPool_.setTaskDropCallback([this](ConnectionPtr conn) {
+		//HTTP/2WebSocketϲдHTTP/1.1Ӧ,ֱӹر
+		if (conn->h2)conn->h2->abort();
+		else if (conn->ws)conn->ws->abort();
+		else if (conn->transfer)
+		{
+			//ӦѾһ,ٻ503;reactor,һοдʱŶ
+			completions_.push(std::move(conn));
+			return;
+		}
+		else this->sendOverload(conn->fd);
+		conn->request.keep_alive = false;
+		conn->request.state = HttpState::ERROR;
+		completions_.push(std::move(conn));
 		});
+	//дʱ޸epoll,reactorע
+	wsHub_.setArmNotify([this] { completions_.signal(); });
+	setAdmissionLimits(DEFAULT_MAX_QUEUE, DEFAULT_MAX_QUEUE_WAIT_MS, DEFAULT_MAX_CONNECTIONS);
+
+	//Ĭʵʴ̳߳Ϊ׼
+	auto status = threadPool_.getPoolStatus();
+	config_.threadMin = status.minThreads;
+	config_.threadMax = status.maxThreads;
+
+	//־ĬϹر:ÿҪ¼׶εʱ
+	slowLog_.configure(config_.slowlogMs, config_.slowlogIntervalSec);
+	Tracer::setTimeAll(slowLog_.enabled());
+
+	registerAdminRoutes();
 }
 
 HttpServer::~HttpServer()
@@ -40,6 +106,7 @@ HttpServer::~HttpServer()
 	threadPool_.setshutdown(true);
 	//տܳthisָĻص
 	threadPool_.clearTaskCallback();
+	pthread_mutex_destroy(&hotMutex_);
 }
 
 void HttpServer::stop()
@@ -48,14 +115,22 @@ void HttpServer::stop()
 	//ر
 	for (auto& pair : connections_)
 	{
+		//λõڹ߳,,ֻرsocket
+		if (pair.second && pair.second->ws)pair.second->ws->abort();
 		close(pair.first);
-		delete pair.second;
 	}
 	connections_.clear();
 
 	if (epollFd_ != -1)close(epollFd_);
 	if (listenFd_ != -1)close(listenFd_);
-	listenFd_ = epollFd_ = 0;
+	if (tlsListenFd_ != -1)close(tlsListenFd_);
+	listenFd_ = epollFd_ = tlsListenFd_ = -1;
+
+	//ѾӸνʱsocketļڶԷ,ɾ
+	if (hotRestart_)
+	{
+		hotRestart_->close(!handedOff_);
+	}
 }
 
 void HttpServer::printThreadPoolStatus()
@@ -68,66 +143,127 @@ void HttpServer::printThreadPoolStatus()
 	std::cout << "Busy Threads:" << status.busyThreads << std::endl;
 	std::cout << "Queue Size:" << status.queueSize << std::endl;
 	std::cout << "Load Factor:" << status.loadFactor * 100 << "%" << std::endl;
+	static const char* CLASS_NAMES[PRIORITY_LEVELS] = { "High", "Normal", "Low" };
+	for (int i = 0; i < PRIORITY_LEVELS; ++i)
+	{
+		std::cout << CLASS_NAMES[i] << " Queue:" << status.classQueueSize[i]
+			<< ",Wait:" << status.classWaitMs[i] << "ms" << std::endl;
+	}
 	std::cout << "=====================" << std::endl;
 }
 
 bool HttpServer::initListenSocket()
+{
+	listenFd_ = openListenSocket(port_);
+	return listenFd_ != -1;
+}
+
+int HttpServer::openListenSocket(unsigned short port)
 {
 	//1׽
-	listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
-	if (listenFd_ == -1)
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd == -1)
 	{
 		perror("socket");
-		return false;
+		return -1;
 	}
 
 	//2ö˿ڸ
 	int opt = 1;
-	int ret = setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+	int ret = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
 	if (ret == -1)
 	{
 		perror("setsockopt");
-		close(listenFd_);
-		return false;
+		close(fd);
+		return -1;
 	}
 
 	//3
 	struct sockaddr_in addr = {};
 	addr.sin_family = AF_INET;
-	addr.sin_port = htons(port_);
+	addr.sin_port = htons(port);
 	addr.sin_addr.s_addr = htonl(INADDR_ANY);
-	ret = bind(listenFd_, (struct sockaddr*)&addr, sizeof(addr));
+	ret = bind(fd, (struct sockaddr*)&addr, sizeof(addr));
 	if (ret == -1) {
 		perror("bind");
-		close(listenFd_);
-		return false;
+		close(fd);
+		return -1;
 	}
 
 	//4
-	ret = listen(listenFd_, 128);
+	ret = listen(fd, config_.listenBacklog);
 	if (ret == -1)
 	{
 		perror("listen");
-		close(listenFd_);
-		return false;
+		close(fd);
+		return -1;
 	}
 
-	std::cout << "Server started successfully on port:" << port_ << std::endl;
+	std::cout << "Server started successfully on port:" << port << std::endl;
 
 	//5÷
-	int flags = fcntl(listenFd_, F_GETFL, 0);
-	fcntl(listenFd_, F_SETFL, flags | O_NONBLOCK);
+	int flags = fcntl(fd, F_GETFL, 0);
+	fcntl(fd, F_SETFL, flags | O_NONBLOCK);
 
-	return true;
+	return fd;
 }
 
 void HttpServer::run()
 {
-	if (!initListenSocket()) {
+	//:·оɽʱֱӽӹļsocket,Ҫbind
+	bool inherited = false;
+	std::string snapshot;
+	if (hotRestart_)
+	{
+		std::vector<int> fds;
+		if (hotRestart_->takeover(fds, snapshot, HANDOFF_TIMEOUT_MS))
+		{
+			listenFd_ = fds[0];
+			//ڶHTTPSsocket,ûHTTPSʱӹ
+			size_t first = 1;
+			if (fds.size() > 1 && config_.tlsPort > 0)
+			{
+				tlsListenFd_ = fds[1];
+				int flags = fcntl(tlsListenFd_, F_GETFL, 0);
+				fcntl(tlsListenFd_, F_SETFL, flags | O_NONBLOCK);
+				first = 2;
+			}
+			for (size_t i = first; i < fds.size(); ++i)
+			{
+				close(fds[i]);
+			}
+			int flags = fcntl(listenFd_, F_GETFL, 0);
+			fcntl(listenFd_, F_SETFL, flags | O_NONBLOCK);
+			//backlogþɽ̵,̵
+			if (listen(listenFd_, config_.listenBacklog) == -1)perror("listen:backlog");
+			if (tlsListenFd_ != -1 && listen(tlsListenFd_, config_.listenBacklog) == -1)perror("listen:tls backlog");
+			inherited = true;
+			std::cout << "ӹܾɽ̵ļsocket:" << listenFd_ << std::endl;
+		}
+	}
+	if (!inherited && !initListenSocket()) {
+		return;
+	}
+	if (config_.tlsPort > 0 && !initTls()) {
 		return;
 	}
 	running_ = true;
 
+	//·,ԤʱԶתΪģʽ
+	pathIndex_.build(indexBudgetMs_, indexMaxEntries_);
+
+	//û׼ȷļͲԵֵ
+	if (config_.fileCalibrate)
+	{
+		calibrateFileSender();
+	}
+
+	//ǰν̵ȵбԤȻ
+	if (!snapshot.empty())
+	{
+		prewarm(snapshot);
+	}
+
 	time_t lastStatusTime = time(nullptr);
 
 	//epollʵ
@@ -146,16 +282,105 @@ void HttpServer::run()
 		return;
 	}
 
+	if (tlsListenFd_ != -1)
+	{
+		tls_.setEpoll(epollFd_);
+		ev.events = EPOLLIN;
+		ev.data.fd = tlsListenFd_;
+		if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, tlsListenFd_, &ev) == -1) {
+			perror("epoll_ctl:tls listen");
+			return;
+		}
+	}
+
+	//inotify fdepoll,ļ仯ʱʹĿ¼бʧЧ
+	if (fileWatcher_.fd() != -1)
+	{
+		ev.events = EPOLLIN;
+		ev.data.fd = fileWatcher_.fd();
+		if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fileWatcher_.fd(), &ev) == -1) {
+			perror("epoll_ctl:inotify");
+		}
+	}
+
+	//߳ɵ
+	if (completions_.fd() != -1)
+	{
+		ev.events = EPOLLIN;
+		ev.data.fd = completions_.fd();
+		if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, completions_.fd(), &ev) == -1) {
+			perror("epoll_ctl:completion queue");
+		}
+	}
+
+	//SIGHUP¼
+	if (pipe2(reloadPipe_, O_NONBLOCK | O_CLOEXEC) == 0)
+	{
+		g_reloadPipeWrite = reloadPipe_[1];
+		struct sigaction sa = {};
+		sa.sa_handler = onSighup;
+		sa.sa_flags = SA_RESTART;
+		sigemptyset(&sa.sa_mask);
+		sigaction(SIGHUP, &sa, NULL);
+
+		//дѹرյʱɷֵ;TLSм̹رsocketpair̵߳sendfile/writevֹ
+		signal(SIGPIPE, SIG_IGN);
+
+		ev.events = EPOLLIN;
+		ev.data.fd = reloadPipe_[0];
+		if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, reloadPipe_[0], &ev) == -1) {
+			perror("epoll_ctl:reload pipe");
+		}
+	}
+
+	//socket,ȴν
+	if (hotRestart_ && hotRestart_->listen())
+	{
+		ev.events = EPOLLIN;
+		ev.data.fd = hotRestart_->fd();
+		if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, hotRestart_->fd(), &ev) == -1) {
+			perror("epoll_ctl:hot restart");
+		}
+	}
+
 	std::cout << "ʼʽ,˿:" << port_ << std::endl;
 	std::cout << "epollʵ:" << epollFd_ << ",socket:" << listenFd_ << std::endl;
 
 	//¼ѭ
-	struct epoll_event events[1024];
+	Tracer::setReactorThread();
+	std::vector<struct epoll_event> events(config_.epollBatch);
+	//ӹĶ,ԼĻŲµȶ
+	std::vector<char> spill(config_.readBufferSize);
+	//ÿȡ,ͬһ
+	std::vector<ConnectionPtr> completed;
+	std::vector<std::shared_ptr<WebSocketSession>> wsArms;
 	while (running_)
 	{
-		std::cout << "ȴepoll¼..." << std::endl;
+		//¼غ¼ͶС
+		if (events.size() != static_cast<size_t>(config_.epollBatch))events.resize(config_.epollBatch);
+		if (spill.size() != static_cast<size_t>(config_.readBufferSize))spill.resize(config_.readBufferSize);
 
-		int nfds = epoll_wait(epollFd_, events, 1024, -1);
+		//ſս׶:ȫ򳬹޺˳
+		if (draining_ && (connections_.empty() || monotonicMs() > drainDeadline_))
+		{
+			std::cout << "ſս,ʣ:" << connections_.size() << std::endl;
+			running_ = false;
+			break;
+		}
+
+		//ſս׶ҪʱǷ񳬹;еȴƵʱȵһӵʱ;ɵʱ
+		int timeout = draining_ ? DRAIN_POLL_MS : -1;
+		bool pacing = !paced_.empty();
+		if (pacing)
+		{
+			long long wait = std::max(0LL, paced_.begin()->first - monotonicMs());
+			if (timeout < 0 || wait < timeout)timeout = static_cast<int>(wait);
+		}
+		if (!completions_.prepareWait())timeout = 0;
+		int nfds = epoll_wait(epollFd_, events.data(), static_cast<int>(events.size()), timeout);
+		completions_.finishWait();
+		//ÿʽһDateͷ,ֱ߳Ӹ
+		HttpDate::refresh();
 		if (nfds == -1) {
 			if (errno == EINTR) {
 				std::cout << "epoll_waitж,ȴ" << std::endl;
@@ -165,9 +390,14 @@ void HttpServer::run()
 			break;
 		}
 
+		//ȴ߳̽ص,¼ӿһȡ
+		drainCompletions(completed);
+		armWebSockets(wsArms);
+		releasePaced();
+
 		if (nfds == 0)
 		{
-			std::cout << "epoll_waitʱ¼" << std::endl;
+			if (timeout != 0 && !pacing)std::cout << "epoll_waitʱ¼" << std::endl;
 			continue;
 		}
 
@@ -179,12 +409,33 @@ void HttpServer::run()
 			lastStatusTime = currentTime;
 		}
 
-		std::cout << "epoll" << nfds << "¼" << std::endl;
-
 		for (int i = 0; i < nfds; ++i) {
-			if (events[i].data.fd == listenFd_) {
+			if (events[i].data.fd == listenFd_ || (tlsListenFd_ != -1 && events[i].data.fd == tlsListenFd_)) {
 				std::cout << "⵽¼" << std::endl;
-				acceptNewConnection();
+				acceptNewConnection(events[i].data.fd);
+			}
+			else if (events[i].data.fd == completions_.fd()) {
+				completions_.clearSignal();
+			}
+			else if (events[i].data.fd == fileWatcher_.fd()) {
+				fileWatcher_.handleEvents();
+			}
+			else if (events[i].data.fd == reloadPipe_[0]) {
+				char drain[64];
+				while (read(reloadPipe_[0], drain, sizeof(drain)) > 0) {}
+				reloadConfig();
+			}
+			else if (hotRestart_ && events[i].data.fd == hotRestart_->fd()) {
+				//νӹ:socketaccept,ʼſ
+				std::vector<int> fds = { listenFd_ };
+				if (tlsListenFd_ != -1)fds.push_back(tlsListenFd_);
+				if (hotRestart_->handoff(fds, hotFileSnapshot()))
+				{
+					startDraining();
+				}
+			}
+			else if (tls_.enabled() && tls_.handleEvent(events[i].data.fd)) {
+				//TLSֻû̬м̵socket
 			}
 			else {
 				//ͻ
@@ -198,66 +449,139 @@ void HttpServer::run()
 					std::cout << ":Ӳڣfd=" << cfd << std::endl;
 					continue;
 				}
+				//λΪ:ڹ߳д,ɺ¼
+				if (!it->second)continue;
 
-				std::shared_ptr<Connection> conn = connections_[cfd];
-
-				//ȡ
-				char buf[8192];
-				ssize_t nread = recv(cfd, buf, sizeof(buf), 0);
-				if (nread > 0) {
-					//HTTP
-					int ret = conn->request.parse(buf, static_cast<int>(nread));
-					if (ret == 1)//
-					{//ύ̳߳
-						std::shared_ptr<Connection>conn = connections_[cfd];
-						std::cout << "ύ̳߳" << endl;
-						threadPool_.addTask([this](void* arg) //ֵü=4
-							{
-								Connection* conn = static_cast<Connection*>(arg);
-								this->processRequest(conn);
-							},
-							conn);
-					}
-					else if (ret == -1) {//󣬹ر
-						close(cfd);
-						connections_.erase(cfd);
-						break;
-					}
-					//ret==0ʾҪݣȴ
-				}
-				else if (nread == 0) {
-					close(cfd);
-					connections_.erase(cfd);
+				//ֱʹӱе;ύ̳߳ʱƽ,֮connΪ,ٷ
+				ConnectionPtr& conn = it->second;
+
+				//HTTP/2WebSocketӺʽе:reactor,̰߳ٶȶȡ
+				//ƬеĴļ:socketд,ύһƬ
+				if (conn->h2 || conn->ws || conn->transfer || (conn->request.stream_body && conn->request.state == HttpState::BODY))
+				{
+					submitRequest(std::move(conn));
+					continue;
 				}
-				else 
+
+				//ش:EAGAINΪֹ,ÿζȡ,ʣµں
+				bool closeConn = false;
+				for (;;)
 				{
-					if (errno != EAGAIN && errno != EWOULDBLOCK) {
-						std::cout << "ݿ" << std::endl;
+					ssize_t nread;
+					if (conn->ssl != nullptr)
+					{
+						nread = TlsTerminator::read(conn->ssl, spill.data(), spill.size());
+						if (nread > 0)conn->readBuf.append(spill.data(), nread);
 					}
 					else
 					{
-						perror("recv");
-						close(cfd);
-						connections_.erase(cfd);
+						nread = conn->readBuf.readFrom(cfd, spill.data(), spill.size());
+					}
+					if (nread > 0)
+					{
+						HttpRequest& req = conn->request;
+						if (conn->trace.firstByte == 0 && Tracer::timing())conn->trace.firstByte = Tracer::nowNs();
+						//HTTP/2ǰԿͷ:֮ϵݶHttp2Session
+						if (config_.http2 && req.state == HttpState::REQUEST_LINE && req.head_bytes == 0)
+						{
+							int match = Http2Session::matchPreface(conn->readBuf.data(), conn->readBuf.size());
+							if (match == 0)continue;
+							if (match == 1)
+							{
+								Connection* raw = conn.get();
+								conn->h2.reset(new Http2Session(cfd, conn->ssl, config_.maxBufferedBody,
+									[this, raw](uint32_t id, HttpRequest& r) { processHttp2Request(raw, id, r); }));
+								conn->h2->feed(conn->readBuf.data(), conn->readBuf.size());
+								conn->readBuf.clear();
+								conn->readBuf.shrink();
+								submitRequest(std::move(conn));
+								break;
+							}
+						}
+						ParseStep step = parseBuffered(conn);
+						if (step == ParseStep::SUBMITTED)break;
+						if (step == ParseStep::CLOSE)
+						{
+							closeConn = true;
+							break;
+						}
+						continue;
+					}
+					if (nread == 0)
+					{
+						closeConn = true;
+						break;
+					}
+					if (errno == EINTR)continue;
+					if (errno == EAGAIN || errno == EWOULDBLOCK)
+					{
+						//ݶ,Ҫ,EPOLLONESHOTҪ¼
+						conn->readBuf.shrink();
+						rearmRead(cfd);
+						break;
 					}
-					//EAGAINʾûˣ˳ѭ
 					perror("recv");
+					closeConn = true;
+					break;
+				}
+				if (closeConn)
+				{
+					close(cfd);
+					connections_.erase(cfd);
 				}
 			}
 		}
 	}																																																																																																																																																																																																													
 }
 
-void HttpServer::acceptNewConnection()
+HttpServer::ParseStep HttpServer::parseBuffered(ConnectionPtr& conn)
+{
+	int cfd = conn->fd;
+	HttpRequest& req = conn->request;
+	int ret = req.parse(conn->readBuf.data(), static_cast<int>(conn->readBuf.size()));
+	//ֻѽõĲ,ˮкڻ,ɺٽ
+	conn->readBuf.consume(req.consumed_bytes);
+	//кͷ(ûжһ)
+	bool inHead = req.state == HttpState::REQUEST_LINE || req.state == HttpState::HEADER;
+	if (ret != -1 && req.head_bytes + static_cast<int64_t>(inHead ? conn->readBuf.size() : 0) >
+		static_cast<int64_t>(MAX_REQUEST_HEAD))
+	{
+		sendErrorResponse(cfd, 431, "Request Header Fields Too Large");
+		return ParseStep::CLOSE;
+	}
+	if (ret == 1 || ret == 2)//,ͷҪʽ
+	{
+		Tracer::sample(conn->trace);
+		//:ֱӻ429ر,̳߳
+		if (!rateLimiter_.allowRequest(conn->peerAddr))
+		{
+			sendRateLimited(cfd);
+			return ParseStep::CLOSE;
+		}
+		//֮߳ǰ黹ջ,֮reactorٷ
+		conn->readBuf.shrink();
+		std::cout << "ύ̳߳" << endl;
+		submitRequest(std::move(conn));
+		return ParseStep::SUBMITTED;
+	}
+	if (ret == -1)//󣬹ر
+	{
+		return ParseStep::CLOSE;
+	}
+	return ParseStep::NEED_MORE;
+}
+
+void HttpServer::acceptNewConnection(int listenFd)
 {
 	std::cout << "===acceptNewConnection===" << std::endl;
 
+	bool isTls = listenFd == tlsListenFd_;
 	int acceptCount = 0;
 	while (true) 
 	{
 		struct sockaddr_in clientAddr = {};
 		socklen_t clientLen = sizeof(clientAddr);
-		int cfd = accept(listenFd_, (struct sockaddr*)&clientAddr, &clientLen);
+		int cfd = accept(listenFd, (struct sockaddr*)&clientAddr, &clientLen);
 		if (cfd == -1) {
 			if (errno == EAGAIN || errno == EWOULDBLOCK) {
 				//ûи
@@ -268,286 +592,1578 @@ void HttpServer::acceptNewConnection()
 			break;
 		}
 
+		//,ֱӻԤɵ503,Ӷ
+		//HTTPSӻû,Ӧû,ֱӹر
+		if (maxConnections_ > 0 && connections_.size() + tls_.handshaking() >= static_cast<size_t>(maxConnections_))
+		{
+			if (!isTls)sendOverload(cfd);
+			close(cfd);
+			connRejected_++;
+			continue;
+		}
+
+		//,ͬӶ
+		if (!rateLimiter_.allowConnection(clientAddr.sin_addr))
+		{
+			if (!isTls)sendRateLimited(cfd);
+			close(cfd);
+			continue;
+		}
+
 		acceptCount++;
 		std::cout << " #" << acceptCount << ",ļ:" << cfd << std::endl;
-		std::cout << "ͻ˵ַ:" << inet_ntoa(clientAddr.sin_addr) << ":" << ntohs(clientAddr.sin_port) << std::endl;
 		//÷
 		int flags = fcntl(cfd, F_GETFL, 0);
 		flags |= O_NONBLOCK;//ӷ־
 		fcntl(cfd, F_SETFL, flags );
 
-		//Ӷ
-		//ָshared_ptr(ü=1)
-		auto conn = std::make_shared<Connection>();
-		conn->fd = cfd;
-		conn->request.reset();
-
-		//ӵӳ
-		connections_[cfd] = conn;
-
-		//ӵepoll
-		struct epoll_event ev = {};
-		ev.events = EPOLLIN | EPOLLET |EPOLLONESHOT;
-		ev.data.fd = cfd;
-		if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, cfd, &ev) == -1) {
-			perror("epoll_ctl:client_sock");
-			close(cfd);
-			connections_.erase(cfd);
+		if (isTls)
+		{
+			//ɺɻصaddConnection
+			tls_.start(cfd, clientAddr);
 			continue;
 		}
-		else {
-			std::cout << "ɹͻsocket:" << cfd << "ӵepoll" << std::endl;
-		}
-		std::cout << "Ӵ" << std::endl;
+		addConnection(cfd, clientAddr, nullptr);
 	}
 	std::cout << "===뿪 acceptNewConnection ===" << std::endl;
 }
 
-void HttpServer::processRequest(Connection* conn) {
-	HttpRequest& req = conn->request;
-
-	//ӿ
-	if (req.url == "/admin/threadpool-status")
-	{
-		auto status = server->getThreadPoolStatus();
-		std::string jsonResponse = "HTTP/1.1 200 OK\r\nContent-Type:application/json\r\n\r\n";
-		jsonResponse += "{";
-		jsonResponse += "\"minThreads\":" + std::to_string(status.minThreads) + ",";
-		jsonResponse += "\"maxThreads\":" + std::to_string(status.maxThreads) + ",";
-		jsonResponse += "\"LiveThreads\":" + std::to_string(status.LiveThreads) + ",";
-		jsonResponse += "\"busyThreads\":" + std::to_string(status.busyThreads) + ",";
-		jsonResponse += "\"queueSize\":" + std::to_string(status.queueSize) + ",";
-		jsonResponse += "\"oadFactor\":" + std::to_string(status.loadFactor);
-		jsonResponse += "}";
-
-		std::cout << "͹ӿӦ" << std::endl;
-		send(conn->fd, jsonResponse.c_str(), jsonResponse.size(), 0);
-		return;
-	}
+void HttpServer::addConnection(int cfd, const struct sockaddr_in& clientAddr, SSL* ssl)
+{
+	//inet_ntoaؾ̬,̰߳ȫ
+	char ip[INET_ADDRSTRLEN] = "";
+	inet_ntop(AF_INET, &clientAddr.sin_addr, ip, sizeof(ip));
+	std::cout << "ͻ˵ַ:" << ip << ":" << ntohs(clientAddr.sin_port) << std::endl;
 
-	//URL
-	std::string decodeUrl;
-	HttpRequest::urlDecode(decodeUrl, req.url);
-	std::cout << "URL:" << decodeUrl << std::endl;
+	//Ӷ
+	//Ӷ(ü=1)
+	ConnectionPtr conn = makeRef<Connection>();
+	conn->fd = cfd;
+	conn->ssl = ssl;
+	conn->request.reset();
+	conn->request.max_buffered_body = config_.maxBufferedBody;
+	conn->peerIp = ip;
+	conn->peerAddr = clientAddr.sin_addr;
+	if (Tracer::timing())conn->trace.accept = Tracer::nowNs();
 
-	//·
-	std::string fullpath = baseDir_;
-	if (decodeUrl == "/" || decodeUrl.empty()) {
-		//ʹûĿ¼
-		fullpath += "/index.html";
-		std::cout << "ʹĬļ:" << fullpath << std::endl;
-	}
-	else {
-		fullpath += decodeUrl;
-		std::cout << "·:" << fullpath << std::endl;
-	}
+	//ӵӳ
+	connections_[cfd] = conn;
 
-	//ʹrealpath淶·
-	char resolved_path[PATH_MAX];
-	if (realpath(fullpath.c_str(), resolved_path) == NULL) {
-		sendErrorResponse(conn->fd, 404, "Not Found");
+	//ӵepoll
+	struct epoll_event ev = {};
+	ev.events = EPOLLIN | EPOLLET |EPOLLONESHOT;
+	ev.data.fd = cfd;
+	if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, cfd, &ev) == -1) {
+		perror("epoll_ctl:client_sock");
+		close(cfd);
+		connections_.erase(cfd);
 		return;
 	}
+	std::cout << "ɹͻsocket:" << cfd << "ӵepoll" << std::endl;
+}
 
-	//·
-	if (strncmp(resolved_path, baseDir_.c_str(),baseDir_.length()) != 0) {
-		sendErrorResponse(conn->fd, 403, "Forbidden");
-		return;
+bool HttpServer::initTls()
+{
+	std::string error;
+	if (!tls_.init(config_.tlsCert, config_.tlsKey, error))
+	{
+		std::cout << "TLS֤ʧ:" << error << std::endl;
+		return false;
 	}
+	tls_.setReadyCallback([this](int fd, SSL* ssl, const struct sockaddr_in& addr) {
+		addConnection(fd, addr, ssl);
+		});
+	tls_.setHttp2(config_.http2 != 0);
 
-	//ȡļ
-	struct stat st;
-	if (stat(resolved_path, &st) == -1) {
-		//Է404ҳ
-		std::string not_found_path = baseDir_ + "/404.html";
-		if (access(not_found_path.c_str(), R_OK) == 0) {
-			server->sendFile(not_found_path, conn->fd);
-		}
-		else
-		{
-			sendErrorResponse(conn->fd, 404, "Not Found");
-		}
-		return;
-	}
-	else if(access(resolved_path, F_OK)==0)
+	//ʱѴӾɽ̽ӹ
+	if (tlsListenFd_ == -1)
 	{
-		if (S_ISDIR(st.st_mode))
-		{
-			sendDir(resolved_path, decodeUrl, conn->fd);
-		}
-		else
-		{
-			//ļǰȷHTTPͷ
-			std::string fileType = getFileType(resolved_path);
-			sendHeadMsg(conn->fd, 200, "OK", fileType, static_cast<int>(st.st_size));
-			sendFile(resolved_path, conn->fd);
-		}
-		return;
+		tlsListenFd_ = openListenSocket(static_cast<unsigned short>(config_.tlsPort));
+		if (tlsListenFd_ == -1)return false;
 	}
+	std::cout << "HTTPS˿:" << config_.tlsPort << std::endl;
+	return true;
 }
 
-void HttpServer::onTaskComplete(std::shared_ptr<Connection> conn) {
-	
-	//֤connǷǿָԼЧָ
-	if (!conn|| conn->fd<=0)
+bool HttpServer::route(unsigned methods, const std::string& pattern, HandlerFunc handler)
+{
+	if (!router_.add(methods, pattern, std::move(handler)))
 	{
-		std::cout << ":connΪЧConnectionָ" << std::endl;
-		return;
-	}
-	
-	//ɺ߼
-	if (!conn->request.keep_alive) {
-		close(conn->fd);
-		connections_.erase(conn->fd);//ü-11
-		//connü=0ԶɾConnection
+		std::cout << "·עʧ:" << pattern << std::endl;
+		return false;
 	}
-	else {
-		//״̬׼һ
-		conn->request.reset();
+	return true;
+}
 
-		//¼EPOLL¼
-		struct epoll_event ev = {};
-		ev.events = EPOLLIN | EPOLLET | EPOLLONESHOT;
-		ev.data.fd = conn->fd;
-		epoll_ctl(epollFd_, EPOLL_CTL_MOD, conn->fd, &ev);
+bool HttpServer::websocket(const std::string& prefix, WebSocketSession::MessageHandler onMessage)
+{
+	if (prefix.empty() || prefix[0] != '/')
+	{
+		std::cout << "WebSocket·/ͷ:" << prefix << std::endl;
+		return false;
 	}
+	wsRoutes_.emplace_back(prefix, std::move(onMessage));
+	return true;
 }
 
-std::string HttpServer::getFileType(const std::string& fileName)
+size_t HttpServer::publish(const std::string& topic, std::string_view message, bool binary)
 {
-	const char* dot = strrchr(fileName.c_str(), '.');
-	if (dot == NULL)
-		return "text/plain; charset=utf-8";
-	if (strcmp(dot, ".html") == 0 || strcmp(dot, ".htm") == 0)
-		return "text/html;charset=utf-8";
-	if (strcmp(dot, ".jpg") == 0 || strcmp(dot, ".jpeg") == 0)
-		return "image/jpeg";
-	if (strcmp(dot, ".gif") == 0)
-		return "image/gif";
-	if (strcmp(dot, ".png") == 0)
-		return "image/png";
-	if (strcmp(dot, ".css") == 0)
-		return "text/css";
-	if (strcmp(dot, ".js") == 0)
-		return "application/javascript";
-	if (strcmp(dot, ".pdf") == 0)
-		return "application/pdf";
-	if (strcmp(dot, ".zip") == 0)
-		return "application/zip";
-
-	return "text/plain;charset=utf-8";
+	return wsHub_.publish(topic, message, binary);
 }
 
-void HttpServer::sendDir(const std::string& dirName, const std::string& urlPath, int cfd)
+bool HttpServer::adminAllowed(std::string_view peerIp, std::string_view token)
 {
-	std::string buf = "<html><head><title>Index of" + urlPath + "</title></head><body><h1>Index of"
-		+ urlPath + "</h1><hr><table>";
-
-	DIR* dir = opendir(dirName.c_str());
-	if (dir == NULL) {
-		sendErrorResponse(cfd, 500, "Internal Server Error");
-		return;
+	if (peerIp.compare(0, 4, "127.") == 0 || peerIp == "::1" || peerIp.compare(0, 11, "::ffff:127.") == 0)
+	{
+		return true;
 	}
+	if (token.empty())return false;
+	pthread_mutex_lock(&configMutex_);
+	bool ok = token == config_.adminToken;
+	pthread_mutex_unlock(&configMutex_);
+	return ok;
+}
 
-	//Ŀ¼ɨ
-	struct dirent* entry;
-	while ((entry = readdir(dir)) != NULL)
-	{
-		std::string name = entry->d_name;
-		if (name == "." || name == "..")continue;
+static void sendAdminDenied(ResponseWriter& resp)
+{
+	resp.setStatus(403, "Forbidden");
+	resp.sendJson("{\"error\":\"admin access requires a loopback client or X-Admin-Token\"}");
+}
 
-		std::string subPath = dirName + "/" + name;
-		struct stat st;
-		if (stat(subPath.c_str(), &st) == -1)continue;
+void HttpServer::registerAdminRoutes()
+{
+	//¼:reactorִ߳,ֻ֪ͨ
+	route(METHOD_POST, "/admin/reload", [this](const RequestView& req, ResponseWriter& resp) {
+		if (!adminAllowed(req))
+		{
+			sendAdminDenied(resp);
+			return;
+		}
+		requestReload();
+		resp.setStatus(202, "Accepted");
+		resp.sendJson("{\"reload\":\"scheduled\"}");
+		});
 
-		std::string link = urlPath;
-		if (link.empty()||link.back() != '/')link += "/";
-		link += name;
+	//ǰЧ
+	route(METHOD_GET, "/admin/config", [this](const RequestView&, ResponseWriter& resp) {
+		resp.sendJson(configJson());
+		});
 
-		if (S_ISDIR(st.st_mode)) {
-			link = "/";
-			buf += "<tr><td><a href=\"" + link + "\">" + name + "/</a></td><td>" + std::to_string(st.st_size) + "</td></tr>";
-		}
-		else
+	//ļͲԵļֵ,calibrateл׼(ռһ߳Լһ)
+	route(METHOD_GET, "/admin/file-strategy", [this](const RequestView&, ResponseWriter& resp) {
+		resp.sendJson(fileSender_.statsJson());
+		});
+	route(METHOD_POST, "/admin/file-strategy/calibrate", [this](const RequestView& req, ResponseWriter& resp) {
+		if (!adminAllowed(req))
 		{
-			buf += "<tr><td><a href=\"" + link + "\">" + name + "</a></td><td>" + std::to_string(st.st_size) + "</td></tr>";
-
+			sendAdminDenied(resp);
+			return;
 		}
-	}
-	closedir(dir);
-	 
-	buf += "</table><hr></body></html>";
+		calibrateFileSender();
+		resp.sendJson(fileSender_.statsJson());
+		});
 
-	//ʽת
-	sendHeadMsg(cfd, 200, "OK", "text/html;charset=utf-8",static_cast<int>(buf.size()));
-	send(cfd, buf.c_str(), buf.size(), 0);
-}
+	//״̬
+	route(METHOD_GET, "/admin/proxy", [this](const RequestView&, ResponseWriter& resp) {
+		resp.sendJson(proxy_.statsJson());
+		});
 
-void HttpServer::sendFile(const std::string& fileName, int cfd)
-{
-	int fd = open(fileName.c_str(), O_RDONLY);
-	if (fd == -1)
-	{
-		sendErrorResponse(cfd, 404, "NotFound");
-		return;
-	}
+	//:ʡʵʺٵӦ
+	route(METHOD_GET, "/admin/throttle", [this](const RequestView&, ResponseWriter& resp) {
+		resp.sendJson(throttle_.statsJson());
+		});
 
-	struct stat st;
-	if (fstat(fd, &st) == -1)
-	{
-		close(fd);
-		sendErrorResponse(cfd, 500, "Internal Server Error");
-		return;
-	}	
+	//HTTPSִ͸ּܷʽ
+	route(METHOD_GET, "/admin/tls", [this](const RequestView&, ResponseWriter& resp) {
+		resp.sendJson(tls_.statsJson());
+		});
 
-	//ȡļ
-	std::string FileType = getFileType(fileName);
-	//ͷ
-	sendHeadMsg(cfd, 200, "OK", FileType, static_cast<int>(st.st_size));
+	//HTTP/2ỰЭ
+	route(METHOD_GET, "/admin/http2", [](const RequestView&, ResponseWriter& resp) {
+		resp.sendJson(Http2Session::statsJson());
+		});
 
-	off_t offset = 0;
-	ssize_t sent = 0;
-	while (offset < st.st_size) {
-		sent = sendfile(cfd, fd, &offset, st.st_size - offset);
-		if (sent < 0)
+	//WebSocket㲥,ؽյĶ;ֱӵpublish()
+	route(METHOD_POST, "/admin/publish/*", [this](const RequestView& req, ResponseWriter& resp) {
+		if (!adminAllowed(req))
 		{
-			if (errno == EAGAIN || errno == EINTR)continue;
-			break;
+			sendAdminDenied(resp);
+			return;
 		}
-	}
-	close(fd);
-}
+		size_t n = publish(std::string(req.match->wildcard), req.body);
+		resp.sendJson("{\"delivered\":" + std::to_string(n) + "}");
+		});
 
-void HttpServer::sendHeadMsg(int cfd, int status, const std::string& descr, const std::string& type, int len)
-{
-	std::string buf = "HTTP/1.1 " + std::to_string(status) + " " + descr + "\r\n";
-	buf += "Content-Type:" + type + "\r\n";
-	if (len >= 0)
-	{
-		buf += "Content-Length:" + std::to_string(len) + "\r\n";
-	}
-	buf += "Connection:close\r\n\r\n";
+	//׶,Chrome traceʽ,Perfetto(ui.perfetto.dev)д
+	route(METHOD_GET, "/admin/trace", [](const RequestView&, ResponseWriter& resp) {
+		resp.sendJson(Tracer::chromeJson());
+		});
 
-	send(cfd, buf.c_str(), buf.size(), 0);
-}
+	//һ,׶κʱ̳߳״̬
+	route(METHOD_GET, "/admin/slowlog", [this](const RequestView&, ResponseWriter& resp) {
+		resp.sendJson(slowLog_.json());
+		});
 
-void HttpServer::sendErrorResponse(int cfd, int status, const std::string& description)
-{
-	std::string body = "<html><body><h1>" + std::to_string(status) + " " + description + "</h1></body></html>";
+	//WebSocket͹㲥
+	route(METHOD_GET, "/admin/websocket", [this](const RequestView&, ResponseWriter& resp) {
+		resp.sendJson(wsHub_.statsJson());
+		});
 
-	std::string head = "HTTP/1.1 " + std::to_string(status) + " " + description + "\r\n";
-	head += "Content-Type:text/html\r\n";
-	head += "Content-Length:" + std::to_string(body.size()) + "\r\n";
-	head += "Connection:close\r\n\r\n";
+	//ٵֵܾͱ̭
+	route(METHOD_GET, "/admin/ratelimit", [this](const RequestView&, ResponseWriter& resp) {
+		resp.sendJson(rateLimiter_.statsJson());
+		});
 
-	send(cfd, head.c_str(), head.size(), 0);
+	//̳߳״̬
+	route(METHOD_GET, "/admin/threadpool-status", [this](const RequestView&, ResponseWriter& resp) {
+		auto status = getThreadPoolStatus();
+		std::string json = "{";
+		json += "\"minThreads\":" + std::to_string(status.minThreads) + ",";
+		json += "\"maxThreads\":" + std::to_string(status.maxThreads) + ",";
+		json += "\"LiveThreads\":" + std::to_string(status.LiveThreads) + ",";
+		json += "\"busyThreads\":" + std::to_string(status.busyThreads) + ",";
+		json += "\"queueSize\":" + std::to_string(status.queueSize) + ",";
+		json += "\"oadFactor\":" + std::to_string(status.loadFactor) + ",";
+		json += "\"shedQueueFull\":" + std::to_string(status.rejectedTasks) + ",";
+		json += "\"shedStale\":" + std::to_string(status.staleTasks) + ",";
+		json += "\"shedConnections\":" + std::to_string(connRejected_.load()) + ",";
+		//߳̽reactor
+		json += "\"completions\":" + std::to_string(completions_.completed()) + ",";
+		json += "\"completionBatches\":" + std::to_string(completions_.batches()) + ",";
+		json += "\"completionSignals\":" + std::to_string(completions_.signals()) + ",";
+		//ÿȼŶ,˳Ϊhigh,normal,low
+		json += "\"classes\":[";
+		for (int i = 0; i < PRIORITY_LEVELS; ++i)
+		{
+			if (i > 0)json += ",";
+			json += "{\"queueSize\":" + std::to_string(status.classQueueSize[i]) +
+				",\"waitMs\":" + std::to_string(status.classWaitMs[i]) + "}";
+		}
+		json += "]";
+		json += "}";
+		resp.sendJson(json);
+		});
 }
 
-void HttpServer::setThreadPoolSize(int minThreads, int maxThreads)
+bool HttpServer::dispatchRoute(Connection* conn)
+{
+	ResponseWriter resp(conn->fd);
+	resp.setChunked(conn->request.version != "HTTP/1.0");
+	resp.setKeepAlive(conn->request.keep_alive);
+	if (!dispatchRoute(conn->request, conn->peerIp, resp))return false;
+	//socketдʱûдĲֽreactor,дʱʹļһ
+	if (resp.hasUnsent())conn->transfer = FileSender::bufferTransfer(resp.takeUnsent(), resp.bytesSent());
+	conn->request.keep_alive = resp.keepAlive();
+	conn->trace.source = "route";
+	conn->trace.bytesOut = static_cast<int64_t>(resp.bytesSent());
+	return true;
+}
+
+bool HttpServer::dispatchRoute(const HttpRequest& req, const std::string& peerIp, ResponseWriter& resp)
+{
+	//ͼֱָе,ҹ̲ڴ
+	RequestView view;
+	std::string_view url(req.url);
+	size_t q = url.find('?');
+	view.method = req.method;
+	view.path = url.substr(0, q);
+	view.query = q == std::string_view::npos ? std::string_view() : url.substr(q + 1);
+	view.version = req.version;
+	view.headers = req.headers;
+	view.body = req.body;
+	view.peerIp = peerIp;
+
+	RouteMatch match;
+	HttpHandler* handler = nullptr;
+	Router::Result result = router_.lookup(view.method, view.path, match, handler);
+	if (result == Router::Result::NOT_FOUND)
+	{
+		return false;
+	}
+	if (result == Router::Result::METHOD_NOT_ALLOWED)
+	{
+		resp.setStatus(405, "Method Not Allowed");
+		resp.send(errorPage(405, "Method Not Allowed"), "text/html");
+		return true;
+	}
+
+	view.match = &match;
+	handler->handle(view, resp);
+	//ʽӦûнʱϽ
+	if (resp.streaming())
+	{
+		resp.end();
+	}
+	else if (!resp.sent())
+	{
+		//ûдӦʱһӦ,ͻһֱȴ
+		resp.setStatus(204, "No Content");
+		resp.send("");
+	}
+	return true;
+}
+
+void HttpServer::processRequest(Connection* conn) {
+	HttpRequest& req = conn->request;
+
+	//WebSocket:ɹӲٴHTTP
+	if (upgradeWebSocket(conn))
+	{
+		return;
+	}
+
+	//Ȳ·ɱ,ӿںͨroute()עĴ
+	if (dispatchRoute(conn))
+	{
+		return;
+	}
+
+	//ƥ·ɵת,ٲұļ
+	Proxy::RoutePtr route = proxy_.match(req.url);
+	if (route)
+	{
+		conn->trace.source = "proxy";
+		//ӦConnection:closeת,ӦԹرӽ
+		req.keep_alive = false;
+		proxy_.forward(*route, conn->fd, req, conn->peerIp);
+		return;
+	}
+
+	//URLarena;ļ·FileSender·йϣkey,ÿ̸߳õĽڵ
+	std::pmr::string decodeUrl(&req.arena);
+	static thread_local PathIndex::Node node;
+	int status = resolveStatic(req.url, decodeUrl, node);
+	if (status == 403) {
+		conn->trace.source = "error";
+		sendErrorResponse(conn->fd, 403, "Forbidden", req.keep_alive);
+		return;
+	}
+	if (status == 404) {
+		//404ҳʱ
+		if (!node.path.empty()) {
+			sendFile(node.path, conn->fd, *node.mime, &conn->trace, conn);
+		}
+		else
+		{
+			conn->trace.source = "error";
+			sendErrorResponse(conn->fd, 404, "Not Found", req.keep_alive);
+		}
+		return;
+	}
+
+	if (conn->trace.timed)conn->trace.sendStart = Tracer::nowNs();
+	if (node.isDir)
+	{
+		req.keep_alive = sendDir(node.path, decodeUrl, conn->fd, conn->transfer, &conn->trace, req.version != "HTTP/1.0", req.keep_alive);
+	}
+	else
+	{
+		sendFile(node.path, conn->fd, *node.mime, &conn->trace, conn);
+	}
+}
+
+int HttpServer::resolveStatic(std::string_view url, std::pmr::string& decodeUrl, PathIndex::Node& node)
+{
+	//URL
+	HttpRequest::urlDecode(decodeUrl, url);
+	std::cout << "URL:" << decodeUrl << std::endl;
+
+	//Ŀ¼ʹĬļ
+	std::string_view lookupUrl = decodeUrl;
+	if (decodeUrl == "/" || decodeUrl.empty()) {
+		lookupUrl = "/index.html";
+		std::cout << "ʹĬļ:" << lookupUrl << std::endl;
+	}
+
+	//·в,..ͷӵİ
+	PathIndex::Result result = pathIndex_.lookup(lookupUrl, node);
+	if (result == PathIndex::Result::FORBIDDEN) {
+		return 403;
+	}
+	if (result == PathIndex::Result::NOT_FOUND) {
+		PathIndex::Node notFound;
+		if (pathIndex_.lookup("/404.html", notFound) == PathIndex::Result::OK && !notFound.isDir) {
+			node = notFound;
+		}
+		else
+		{
+			node.path.clear();
+		}
+		return 404;
+	}
+
+	recordHotFile(lookupUrl);
+	return 200;
+}
+
+void HttpServer::serveHttp2(Connection* conn)
+{
+	conn->h2->serve();
+}
+
+bool HttpServer::upgradeWebSocket(Connection* conn)
+{
+	if (wsRoutes_.empty())return false;
+	HttpRequest& req = conn->request;
+	std::string_view url(req.url);
+	std::string_view path = url.substr(0, url.find('?'));
+	const std::pair<std::string, WebSocketSession::MessageHandler>* matched = nullptr;
+	for (auto& r : wsRoutes_)
+	{
+		if (path.compare(0, r.first.size(), r.first) == 0)
+		{
+			matched = &r;
+			break;
+		}
+	}
+	if (matched == nullptr)return false;
+
+	RequestView view;
+	view.headers = req.headers;
+	std::string_view upgrade = view.header("Upgrade");
+	std::string_view key = view.header("Sec-WebSocket-Key");
+	if (req.method != "GET" || upgrade.size() != 9 || strncasecmp(upgrade.data(), "websocket", 9) != 0 || key.empty())
+	{
+		sendErrorResponse(conn->fd, 426, "Upgrade Required");
+		req.keep_alive = false;
+		return true;
+	}
+	if (view.header("Sec-WebSocket-Version") != "13")
+	{
+		ResponseHead head;
+		head.begin(426);
+		head.raw("Sec-WebSocket-Version:13\r\n");
+		head.contentLength(0);
+		head.finish();
+		send(conn->fd, head.data(), head.size(), 0);
+		req.keep_alive = false;
+		return true;
+	}
+
+	ResponseHead handshake;
+	handshake.begin(101);
+	handshake.raw("Upgrade:websocket\r\nConnection:Upgrade\r\n");
+	handshake.header("Sec-WebSocket-Accept", WebSocketSession::acceptKey(key));
+	handshake.raw("\r\n");
+	std::string_view head = handshake.view();
+	if (send(conn->fd, head.data(), head.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(head.size()))
+	{
+		req.keep_alive = false;
+		return true;
+	}
+
+	auto session = std::make_shared<WebSocketSession>(conn->fd, conn->ssl, epollFd_, wsHub_,
+		std::string(path.substr(matched->first.size())), matched->second);
+	//֮ͻ˿Ѿ֡
+	if (conn->readBuf.size() > 0)
+	{
+		session->feed(conn->readBuf.data(), conn->readBuf.size());
+		conn->readBuf.clear();
+		conn->readBuf.shrink();
+	}
+	//ȹҵٶ,֮Ĺ㲥עʱreactorҵỰ
+	conn->ws = session;
+	wsHub_.subscribe(session);
+	session->serve();
+	return true;
+}
+
+void HttpServer::serveWebSocket(Connection* conn)
+{
+	conn->ws->serve();
+}
+
+//HTTP/2ûжsocket,ӦȻٰ֡
+class BufferSink : public ProxySink
+{
+public:
+	explicit BufferSink(size_t limit) : limit_(limit) {}
+	int fd() const override { return -1; }
+	bool write(const char* p, size_t len) override
+	{
+		if (data.size() + len > limit_)return false;
+		data.append(p, len);
+		return true;
+	}
+
+	std::string data;
+
+private:
+	size_t limit_;
+};
+
+void HttpServer::processHttp2Request(Connection* conn, uint32_t streamId, HttpRequest& req)
+{
+	Http2Session& h2 = *conn->h2;
+	static const HeaderList HTML = { { "content-type", "text/html" } };
+
+	//ÿһ
+	if (!rateLimiter_.allowRequest(conn->peerAddr))
+	{
+		h2.respond(streamId, 429, { { "content-type", "text/plain" }, { "retry-after", "1" } }, std::string());
+		return;
+	}
+
+	//·ɵĴճʹResponseWriter,ͷתHTTP/2ĸʽ
+	ResponseWriter resp([&h2, streamId](int status, std::string_view type, std::string_view headers, std::string_view body) {
+		HeaderList list;
+		list.emplace_back("content-type", std::string(type));
+		size_t pos = 0;
+		while (pos < headers.size())
+		{
+			size_t eol = headers.find("\r\n", pos);
+			if (eol == std::string_view::npos)eol = headers.size();
+			std::string_view line = headers.substr(pos, eol - pos);
+			pos = eol + 2;
+			size_t colon = line.find(':');
+			if (colon != std::string_view::npos)list.emplace_back(std::string(line.substr(0, colon)), std::string(line.substr(colon + 1)));
+		}
+		h2.respond(streamId, status, list, std::string(body));
+		return true;
+		});
+	if (dispatchRoute(req, conn->peerIp, resp))
+	{
+		return;
+	}
+
+	Proxy::RoutePtr route = proxy_.match(req.url);
+	if (route)
+	{
+		BufferSink sink(H2_PROXY_BUFFER);
+		if (proxy_.forward(*route, sink, req, conn->peerIp))h2.respondHttp1(streamId, sink.data);
+		else h2.respond(streamId, 502, HTML, errorPage(502, "Bad Gateway"));
+		return;
+	}
+
+	std::pmr::string decodeUrl(&req.arena);
+	PathIndex::Node node;
+	int status = resolveStatic(req.url, decodeUrl, node);
+	if (status == 403 || (status == 404 && node.path.empty()))
+	{
+		const char* descr = status == 403 ? "Forbidden" : "Not Found";
+		h2.respond(streamId, status, HTML, errorPage(status, descr));
+		return;
+	}
+	if (node.isDir)
+	{
+		DirCache::ListingPtr listing = dirCache_.get(node.path, decodeUrl);
+		if (!listing)h2.respond(streamId, 500, HTML, errorPage(500, "Internal Server Error"));
+		else h2.respond(streamId, 200, { { "content-type", "text/html;charset=utf-8" } }, listing->html);
+		return;
+	}
+
+	//ļɻỰDATA֡Ƭ,ͬһϵ
+	int fd = open(node.path.c_str(), O_RDONLY | O_CLOEXEC);
+	struct stat st;
+	if (fd == -1 || fstat(fd, &st) == -1)
+	{
+		if (fd != -1)close(fd);
+		h2.respond(streamId, 404, HTML, errorPage(404, "Not Found"));
+		return;
+	}
+	h2.respondFile(streamId, status, { { "content-type", *node.mime } }, fd, st.st_size);
+}
+
+void HttpServer::drainCompletions(std::vector<ConnectionPtr>& batch)
+{
+	completions_.drain(batch);
+	for (ConnectionPtr& conn : batch)
+	{
+		//֤connǷǿָԼЧָ
+		if (!conn || conn->fd <= 0)
+		{
+			std::cout << ":connΪЧConnectionָ" << std::endl;
+			continue;
+		}
+		//ӱеλòǿյ:ѱstop()ر,fdѾ,صֱͷ
+		auto it = connections_.find(conn->fd);
+		if (it == connections_.end() || it->second)continue;
+		onTaskComplete(conn, it->second);
+	}
+	//ͷҪرյӽص,
+	batch.clear();
+}
+
+void HttpServer::armWebSockets(std::vector<std::shared_ptr<WebSocketSession>>& batch)
+{
+	wsHub_.takeArmRequests(batch);
+	for (auto& session : batch)
+	{
+		//λΪ˵߳ڴ,onTaskCompleteע;ѹرջfdѱӸʱ
+		auto it = connections_.find(session->fd());
+		if (it == connections_.end() || !it->second || it->second->ws != session)continue;
+		//Ķ߲,socketдȲд,ֱӽ߳̽
+		if (session->failed())submitRequest(std::move(it->second));
+		else session->arm();
+	}
+	batch.clear();
+}
+
+void HttpServer::onTaskComplete(ConnectionPtr& conn, ConnectionPtr& slot) {
+	int cfd = conn->fd;
+
+	//HTTP/2:Ựͣԭ¼,߹ر
+	if (conn->h2)
+	{
+		switch (conn->h2->lastResult())
+		{
+		case Http2Session::Result::CLOSE:
+			close(cfd);
+			connections_.erase(cfd);
+			break;
+		case Http2Session::Result::WAIT_WRITE:
+			slot = std::move(conn);
+			rearmWrite(cfd);
+			break;
+		default:
+			slot = std::move(conn);
+			rearmRead(cfd);
+			break;
+		}
+		return;
+	}
+
+	//WebSocket:ɵһ̹߳ر,(дʱͬʱעд)
+	if (conn->ws)
+	{
+		if (conn->ws->takeClose())
+		{
+			close(cfd);
+			connections_.erase(cfd);
+		}
+		//ڼ䱻Ͽٶ:ͬarmWebSockets,ȿд
+		else if (conn->ws->failed())
+		{
+			submitRequest(std::move(conn));
+		}
+		else
+		{
+			slot = std::move(conn);
+			slot->ws->arm();
+		}
+		return;
+	}
+
+	//ļûз:socketдŵβ,;ٵʱȵȵ㹻
+	//ȴڼ÷paced_,ӱеλñΪ
+	if (conn->transfer)
+	{
+		if (conn->pacedUntilMs > monotonicMs())paced_.emplace(conn->pacedUntilMs, std::move(conn));
+		else
+		{
+			slot = std::move(conn);
+			rearmTransfer(cfd);
+		}
+		return;
+	}
+
+	//廹û(socketʱ),ֻ¼ɶ
+	if (conn->request.stream_body && conn->request.state == HttpState::BODY)
+	{
+		slot = std::move(conn);
+		rearmRead(cfd);
+		return;
+	}
+
+	//¼ʱ:֮ǰȡ¼
+	RequestTrace trace;
+	std::string traceName;
+	std::string slowMethod, slowUrl;
+	int64_t slowBytesIn = 0;
+	if (conn->trace.timed)
+	{
+		trace = conn->trace;
+		if (trace.id != 0)traceName = conn->request.method + " " + conn->request.url;
+		//־ҪϢҲҪ֮ǰȡ
+		uint64_t begin = trace.firstByte != 0 ? trace.firstByte : trace.parsed;
+		if (slowLog_.isSlow(Tracer::nowNs() - begin))
+		{
+			slowUrl = conn->request.url;
+			slowMethod = conn->request.method;
+			slowBytesIn = conn->request.head_bytes + conn->request.body_received;
+		}
+	}
+
+	//ɺ߼
+	if (!conn->request.keep_alive) {
+		close(cfd);
+		connections_.erase(cfd);//ɾλ
+		//drainCompletionsbatchʱü=0ԶɾConnection
+	}
+	else {
+		//״̬׼һ;ˮߵĺ
+		conn->request.reset();
+		conn->trace = RequestTrace();
+		if (Tracer::timing())conn->trace.accept = Tracer::nowNs();
+
+		//Żӱ;һʱȽ,ʱֱύ,¼EPOLL¼
+		slot = std::move(conn);
+		ParseStep step = ParseStep::NEED_MORE;
+		if (!slot->readBuf.empty())
+		{
+			if (slot->trace.accept != 0)slot->trace.firstByte = slot->trace.accept;
+			step = parseBuffered(slot);
+		}
+		if (step == ParseStep::CLOSE)
+		{
+			close(cfd);
+			connections_.erase(cfd);
+		}
+		else if (step == ParseStep::NEED_MORE)
+		{
+			rearmRead(cfd);
+		}
+	}
+
+	if (trace.timed)
+	{
+		uint64_t end = Tracer::nowNs();
+		if (trace.id != 0)Tracer::recordRequest(trace, traceName, end);
+		if (!slowMethod.empty())recordSlow(trace, slowMethod, slowUrl, slowBytesIn, end);
+	}
+}
+
+void HttpServer::recordSlow(const RequestTrace& trace, const std::string& method, const std::string& url, int64_t bytesIn, uint64_t end)
+{
+	SlowLog::Entry e;
+	SlowLog::fill(e, trace, method, url, end);
+	e.bytesIn = bytesIn;
+	//ֻŶȡ̳߳״̬,·
+	auto status = threadPool_.getPoolStatus();
+	e.queueSize = status.queueSize;
+	e.busyThreads = status.busyThreads;
+	e.liveThreads = status.LiveThreads;
+	slowLog_.capture(e);
+}
+
+void HttpServer::submitRequest(ConnectionPtr conn)
+{
+	bool ok;
+	if (conn->h2)
+	{
+		ok = threadPool_.addTask([this](void* arg)
+			{
+				this->serveHttp2(static_cast<Connection*>(arg));
+			},
+			std::move(conn), TaskPriority::NORMAL);
+	}
+	else if (conn->ws)
+	{
+		ok = threadPool_.addTask([this](void* arg)
+			{
+				this->serveWebSocket(static_cast<Connection*>(arg));
+			},
+			std::move(conn), TaskPriority::NORMAL);
+	}
+	else if (conn->transfer)
+	{
+		ok = threadPool_.addTask([this](void* arg)
+			{
+				this->continueTransfer(static_cast<Connection*>(arg));
+			},
+			std::move(conn), TaskPriority::LOW);
+	}
+	else if (conn->request.stream_body && conn->request.state == HttpState::BODY)
+	{
+		ok = threadPool_.addTask([this](void* arg)
+			{
+				this->streamRequestBody(static_cast<Connection*>(arg));
+			},
+			std::move(conn), TaskPriority::LOW);
+	}
+	else
+	{
+		ok = enqueueRequest(std::move(conn));
+	}
+
+	//:reactorֱӻ503ر,ռù߳;addTaskʧʱconnԭ
+	if (!ok)
+	{
+		int cfd = conn->fd;
+		if (conn->ws)conn->ws->abort();
+		else if (!conn->h2 && !conn->transfer)sendOverload(cfd);
+		close(cfd);
+		connections_.erase(cfd);
+	}
+}
+
+bool HttpServer::enqueueRequest(ConnectionPtr&& conn)
+{
+	bool timed = conn->trace.timed;
+	if (timed && conn->trace.enqueue == 0)conn->trace.enqueue = Tracer::nowNs();
+	TaskPriority priority = classifyRequest(conn->request, conn->peerIp);
+	int* depth = timed ? &conn->trace.queueDepth : nullptr;
+	return threadPool_.addTask([this](void* arg) //connƽ,ü
+		{
+			Connection* conn = static_cast<Connection*>(arg);
+			RequestTrace& trace = conn->trace;
+			//ύһγӵʱ
+			if (trace.timed && trace.handlerStart == 0)
+			{
+				trace.dequeue = static_cast<uint64_t>(ThreadPool<Connection>::dequeueNs());
+				trace.handlerStart = Tracer::nowNs();
+				trace.workerTid = Tracer::threadId();
+			}
+			this->processRequest(conn);
+			//ӿѾڱ߳д,ٷ
+			if (taskParked)return;
+			//Ƭ͵ļһƬʱ¼
+			if (trace.timed && !conn->transfer)trace.lastByte = Tracer::nowNs();
+		},
+		std::move(conn), priority, depth);
+}
+
+void HttpServer::resumeRequest(const ConnectionPtr& conn)
+{
+	//waiterеûҪȴصͷ,�һݽ(ֻйŻߵ)
+	ConnectionPtr task = conn;
+	if (enqueueRequest(std::move(task)))return;
+	//:ﲻreactor߳,503󽻻reactorر
+	conn->request.keep_alive = false;
+	sendOverload(conn->fd);
+	completions_.push(conn);
+}
+
+TaskPriority HttpServer::classifyRequest(HttpRequest& req, const std::string& peerIp)
+{
+	//ӿ,֤ظʱ鲻ᳬʱ;HIGHŶ,ֻͨĿͻ
+	if (req.url.compare(0, 7, "/admin/") == 0)
+	{
+		RequestView view;
+		view.headers = req.headers;
+		view.peerIp = peerIp;
+		if (adminAllowed(view))return TaskPriority::HIGH;
+	}
+
+	//ֻ·,κļϵͳ:Ŀ¼бʹļ
+	std::pmr::string decodeUrl(&req.arena);
+	HttpRequest::urlDecode(decodeUrl, req.url);
+	if (decodeUrl == "/" || decodeUrl.empty())
+	{
+		decodeUrl = "/index.html";
+	}
+	static thread_local PathIndex::Node node;
+	if (pathIndex_.peek(decodeUrl, node))
+	{
+		if (node.isDir || node.size > LARGE_FILE_SIZE)
+		{
+			return TaskPriority::LOW;
+		}
+	}
+	return TaskPriority::NORMAL;
+}
+
+void HttpServer::sendOverload(int cfd)
+{
+	//ԤɵӦ,ʱκƴ
+	static const char OVERLOAD_RESPONSE[] =
+		"HTTP/1.1 503 Service Unavailable\r\n"
+		"Retry-After:1\r\n"
+		"Content-Type:text/plain\r\n"
+		"Content-Length:0\r\n"
+		"Connection:close\r\n\r\n";
+	send(cfd, OVERLOAD_RESPONSE, sizeof(OVERLOAD_RESPONSE) - 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+void HttpServer::sendRateLimited(int cfd)
+{
+	static const char RATE_LIMITED_RESPONSE[] =
+		"HTTP/1.1 429 Too Many Requests\r\n"
+		"Retry-After:1\r\n"
+		"Content-Type:text/plain\r\n"
+		"Content-Length:0\r\n"
+		"Connection:close\r\n\r\n";
+	send(cfd, RATE_LIMITED_RESPONSE, sizeof(RATE_LIMITED_RESPONSE) - 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+void HttpServer::rearmRead(int cfd)
+{
+	struct epoll_event ev = {};
+	ev.events = EPOLLIN | EPOLLET | EPOLLONESHOT;
+	ev.data.fd = cfd;
+	epoll_ctl(epollFd_, EPOLL_CTL_MOD, cfd, &ev);
+}
+
+void HttpServer::rearmTransfer(int cfd)
+{
+	struct epoll_event ev = {};
+	ev.events = EPOLLOUT | EPOLLET | EPOLLONESHOT;
+	ev.data.fd = cfd;
+	epoll_ctl(epollFd_, EPOLL_CTL_MOD, cfd, &ev);
+}
+
+void HttpServer::rearmWrite(int cfd)
+{
+	struct epoll_event ev = {};
+	ev.events = EPOLLIN | EPOLLOUT | EPOLLET | EPOLLONESHOT;
+	ev.data.fd = cfd;
+	epoll_ctl(epollFd_, EPOLL_CTL_MOD, cfd, &ev);
+}
+
+void HttpServer::continueTransfer(Connection* conn)
+{
+	size_t budget = FileSender::SLICE_BYTES;
+	if (conn->pacer)budget = conn->pacer->acquire(budget);
+	uint64_t before = conn->transfer->bodySent();
+	FileSender::Progress progress = fileSender_.resume(conn->fd, *conn->transfer, budget);
+	size_t sent = static_cast<size_t>(conn->transfer->bodySent() - before);
+	if (progress != FileSender::Progress::PENDING)
+	{
+		//:,ʱر
+		if (progress == FileSender::Progress::FAILED)conn->request.keep_alive = false;
+		if (conn->trace.timed)conn->trace.lastByte = Tracer::nowNs();
+		conn->trace.bytesOut = static_cast<int64_t>(conn->transfer->bytesSent());
+		conn->transfer.reset();
+	}
+	if (conn->pacer)paceTransfer(conn, budget, sent);
+}
+
+void HttpServer::paceTransfer(Connection* conn, size_t budget, size_t sent)
+{
+	Throttle::Pacer& pacer = *conn->pacer;
+	pacer.sent(sent);
+	if (sent < budget)pacer.refund(budget - sent);
+	conn->pacedUntilMs = 0;
+	if (!conn->transfer)
+	{
+		conn->pacer.reset();
+		return;
+	}
+	//û˵socketд,ȿд;ʱͰһƬʱ
+	if (sent >= budget)conn->pacedUntilMs = monotonicMs() + pacer.delayMs();
+}
+
+void HttpServer::releasePaced()
+{
+	if (paced_.empty())return;
+	long long now = monotonicMs();
+	while (!paced_.empty() && paced_.begin()->first <= now)
+	{
+		ConnectionPtr conn = std::move(paced_.begin()->second);
+		paced_.erase(paced_.begin());
+		//ȴڼӿѾر,fdӸ;ڵȴӱеλǿյ
+		auto it = connections_.find(conn->fd);
+		if (it == connections_.end() || it->second)continue;
+		submitRequest(std::move(conn));
+	}
+}
+
+void HttpServer::streamRequestBody(Connection* conn)
+{
+	HttpRequest& req = conn->request;
+
+	//һν:ȷȥ,ͷ֮Ѿ
+	if (!conn->bodyStarted)
+	{
+		conn->bodyStarted = true;
+		if (!beginUpload(conn))
+		{
+			req.keep_alive = false;
+			req.state = HttpState::ERROR;
+			return;
+		}
+
+		std::string pending;
+		pending.swap(req.body);
+		if (req.parseBody(pending.data(), static_cast<int>(pending.size())) == -1)
+		{
+			finishStreamBody(conn, false);
+			return;
+		}
+		//֮ˮеһ,reactor
+		size_t used = static_cast<size_t>(req.consumed_bytes);
+		if (used < pending.size())conn->readBuf.append(pending.data() + used, pending.size() - used);
+	}
+
+	//content-length֪дļʱ,spliceںдsocketֱӰᵽļ,û̬
+	//HTTPSӵҪȽ,splice
+	bool useSplice = !req.chunked && conn->uploadFd != -1 && conn->pipeFds[0] != -1 && conn->ssl == nullptr;
+	char buf[65536];
+
+	while (req.state == HttpState::BODY)
+	{
+		if (useSplice)
+		{
+			int64_t remain = req.content_length - req.body_received;
+			size_t want = remain < static_cast<int64_t>(SPLICE_CHUNK) ? static_cast<size_t>(remain) : SPLICE_CHUNK;
+			ssize_t n = splice(conn->fd, NULL, conn->pipeFds[1], NULL, want, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+			if (n == 0)
+			{
+				finishStreamBody(conn, false);//Զǰر
+				return;
+			}
+			if (n < 0)
+			{
+				if (errno == EINTR)continue;
+				if (errno == EAGAIN || errno == EWOULDBLOCK)return;//ȴһEPOLLIN
+				perror("splice socket");
+				finishStreamBody(conn, false);
+				return;
+			}
+
+			//ѹܵеȫдļ
+			ssize_t left = n;
+			while (left > 0)
+			{
+				ssize_t m = splice(conn->pipeFds[0], NULL, conn->uploadFd, NULL, left, SPLICE_F_MOVE);
+				if (m <= 0)
+				{
+					if (m < 0 && errno == EINTR)continue;
+					perror("splice file");
+					finishStreamBody(conn, false);
+					return;
+				}
+				left -= m;
+			}
+			req.body_received += n;
+			if (req.body_received >= req.content_length)
+			{
+				req.state = HttpState::DONE;
+			}
+		}
+		else
+		{
+			ssize_t n = conn->ssl != nullptr ? TlsTerminator::read(conn->ssl, buf, sizeof(buf)) : recv(conn->fd, buf, sizeof(buf), 0);
+			if (n == 0)
+			{
+				finishStreamBody(conn, false);
+				return;
+			}
+			if (n < 0)
+			{
+				if (errno == EINTR)continue;
+				if (errno == EAGAIN || errno == EWOULDBLOCK)return;
+				perror("recv body");
+				finishStreamBody(conn, false);
+				return;
+			}
+			if (req.parseBody(buf, static_cast<int>(n)) == -1)
+			{
+				finishStreamBody(conn, false);
+				return;
+			}
+			if (req.consumed_bytes < n)conn->readBuf.append(buf + req.consumed_bytes, n - req.consumed_bytes);
+		}
+	}
+
+	finishStreamBody(conn, req.state == HttpState::DONE);
+}
+
+bool HttpServer::beginUpload(Connection* conn)
+{
+	HttpRequest& req = conn->request;
+
+	//Ҫת,max_buffered_bodyʱܾ
+	if (proxy_.match(req.url))
+	{
+		sendErrorResponse(conn->fd, 413, "Payload Too Large");
+		return false;
+	}
+
+	//ϴĿ¼ܱ¼ص޸,ȡһݸ
+	pthread_mutex_lock(&configMutex_);
+	std::string uploadDir = uploadDir_;
+	pthread_mutex_unlock(&configMutex_);
+
+	//ϴֱӶ,ͨ
+	if (req.method != "PUT" || uploadDir.empty())
+	{
+		req.body_sink = [](const char*, size_t) { return true; };
+		return true;
+	}
+
+	std::pmr::string decodeUrl(&req.arena);
+	std::string rel;
+	HttpRequest::urlDecode(decodeUrl, req.url);
+	if (!PathIndex::normalize(decodeUrl, rel) || rel.empty())
+	{
+		sendErrorResponse(conn->fd, 403, "Forbidden");
+		return false;
+	}
+
+	std::string path = uploadDir + rel;
+	conn->uploadFd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (conn->uploadFd == -1)
+	{
+		perror("open upload");
+		sendErrorResponse(conn->fd, 500, "Internal Server Error");
+		return false;
+	}
+	std::cout << "ʼϴ:" << path << ",:" << (req.chunked ? -1 : req.content_length) << std::endl;
+
+	if (!req.chunked)
+	{
+		if (pipe2(conn->pipeFds, O_CLOEXEC | O_NONBLOCK) == -1)
+		{
+			//ûйܵ˻صread+write
+			perror("pipe2");
+			conn->pipeFds[0] = conn->pipeFds[1] = -1;
+		}
+	}
+
+	//ͷ֮ѶݺchunkedҪû̬,ֱдļ
+	int fd = conn->uploadFd;
+	req.body_sink = [fd](const char* data, size_t len) {
+		while (len > 0)
+		{
+			ssize_t n = write(fd, data, len);
+			if (n < 0)
+			{
+				if (errno == EINTR)continue;
+				return false;
+			}
+			data += n;
+			len -= n;
+		}
+		return true;
+	};
+	return true;
+}
+
+void HttpServer::finishStreamBody(Connection* conn, bool ok)
+{
+	HttpRequest& req = conn->request;
+	bool upload = conn->uploadFd != -1;
+	conn->closeUpload();
+
+	if (!ok)
+	{
+		req.keep_alive = false;
+		req.state = HttpState::ERROR;
+		sendErrorResponse(conn->fd, 400, "Bad Request");
+		return;
+	}
+
+	req.state = HttpState::DONE;
+	if (upload)
+	{
+		sendErrorResponse(conn->fd, 201, "Created", req.keep_alive);
+	}
+	else
+	{
+		processRequest(conn);
+	}
+}
+
+const std::string& HttpServer::getFileType(const std::string& fileName)
+{
+	static const std::string TEXT_NO_EXT = "text/plain; charset=utf-8";
+	static const std::string HTML = "text/html;charset=utf-8";
+	static const std::string JPEG = "image/jpeg";
+	static const std::string GIF = "image/gif";
+	static const std::string PNG = "image/png";
+	static const std::string CSS = "text/css";
+	static const std::string JS = "application/javascript";
+	static const std::string PDF = "application/pdf";
+	static const std::string ZIP = "application/zip";
+	static const std::string TEXT = "text/plain;charset=utf-8";
+
+	const char* dot = strrchr(fileName.c_str(), '.');
+	if (dot == NULL)
+		return TEXT_NO_EXT;
+	if (strcmp(dot, ".html") == 0 || strcmp(dot, ".htm") == 0)
+		return HTML;
+	if (strcmp(dot, ".jpg") == 0 || strcmp(dot, ".jpeg") == 0)
+		return JPEG;
+	if (strcmp(dot, ".gif") == 0)
+		return GIF;
+	if (strcmp(dot, ".png") == 0)
+		return PNG;
+	if (strcmp(dot, ".css") == 0)
+		return CSS;
+	if (strcmp(dot, ".js") == 0)
+		return JS;
+	if (strcmp(dot, ".pdf") == 0)
+		return PDF;
+	if (strcmp(dot, ".zip") == 0)
+		return ZIP;
+
+	return TEXT;
+}
+
+bool HttpServer::sendDir(const std::string& dirName, std::string_view urlPath, int cfd, FileSender::TransferPtr& transfer,
+	RequestTrace* trace, bool chunked, bool keepAlive)
+{
+	//лʱ֪,ͷбһη;δʱDirCacheɨĿ¼inotify,ɨ߷ֿ鷢
+	ResponseWriter resp(cfd);
+	resp.setChunked(chunked);
+	resp.setKeepAlive(keepAlive);
+	bool hit = false;
+	DirCache::ListingPtr listing = dirCache_.get(dirName, urlPath, &hit, [&resp](std::string_view piece) {
+		if (!resp.streaming())resp.begin("text/html;charset=utf-8");
+		return resp.write(piece) && resp.flush();
+		});
+	if (!listing) {
+		if (!resp.sent())sendErrorResponse(cfd, 500, "Internal Server Error");
+		return false;
+	}
+
+	if (hit)resp.send(listing->html, "text/html;charset=utf-8");
+	else resp.end();
+	//ͻ:ʣбreactorsocketдʱ,ռù߳
+	if (resp.hasUnsent())transfer = FileSender::bufferTransfer(resp.takeUnsent(), resp.bytesSent());
+	if (trace != nullptr)
+	{
+		trace->source = "dir";
+		trace->cached = hit;
+		trace->bytesOut = static_cast<int64_t>(resp.bytesSent());
+	}
+	return resp.keepAlive();
+}
+
+void HttpServer::sendFile(const std::string& fileName, int cfd, const std::string& fileType, RequestTrace* trace,
+	Connection* conn)
+{
+	bool keepAlive = conn != nullptr && conn->request.keep_alive;
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd == -1)
+	{
+		sendErrorResponse(cfd, 404, "NotFound", keepAlive);
+		return;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == -1)
+	{
+		close(fd);
+		sendErrorResponse(cfd, 500, "Internal Server Error", keepAlive);
+		return;
+	}	
+
+	//ͬһļͬʱʱֻɵһ,,ɺύ,´ļ
+	if (conn != nullptr)
+	{
+		ConnectionPtr waiter(conn);
+		if (!fileSender_.prepare(fileName, fd, st, [this, waiter](void*) { resumeRequest(waiter); }))
+		{
+			close(fd);
+			taskParked = true;
+			return;
+		}
+	}
+
+	//ȡļ,·ʱ¼
+	const std::string& FileType = fileType.empty() ? getFileType(fileName) : fileType;
+	//ͷͲ,ļݺϲ
+	ResponseHead head;
+	headMsg(head, 200, FileType, st.st_size, keepAlive);
+	bool cached = false;
+	//ٵ·һƬ,Ʋʱֻ͵õĲ,ʣಿreactorʱŶ
+	size_t budget = FileSender::SLICE_BYTES;
+	if (conn != nullptr)
+	{
+		conn->pacer = throttle_.match(conn->request.url);
+		if (conn->pacer)budget = conn->pacer->acquire(budget);
+	}
+	bool ok = fileSender_.send(cfd, fileName, fd, st, head.view(), &cached, conn != nullptr ? &conn->transfer : nullptr, budget);
+	close(fd);
+	//ûзӦϼһ
+	if (!ok && conn != nullptr)conn->request.keep_alive = false;
+	if (conn != nullptr && conn->pacer)
+	{
+		uint64_t sent = conn->transfer ? conn->transfer->bodySent() : (ok ? static_cast<uint64_t>(st.st_size) : 0);
+		paceTransfer(conn, budget, static_cast<size_t>(sent));
+	}
+	if (trace != nullptr)
+	{
+		trace->source = "file";
+		trace->cached = cached;
+		trace->bytesOut = ok ? static_cast<int64_t>(head.size()) + st.st_size : 0;
+	}
+}
+
+void HttpServer::headMsg(ResponseHead& head, int status, std::string_view type, int64_t len, bool keepAlive)
+{
+	head.begin(status);
+	head.header("Content-Type", type);
+	if (len >= 0)
+	{
+		head.contentLength(static_cast<uint64_t>(len));
+	}
+	//δ֪ӦֻԹرӽ
+	head.finish(keepAlive && len >= 0);
+}
+
+void HttpServer::sendHeadMsg(int cfd, int status, std::string_view type, int64_t len)
+{
+	ResponseHead head;
+	headMsg(head, status, type, len);
+	send(cfd, head.data(), head.size(), 0);
+}
+
+std::string HttpServer::errorPage(int status, std::string_view description)
 {
-	//³ʼ̳߳
-	threadPool_ = ThreadPool<Connection>(minThreads, maxThreads);
-	threadPool_.setTaskCallback([this](Connection* conn) {
-		this->onTaskComplete(conn);
+	std::string page = "<html><body><h1>" + std::to_string(status) + " ";
+	page.append(description.data(), description.size());
+	page += "</h1></body></html>";
+	return page;
+}
+
+void HttpServer::sendErrorResponse(int cfd, int status, std::string_view description, bool keepAlive)
+{
+	char body[256];
+	int len = snprintf(body, sizeof(body), "<html><body><h1>%d %.*s</h1></body></html>",
+		status, static_cast<int>(std::min<size_t>(description.size(), 200)), description.data());
+
+	ResponseHead head;
+	head.begin(status, description);
+	head.raw("Content-Type:text/html\r\n");
+	head.contentLength(static_cast<uint64_t>(len));
+	head.finish(keepAlive);
+
+	//ͷContent-Length,Ӧһ𷢳,ͻ˻һֱȴ
+	head.raw(std::string_view(body, len));
+	send(cfd, head.data(), head.size(), 0);
+}
+
+void HttpServer::enableHotRestart(const std::string& controlPath, int drainTimeoutMs)
+{
+	hotRestart_.reset(new HotRestart(controlPath));
+	drainTimeoutMs_ = drainTimeoutMs;
+	config_.drainTimeoutMs = drainTimeoutMs;
+}
+
+void HttpServer::startDraining()
+{
+	handedOff_ = true;
+	draining_ = true;
+	drainDeadline_ = monotonicMs() + drainTimeoutMs_;
+
+	//socketڼν,ֻرԼĸ
+	epoll_ctl(epollFd_, EPOLL_CTL_DEL, listenFd_, NULL);
+	close(listenFd_);
+	listenFd_ = -1;
+	if (tlsListenFd_ != -1)
+	{
+		epoll_ctl(epollFd_, EPOLL_CTL_DEL, tlsListenFd_, NULL);
+		close(tlsListenFd_);
+		tlsListenFd_ = -1;
+	}
+
+	epoll_ctl(epollFd_, EPOLL_CTL_DEL, hotRestart_->fd(), NULL);
+	hotRestart_->close(false);
+	std::cout << "ֹͣ,ʼſ" << connections_.size() << "," << drainTimeoutMs_ << "ms" << std::endl;
+}
+
+void HttpServer::recordHotFile(std::string_view url)
+{
+	//ֻڽʱԤ,Ҫȷ:ļ鵽ĴȻ
+	static thread_local unsigned sample = 0;
+	if (sample++ % HOT_SAMPLE_INTERVAL != 0)return;
+	if (pthread_mutex_trylock(&hotMutex_) != 0)return;
+	auto it = hotFiles_.find(url);
+	if (it != hotFiles_.end())
+	{
+		it->second++;
+	}
+	else if (hotFiles_.size() < MAX_HOT_TRACKED)
+	{
+		hotFiles_.emplace(url, 1);
+	}
+	pthread_mutex_unlock(&hotMutex_);
+}
+
+std::string HttpServer::hotFileSnapshot()
+{
+	std::vector<std::pair<unsigned long, std::string>> items;
+	pthread_mutex_lock(&hotMutex_);
+	items.reserve(hotFiles_.size());
+	for (auto& pair : hotFiles_)
+	{
+		items.emplace_back(pair.second, pair.first);
+	}
+	pthread_mutex_unlock(&hotMutex_);
+
+	//ʴӸߵ,ֻǰMAX_HOT_SNAPSHOT
+	std::sort(items.begin(), items.end(),
+		[](const std::pair<unsigned long, std::string>& a, const std::pair<unsigned long, std::string>& b) {
+			return a.first > b.first;
 		});
+	if (items.size() > MAX_HOT_SNAPSHOT)items.resize(MAX_HOT_SNAPSHOT);
+
+	std::string snapshot;
+	for (auto& item : items)
+	{
+		snapshot += item.second;
+		snapshot += "\n";
+	}
+	return snapshot;
+}
+
+void HttpServer::prewarm(const std::string& snapshot)
+{
+	int warmed = 0;
+	size_t pos = 0;
+	while (pos < snapshot.size())
+	{
+		size_t end = snapshot.find('\n', pos);
+		if (end == std::string::npos)end = snapshot.size();
+		std::string url = snapshot.substr(pos, end - pos);
+		pos = end + 1;
+
+		PathIndex::Node node;
+		if (url.empty() || pathIndex_.lookup(url, node) != PathIndex::Result::OK)continue;
+
+		if (node.isDir)
+		{
+			dirCache_.get(node.path, url);
+		}
+		else
+		{
+			//ںǰļҳ
+			int fd = open(node.path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd == -1)continue;
+			posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+			close(fd);
+		}
+		warmed++;
+	}
+	std::cout << "ǰν̵ȵбԤ" << warmed << "·" << std::endl;
+}
+
+void HttpServer::setPathIndexBudget(int budgetMs, size_t maxEntries)
+{
+	indexBudgetMs_ = budgetMs;
+	indexMaxEntries_ = maxEntries;
+	config_.indexBudgetMs = budgetMs;
+	config_.indexMaxEntries = static_cast<int>(maxEntries);
+}
+
+void HttpServer::setAdmissionLimits(int maxQueue, int maxQueueWaitMs, int maxConnections)
+{
+	threadPool_.setAdmissionLimits(maxQueue, maxQueueWaitMs);
+	maxConnections_ = maxConnections;
+	pthread_mutex_lock(&configMutex_);
+	config_.maxQueue = maxQueue;
+	config_.maxQueueWaitMs = maxQueueWaitMs;
+	config_.maxConnections = maxConnections;
+	pthread_mutex_unlock(&configMutex_);
+}
+
+void HttpServer::setUploadDir(const std::string& dir)
+{
+	std::string normalized = dir;
+	while (!normalized.empty() && normalized.back() == '/')normalized.pop_back();
+	pthread_mutex_lock(&configMutex_);
+	uploadDir_ = normalized;
+	config_.uploadDir = dir;
+	pthread_mutex_unlock(&configMutex_);
+}
+
+void HttpServer::setThreadPoolSize(int minThreads, int maxThreads)
+{
+	//ԭص,ŶӵӰ
+	threadPool_.resize(minThreads, maxThreads);
+	pthread_mutex_lock(&configMutex_);
+	config_.threadMin = minThreads;
+	config_.threadMax = maxThreads;
+	pthread_mutex_unlock(&configMutex_);
+}
+
+bool HttpServer::loadConfig(const std::string& path)
+{
+	ServerConfig next;
+	pthread_mutex_lock(&configMutex_);
+	next = config_;
+	pthread_mutex_unlock(&configMutex_);
+
+	std::string error;
+	if (!next.loadFile(path, error))
+	{
+		std::cout << "ʧ:" << error << std::endl;
+		return false;
+	}
+	configPath_ = path;
+	applyConfig(next);
+	std::cout << "Ѽ:" << path << std::endl;
+	return true;
+}
+
+void HttpServer::calibrateFileSender()
+{
+	if (!fileSender_.calibrate())return;
+
+	//׼д,֮¼ʱδֵָֻ׼
+	FileSender::Stats calibrated = fileSender_.stats();
+	pthread_mutex_lock(&configMutex_);
+	config_.fileSmallMax = static_cast<int>(calibrated.smallMax);
+	config_.fileMmapMax = static_cast<int>(calibrated.mmapMax);
+	pthread_mutex_unlock(&configMutex_);
+}
+
+void HttpServer::reloadConfig()
+{
+	if (configPath_.empty())
+	{
+		std::cout << "δָļ,¼" << std::endl;
+		return;
+	}
+	loadConfig(configPath_);
+}
+
+void HttpServer::requestReload()
+{
+	char c = 1;
+	if (reloadPipe_[1] != -1)
+	{
+		ssize_t n = write(reloadPipe_[1], &c, 1);
+		(void)n;
+	}
+}
+
+std::string HttpServer::configJson()
+{
+	pthread_mutex_lock(&configMutex_);
+	std::string json = config_.toJson();
+	pthread_mutex_unlock(&configMutex_);
+	return json;
+}
+
+void HttpServer::applyConfig(const ServerConfig& next)
+{
+	ServerConfig prev;
+	pthread_mutex_lock(&configMutex_);
+	prev = config_;
+	config_ = next;
+	pthread_mutex_unlock(&configMutex_);
+
+	if (next.threadMin != prev.threadMin || next.threadMax != prev.threadMax)
+	{
+		threadPool_.resize(next.threadMin, next.threadMax);
+	}
+	setAdmissionLimits(next.maxQueue, next.maxQueueWaitMs, next.maxConnections);
+	dirCache_.setMaxDirs(next.dirCacheSize);
+	fileSender_.setThresholds(next.fileSmallMax, next.fileMmapMax, static_cast<size_t>(next.fileMmapCacheMb) * 1024 * 1024);
+	setUploadDir(next.uploadDir);
+	drainTimeoutMs_ = next.drainTimeoutMs;
+
+	std::string routeError;
+	if (!proxy_.setRoutes(next.proxyRoutes, routeError))
+	{
+		std::cout << "·δ:" << routeError << std::endl;
+	}
+	std::string throttleError;
+	if (!throttle_.configure(next.throttleConnKb, next.throttleRoutes, next.throttleClasses, throttleError))
+	{
+		std::cout << "ٹδ:" << throttleError << std::endl;
+	}
+	threadPool_.setPriorityAging(next.priorityAgingMs);
+	rateLimiter_.setLimit(RateLimiter::CONN_IP, next.rateConnIp, next.rateConnIpBurst);
+	rateLimiter_.setLimit(RateLimiter::CONN_NET, next.rateConnNet, next.rateConnNetBurst);
+	rateLimiter_.setLimit(RateLimiter::REQ_IP, next.rateReqIp, next.rateReqIpBurst);
+	rateLimiter_.setLimit(RateLimiter::REQ_NET, next.rateReqNet, next.rateReqNetBurst);
+	tls_.setHttp2(next.http2 != 0);
+	Tracer::setSampleRate(next.traceSample);
+	slowLog_.configure(next.slowlogMs, next.slowlogIntervalSec);
+	Tracer::setTimeAll(slowLog_.enabled());
+
+	//ڼsocketٴεlisten޸backlog
+	if (listenFd_ != -1 && next.listenBacklog != prev.listenBacklog)
+	{
+		if (listen(listenFd_, next.listenBacklog) == -1)perror("listen:backlog");
+		if (tlsListenFd_ != -1 && listen(tlsListenFd_, next.listenBacklog) == -1)perror("listen:tls backlog");
+	}
+	//·ֻʱ
+	indexBudgetMs_ = next.indexBudgetMs;
+	indexMaxEntries_ = next.indexMaxEntries;
 }                                                                                                                                                   
\ No newline at end of file
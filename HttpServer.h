@@ -1,17 +1,70 @@
 #include "ThreadPool.h"
 #include "HttpRequest.h"
+#include "FileWatcher.h"
+#include "DirCache.h"
+#include "PathIndex.h"
+#include "HotRestart.h"
+#include "Config.h"
+#include "FileSender.h"
+#include "Proxy.h"
+#include "Router.h"
+#include "RingBuffer.h"
+#include "RateLimiter.h"
+#include "TlsTerminator.h"
+#include "Http2.h"
+#include "WebSocket.h"
+#include "Trace.h"
+#include "SlowLog.h"
+#include "CompletionQueue.h"
+#include "HttpHeader.h"
+#include "Throttle.h"
 #include <string>
 #include <map>
 #include <sys/epoll.h>
 #include <memory>
+#include <atomic>
+#include <unistd.h>
 
 
-//Ϣ
-struct Connection
+//Ϣ,üڶڲ:ӱһ,ŶӺִеһ
+struct Connection : RefCounted<Connection>
 {
 	int fd;
 	HttpRequest request;
+	RingBuffer readBuf;		//δѵ,ʱռڴ
+
+	//ʽ
+	bool bodyStarted = false;
+	int uploadFd = -1;
+	int pipeFds[2] = { -1, -1 };	//spliceõתܵ
+
+	std::string peerIp;		//ͻ˵ַ
+	struct in_addr peerAddr = {};	//õԭʼַ
+	SSL* ssl = nullptr;		//kTLSֻж˷ͷʱ,ȡOpenSSL
+	std::unique_ptr<Http2Session> h2;	//ʶǰԺ,ϵ
+	std::shared_ptr<WebSocketSession> ws;	//WebSocket,ıҲһ
+	RequestTrace trace;		//ǰ׶εʱ,ֻп׷ʱ¼
+	FileSender::TransferPtr transfer;	//ûзӦ(ļ,socketдʱʣµ),ÿοдʱɹ̷߳һƬ
+	Throttle::PacerPtr pacer;	//·ϵļӦ,ʱͷ
+	long long pacedUntilMs = 0;	//ʱһƬ緢ʱ
+	Connection* completionNext = nullptr;	//ɺɶеһ
+
+	void closeUpload()
+	{
+		if (uploadFd != -1)close(uploadFd);
+		if (pipeFds[0] != -1)close(pipeFds[0]);
+		if (pipeFds[1] != -1)close(pipeFds[1]);
+		uploadFd = pipeFds[0] = pipeFds[1] = -1;
+		bodyStarted = false;
+	}
+
+	~Connection()
+	{
+		closeUpload();
+		if (ssl != nullptr)SSL_free(ssl);
+	}
 };
+using ConnectionPtr = RefPtr<Connection>;
 
 class HttpServer
 {
@@ -25,6 +78,32 @@ public:
 	//̳߳شС
 	void setThreadPoolSize(int minThreads, int maxThreads);
 
+	//ļЧ,֮յSIGHUP/admin/reloadʱ¼
+	bool loadConfig(const std::string& path);
+
+	//׼:󳤶,Ŷʱ(),;0ʾ
+	void setAdmissionLimits(int maxQueue, int maxQueueWaitMs, int maxConnections);
+
+	//:ʱԴcontrolPathϵľɽ̽ӹܼsocket,
+	//ڸ·ϵȴν;ӺdrainTimeoutMsڴ˳
+	void enableHotRestart(const std::string& controlPath, int drainTimeoutMs);
+
+	//PUTϴļıĿ¼,Ϊʱϴ
+	void setUploadDir(const std::string& dir);
+
+	//·Ԥ,budgetMsΪ0ʱʹöģʽ(run֮ǰ)
+	void setPathIndexBudget(int budgetMs, size_t maxEntries);
+
+	//ע,methodsΪHttpMethod,patternRouter(run֮ǰ)
+	//·ڴ;̬ļƥ
+	bool route(unsigned methods, const std::string& pattern, HandlerFunc handler);
+
+	//prefixͷGETΪWebSocket,·ʣಿ(ѯ)Ϊĵ,
+	//onMessageͻ˷Ϣ(run֮ǰ)
+	bool websocket(const std::string& prefix, WebSocketSession::MessageHandler onMessage = nullptr);
+	//WebSocket߹㲥,ؽյĶ,߳е
+	size_t publish(const std::string& topic, std::string_view message, bool binary = false);
+
 	//״̬ѯӿ
 	ThreadPool<Connection>::PoolStatus getThreadPoolStatus()
 	{
@@ -38,28 +117,108 @@ private:
 	
 	//ʼsocket
 	bool initListenSocket();
+	int openListenSocket(unsigned short port);
+	//HTTPS˿ں֤(runиóʼ)
+	bool initTls();
 
 	//epoll¼
 	void handEpollEvents();
 
 	//
-	void acceptNewConnection();
+	void acceptNewConnection(int listenFd);
+	//ѽӼӱepoll,sslǿʱȡҪ
+	void addConnection(int cfd, const struct sockaddr_in& clientAddr, SSL* ssl);
 
 	//HTTP(ִ̳߳)
 	void processRequest(Connection* conn);
+	//URLӳ䵽·еĽڵ,200403404;404ʱ/404.html,nodeΪҳ
+	//decodeUrlͨarena
+	int resolveStatic(std::string_view url, std::pmr::string& decodeUrl, PathIndex::Node& node);
+
+	//HTTP/2:Ự̳߳жд,ÿͬһ߳д
+	void serveHttp2(Connection* conn);
+	void processHttp2Request(Connection* conn, uint32_t streamId, HttpRequest& req);
+
+	//WebSocket:processRequest,֮ͻ˵̳֡߳д
+	bool upgradeWebSocket(Connection* conn);
+	void serveWebSocket(Connection* conn);
+	WebSocketHub wsHub_;
+	std::vector<std::pair<std::string, WebSocketSession::MessageHandler>> wsRoutes_;
 
 	//Ӧ
 	void sendResponse(int cfd, int status, const std::string& content);
 
 	//ļ
-	std::string getFileType(const std::string& fileName);
-	void sendDir(const std::string& difName, const std::string& urlPath, int cfd);
-	void sendFile(const std::string& fileName, int cfd);
-	void sendHeadMsg(int cfd, int status, const std::string& descr, const std::string& type, int len);
-	void sendErrorResponse(int cfd, int status, const std::string& description);
-
-	//̳߳ɻص
-	void onTaskComplete(std::shared_ptr<Connection> conn);
+	//صַǳ,Ҫ
+	static const std::string& getFileType(const std::string& fileName);
+	//traceǿʱӦֽǷл;δʱֿ鷢,chunkedΪfalse(HTTP/1.0)ʱԹرӽ
+	//Ӧܷ񱣳;socketдʱûдĲַŽtransfer
+	bool sendDir(const std::string& difName, std::string_view urlPath, int cfd, FileSender::TransferPtr& transfer,
+		RequestTrace* trace = nullptr, bool chunked = true, bool keepAlive = false);
+	//connǿʱ,ļһ,ռù߳
+	void sendFile(const std::string& fileName, int cfd, const std::string& fileType = "", RequestTrace* trace = nullptr,
+		Connection* conn = nullptr);
+	void sendHeadMsg(int cfd, int status, std::string_view type, int64_t len);
+	//lenΪʱдContent-Length
+	static void headMsg(ResponseHead& head, int status, std::string_view type, int64_t len, bool keepAlive = false);
+	void sendErrorResponse(int cfd, int status, std::string_view description, bool keepAlive = false);
+	static std::string errorPage(int status, std::string_view description);
+
+	//ʽ(ִ̳߳,socketʱزȴһEPOLLIN)
+	void streamRequestBody(Connection* conn);
+	//ƬʹļһƬ(ִ̳߳),ʱ
+	void continueTransfer(Connection* conn);
+	//ٵ:¼һƬʵʷ͵ֽ,û,ʱһƬʱ
+	void paceTransfer(Connection* conn, size_t budget, size_t sent);
+	bool beginUpload(Connection* conn);
+	void finishStreamBody(Connection* conn, bool ok);
+
+	//ӻе:ʱύ̳߳(֮connΪ),ͷƻʱCLOSE
+	//reactorĶȡѭˮһɺ
+	enum class ParseStep { NEED_MORE, SUBMITTED, CLOSE };
+	ParseStep parseBuffered(ConnectionPtr& conn);
+	//ѽɵύ̳߳,ʱֱӻ503
+	//connǴӱƳ,ִڼӱλǿյ,ɺreactorŻ
+	void submitRequest(ConnectionPtr conn);
+	//ͨŽ̳߳,submitRequest͹ύ;falseʱconnԭ
+	bool enqueueRequest(ConnectionPtr&& conn);
+	//ȴļɺ(ڼصĹ߳),ύ
+	void resumeRequest(const ConnectionPtr& conn);
+	void sendOverload(int cfd);
+	void sendRateLimited(int cfd);
+	//;ȼ(reactor߳е,ʴ)
+	TaskPriority classifyRequest(HttpRequest& req, const std::string& peerIp);
+
+	//(reloadConfigapplyConfigreactorִ߳)
+	void reloadConfig();
+	void requestReload();
+	void applyConfig(const ServerConfig& next);
+	std::string configJson();
+	void calibrateFileSender();
+
+	//
+	void startDraining();
+	//¼ʵļ,ÿ߳ÿHOT_SAMPLE_INTERVALμ¼һ,ռʱγ
+	void recordHotFile(std::string_view url);
+	std::string hotFileSnapshot();
+	void prewarm(const std::string& snapshot);
+
+	//¼ɶ¼(EPOLLONESHOT)
+	void rearmRead(int cfd);
+	//ͻʱͬʱд¼
+	void rearmWrite(int cfd);
+	//ֻȴд,ƬеӲȡµ
+	void rearmTransfer(int cfd);
+
+	//ɺӴ(رաû¼),ֻreactorе
+	//slotӱеĿλ,ʹõӰconnƻslot,رյconnһͷ
+	void onTaskComplete(ConnectionPtr& conn, ConnectionPtr& slot);
+	//ȡ߳̽ص,onTaskComplete
+	void drainCompletions(std::vector<ConnectionPtr>& batch);
+	//עWebSocketỰ,ֻעûڹ߳е
+	void armWebSockets(std::vector<std::shared_ptr<WebSocketSession>>& batch);
+	//ʱŶӷһƬ
+	void releasePaced();
 	
 	int listenFd_;
 	int epollFd_;
@@ -67,9 +226,88 @@ private:
 	std::string baseDir_;
 	bool running_;
 
+	//߳̽reactorɶ,̳֮߳
+	CompletionQueue<Connection> completions_;
+
 	//̳߳
 	ThreadPool<Connection> threadPool_;//T=Connection
 
-	//ӹ
-	std::map<int, std::shared_ptr<Connection>> connections_;
+	//ӹ:ֻreactor߳з,
+	//ӽ߳ʱƳ,λñΪ(Լ),ɺƻ,̲ıü
+	std::map<int, ConnectionPtr> connections_;
+
+	//ļ仯Ŀ¼б
+	FileWatcher fileWatcher_;
+	DirCache dirCache_;
+
+	//ļӦ巢Ͳ
+	FileSender fileSender_;
+
+	//·ɱ:ӿںûעĴ
+	Router router_;
+	void registerAdminRoutes();
+	//޸״̬Ĺ:,X-Admin-Tokenõadmin_tokenһ
+	bool adminAllowed(std::string_view peerIp, std::string_view token);
+	bool adminAllowed(const RequestView& req) { return adminAllowed(req.peerIp, req.header("X-Admin-Token")); }
+	bool dispatchRoute(Connection* conn);
+	bool dispatchRoute(const HttpRequest& req, const std::string& peerIp, ResponseWriter& resp);
+
+	//ֵͬ׶κʱ̳߳״̬־
+	SlowLog slowLog_;
+	void recordSlow(const RequestTrace& trace, const std::string& method, const std::string& url, int64_t bytesIn, uint64_t end);
+
+	//·ɺӳ(ֻһreactor,һ)
+	Proxy proxy_;
+
+	//ͻ˵ַӺ,reactorм
+	RateLimiter rateLimiter_;
+
+	//;ȴƵӰʱpaced_,reactorepoll_waitʱ,ֻreactorз
+	Throttle throttle_;
+	std::multimap<long long, ConnectionPtr> paced_;
+
+	//HTTPS:ֺû̬мreactorн
+	TlsTerminator tls_;
+	int tlsListenFd_ = -1;
+
+	//׼
+	int maxConnections_;
+	std::atomic<long> connRejected_{ 0 };	//ޱܾ
+	static const int DEFAULT_MAX_QUEUE = 4096;
+	static const int DEFAULT_MAX_QUEUE_WAIT_MS = 5000;
+	static const int DEFAULT_MAX_CONNECTIONS = 10000;
+	static const off_t LARGE_FILE_SIZE = 1024 * 1024;	//ôСļȼ
+
+	//
+	ServerConfig config_;
+	std::string configPath_;
+	pthread_mutex_t configMutex_ = PTHREAD_MUTEX_INITIALIZER;
+	int reloadPipe_[2];
+
+	//
+	std::unique_ptr<HotRestart> hotRestart_;
+	int drainTimeoutMs_;
+	bool draining_;
+	bool handedOff_;
+	long long drainDeadline_;
+	pthread_mutex_t hotMutex_;
+	std::map<std::string, unsigned long, std::less<>> hotFiles_;	//url -> Ĵ,ֱstring_view
+	static const size_t MAX_HOT_TRACKED = 4096;
+	static const unsigned HOT_SAMPLE_INTERVAL = 32;
+	static const size_t MAX_HOT_SNAPSHOT = 256;
+	static const int HANDOFF_TIMEOUT_MS = 2000;
+	static const int DRAIN_POLL_MS = 100;
+
+	//ϴĿ¼
+	std::string uploadDir_;
+	static const size_t SPLICE_CHUNK = 65536;
+	static const size_t MAX_REQUEST_HEAD = 64 * 1024;	//кͷܳ
+	static const size_t H2_PROXY_BUFFER = 64 * 1024 * 1024;	//HTTP/2Ӧ
+
+	//ĵĿ¼·
+	PathIndex pathIndex_;
+	int indexBudgetMs_;
+	size_t indexMaxEntries_;
+	static const int DEFAULT_INDEX_BUDGET_MS = 2000;
+	static const size_t DEFAULT_INDEX_MAX_ENTRIES = 1000000;
 };
\ No newline at end of file
@@ -0,0 +1,479 @@
+#include "PathIndex.h"
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <utility>
+#include <iostream>
+
+static long long nowMs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<long long>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+PathIndex::PathIndex(const std::string& baseDir, FileWatcher& watcher, MimeFunc mime)
+	: watcher_(watcher), mimeFunc_(mime), complete_(false), maxEntries_(0)
+{
+	pthread_rwlock_init(&lock_, NULL);
+
+	//Ŀ¼ҲǷ,ͳһʹù淶·
+	char resolved[PATH_MAX];
+	if (realpath(baseDir.c_str(), resolved) != NULL)
+	{
+		baseDir_ = resolved;
+	}
+	else
+	{
+		baseDir_ = baseDir;
+	}
+	//ȥĩβ/,֤baseDir_ + relǺϷ·
+	while (!baseDir_.empty() && baseDir_.back() == '/')baseDir_.pop_back();
+
+	watcher_.addListener([this](const std::string& dir, const std::string& name, uint32_t mask) {
+		onFsEvent(dir, name, mask);
+		});
+}
+
+PathIndex::~PathIndex()
+{
+	pthread_rwlock_destroy(&lock_);
+}
+
+bool PathIndex::build(int budgetMs, size_t maxEntries)
+{
+	pthread_rwlock_wrlock(&lock_);
+	entries_.clear();
+	complete_ = false;
+	maxEntries_ = maxEntries;
+	pthread_rwlock_unlock(&lock_);
+
+	if (budgetMs <= 0)
+	{
+		std::cout << "·ʹöģʽ:" << baseDir_ << std::endl;
+		return false;
+	}
+
+	long long start = nowMs();
+	Entry root = {};
+	root.isDir = true;
+	struct stat st;
+	if (stat(baseDir_.empty() ? "/" : baseDir_.c_str(), &st) == -1 || !S_ISDIR(st.st_mode))
+	{
+		perror("stat baseDir");
+		return false;
+	}
+	root.ino = st.st_ino;
+	root.mtime = st.st_mtime;
+	pthread_rwlock_wrlock(&lock_);
+	entries_[""] = root;
+	pthread_rwlock_unlock(&lock_);
+
+	bool ok = scanDir("", start + budgetMs, maxEntries);
+
+	pthread_rwlock_wrlock(&lock_);
+	complete_ = ok;
+	size_t count = entries_.size();
+	pthread_rwlock_unlock(&lock_);
+
+	std::cout << "·" << (ok ? "" : "Ԥ,תΪģʽ") << ",Ŀ:" << count
+		<< ",ʱ:" << nowMs() - start << "ms" << std::endl;
+	return ok;
+}
+
+bool PathIndex::scanDir(const std::string& dirRel, long long deadlineMs, size_t maxEntries)
+{
+	//ʽջݹ,Ŀ¼ľ߳ջ
+	std::vector<std::string> pending;
+	pending.push_back(dirRel);
+
+	while (!pending.empty())
+	{
+		std::string rel = std::move(pending.back());
+		pending.pop_back();
+
+		std::string dirPath = baseDir_ + rel;
+		//ȽwatchٶĿ¼,ȡڼı仯һ¼
+		watcher_.watchDir(dirPath.empty() ? "/" : dirPath);
+
+		int dfd = open(dirPath.empty() ? "/" : dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (dfd == -1)continue;
+		DIR* dir = fdopendir(dfd);
+		if (dir == NULL)
+		{
+			close(dfd);
+			continue;
+		}
+
+		std::vector<std::pair<std::string, Entry>> batch;
+		struct dirent* d;
+		while ((d = readdir(dir)) != NULL)
+		{
+			if (strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0)continue;
+
+			std::string childRel = rel + "/" + d->d_name;
+			Entry e;
+			if (!indexEntry(dfd, childRel, d->d_name, e))continue;
+			if (e.isDir && !e.isLink)
+			{
+				pending.push_back(childRel);
+			}
+			batch.emplace_back(std::move(childRel), std::move(e));
+		}
+		closedir(dir);
+
+		//ÿĿ¼ֻһд,ɨڼ䲻̫
+		pthread_rwlock_wrlock(&lock_);
+		for (auto& item : batch)
+		{
+			if (!item.second.isDir)
+			{
+				item.second.mime = internMime(item.second.isLink ? item.second.target : item.first);
+			}
+			entries_[item.first] = std::move(item.second);
+		}
+		size_t count = entries_.size();
+		pthread_rwlock_unlock(&lock_);
+
+		if (count >= maxEntries || nowMs() > deadlineMs)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool PathIndex::indexEntry(int dfd, const std::string& rel, const char* name, Entry& out)
+{
+	struct stat st;
+	if (fstatat(dfd, name, &st, AT_SYMLINK_NOFOLLOW) == -1)return false;
+
+	out.isLink = false;
+	out.stale = false;
+	out.lazy = false;
+	out.mime = nullptr;
+	out.target.clear();
+
+	if (S_ISLNK(st.st_mode))
+	{
+		//ֻĿλڸĿ¼ʱſɷ
+		std::string full = baseDir_ + rel;
+		char resolved[PATH_MAX];
+		if (realpath(full.c_str(), resolved) == NULL)return false;
+		if (!contains(resolved))return false;
+		if (stat(resolved, &st) == -1)return false;
+		out.isLink = true;
+		out.target = resolved;
+	}
+
+	if (!S_ISDIR(st.st_mode) && !S_ISREG(st.st_mode))return false;
+
+	out.ino = st.st_ino;
+	out.isDir = S_ISDIR(st.st_mode);
+	out.size = st.st_size;
+	out.mtime = st.st_mtime;
+	return true;
+}
+
+PathIndex::Result PathIndex::lookup(std::string_view decodedUrl, Node& out)
+{
+	//ϣkeystring,ÿ̸߳һ
+	static thread_local std::string rel;
+	if (!normalize(decodedUrl, rel))
+	{
+		return Result::FORBIDDEN;
+	}
+
+	pthread_rwlock_rdlock(&lock_);
+	auto it = entries_.find(rel);
+	if (it != entries_.end() && !it->second.stale)
+	{
+		fillNode(rel, it->second, out);
+		pthread_rwlock_unlock(&lock_);
+		return Result::OK;
+	}
+
+	bool slow = !complete_ || it != entries_.end();
+	if (!slow)
+	{
+		//ʱ,ֻĿ¼Ƿӻڼ³ֵ·Ų
+		std::string parent = rel;
+		size_t pos;
+		while ((pos = parent.rfind('/')) != std::string::npos)
+		{
+			parent.resize(pos);
+			auto p = entries_.find(parent);
+			if (p != entries_.end())
+			{
+				slow = p->second.isLink || p->second.lazy;
+				break;
+			}
+		}
+	}
+	pthread_rwlock_unlock(&lock_);
+
+	if (!slow)
+	{
+		return Result::NOT_FOUND;
+	}
+	return resolveSlow(rel, out);
+}
+
+bool PathIndex::peek(std::string_view decodedUrl, Node& out)
+{
+	static thread_local std::string rel;
+	if (!normalize(decodedUrl, rel))return false;
+
+	pthread_rwlock_rdlock(&lock_);
+	auto it = entries_.find(rel);
+	bool found = it != entries_.end() && !it->second.stale;
+	if (found)
+	{
+		fillNode(rel, it->second, out);
+	}
+	pthread_rwlock_unlock(&lock_);
+	return found;
+}
+
+PathIndex::Result PathIndex::resolveSlow(const std::string& rel, Node& out)
+{
+	std::string full = baseDir_ + rel;
+	char resolved[PATH_MAX];
+	struct stat st;
+	bool found = realpath(full.c_str(), resolved) != NULL;
+	if (found && !contains(resolved))
+	{
+		return Result::FORBIDDEN;
+	}
+	found = found && stat(resolved, &st) == 0 && (S_ISDIR(st.st_mode) || S_ISREG(st.st_mode));
+	if (!found)
+	{
+		//ڵĿӦļѾ,ȥʱֱж404
+		if (complete_)
+		{
+			pthread_rwlock_wrlock(&lock_);
+			auto it = entries_.find(rel);
+			if (it != entries_.end() && it->second.stale)eraseTreeLocked(rel);
+			pthread_rwlock_unlock(&lock_);
+		}
+		return Result::NOT_FOUND;
+	}
+
+	Entry e;
+	e.ino = st.st_ino;
+	e.isDir = S_ISDIR(st.st_mode);
+	e.size = st.st_size;
+	e.mtime = st.st_mtime;
+	e.isLink = (full != resolved);
+	e.stale = false;
+	//ûоɨĿ¼:ʱδе·Ҫ·
+	e.lazy = e.isDir;
+	if (e.isLink)e.target = resolved;
+
+	pthread_rwlock_wrlock(&lock_);
+	e.mime = e.isDir ? nullptr : internMime(resolved);
+	//,Ŀ¼ԱʧЧ;ɷӵ·޷ɿ,
+	//Ŀﵽʱٲ,еĿ(ڵ)ճ
+	bool cache = !e.isLink;
+	if (cache)
+	{
+		auto it = entries_.find(rel);
+		if (it != entries_.end())
+		{
+			//ɨĿ¼ԺȻ
+			if (it->second.isDir && !it->second.lazy)e.lazy = false;
+			it->second = e;
+		}
+		else if (entries_.size() < maxEntries_)
+		{
+			entries_.emplace(rel, e);
+		}
+		else
+		{
+			cache = false;
+		}
+	}
+	fillNode(rel, e, out);
+	pthread_rwlock_unlock(&lock_);
+
+	if (cache)
+	{
+		size_t pos = rel.rfind('/');
+		std::string parent = baseDir_ + rel.substr(0, pos == std::string::npos ? 0 : pos);
+		watcher_.watchDir(parent.empty() ? "/" : parent);
+	}
+	return Result::OK;
+}
+
+bool PathIndex::normalize(std::string_view url, std::string& rel)
+{
+	rel.clear();
+	size_t i = 0;
+	while (i < url.size())
+	{
+		size_t j = url.find('/', i);
+		if (j == std::string_view::npos)j = url.size();
+		size_t len = j - i;
+
+		if (len == 0 || (len == 1 && url[i] == '.'))
+		{
+			//նλ.
+		}
+		else if (len == 2 && url[i] == '.' && url[i + 1] == '.')
+		{
+			if (rel.empty())return false;	//ͼԽĿ¼
+			rel.resize(rel.rfind('/'));
+		}
+		else
+		{
+			rel += '/';
+			rel.append(url, i, len);
+		}
+		i = j + 1;
+	}
+	return true;
+}
+
+size_t PathIndex::size()
+{
+	pthread_rwlock_rdlock(&lock_);
+	size_t n = entries_.size();
+	pthread_rwlock_unlock(&lock_);
+	return n;
+}
+
+bool PathIndex::contains(const char* resolved) const
+{
+	size_t len = baseDir_.size();
+	if (strncmp(resolved, baseDir_.c_str(), len) != 0)return false;
+	//ǰ׺ƥ仹Ҫ·ָ,/wwwذ/www2
+	return resolved[len] == '/' || resolved[len] == '\0';
+}
+
+const std::string* PathIndex::internMime(const std::string& fileName)
+{
+	return &*mimes_.insert(mimeFunc_(fileName)).first;
+}
+
+void PathIndex::fillNode(const std::string& rel, const Entry& e, Node& out) const
+{
+	out.ino = e.ino;
+	out.isDir = e.isDir;
+	out.size = e.size;
+	out.mtime = e.mtime;
+	out.mime = e.mime;
+	if (e.isLink)
+	{
+		out.path = e.target;
+	}
+	else
+	{
+		out.path.assign(baseDir_).append(rel);
+		if (out.path.empty())out.path = "/";
+	}
+}
+
+void PathIndex::eraseTreeLocked(const std::string& rel)
+{
+	//еͨļ治Ŀ,ñ
+	auto self = entries_.find(rel);
+	if (self != entries_.end() && !self->second.isDir)
+	{
+		entries_.erase(self);
+		return;
+	}
+	if (self != entries_.end())entries_.erase(self);
+	std::string prefix = rel + "/";
+	for (auto it = entries_.begin(); it != entries_.end(); )
+	{
+		if (it->first.compare(0, prefix.size(), prefix) == 0)
+		{
+			it = entries_.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void PathIndex::onFsEvent(const std::string& dir, const std::string& name, uint32_t mask)
+{
+	if (dir.empty())
+	{
+		//¼,Ѳ,˻Ϊģʽ
+		pthread_rwlock_wrlock(&lock_);
+		entries_.clear();
+		complete_ = false;
+		pthread_rwlock_unlock(&lock_);
+		return;
+	}
+
+	std::string root = baseDir_.empty() ? "/" : baseDir_;
+	if (dir.compare(0, baseDir_.size(), baseDir_) != 0)return;
+	std::string dirRel = (dir == root) ? std::string() : dir.substr(baseDir_.size());
+
+	if (name.empty())
+	{
+		//Ŀ¼ɾ
+		if (mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+		{
+			pthread_rwlock_wrlock(&lock_);
+			eraseTreeLocked(dirRel);
+			pthread_rwlock_unlock(&lock_);
+		}
+		return;
+	}
+
+	std::string rel = dirRel + "/" + name;
+	if (mask & (IN_DELETE | IN_MOVED_FROM))
+	{
+		pthread_rwlock_wrlock(&lock_);
+		eraseTreeLocked(rel);
+		pthread_rwlock_unlock(&lock_);
+		return;
+	}
+
+	if (!complete_)
+	{
+		//ģʽֻ趪Ŀ,´βʱ½
+		pthread_rwlock_wrlock(&lock_);
+		entries_.erase(rel);
+		pthread_rwlock_unlock(&lock_);
+		return;
+	}
+
+	//ʱֱɾĿ(δлᱻжΪ404):Ϊ,һβʱڹ߳½
+	//³ֵĿ¼Ϊlazy,µɲ,ɨ
+	bool newDir = (mask & IN_ISDIR) && (mask & (IN_CREATE | IN_MOVED_TO));
+	pthread_rwlock_wrlock(&lock_);
+	auto it = entries_.find(rel);
+	if (it != entries_.end() && !newDir)
+	{
+		it->second.stale = true;
+	}
+	else
+	{
+		if (it != entries_.end())eraseTreeLocked(rel);
+		if (entries_.size() < maxEntries_)
+		{
+			Entry e = {};
+			e.isDir = (mask & IN_ISDIR) != 0;
+			e.stale = true;
+			e.lazy = e.isDir;
+			entries_.emplace(rel, e);
+		}
+		else
+		{
+			//Ų¹ڱ,˻Ϊģʽ
+			complete_ = false;
+		}
+	}
+	pthread_rwlock_unlock(&lock_);
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include "FileWatcher.h"
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <sys/types.h>
+#include <time.h>
+#include <pthread.h>
+
+
+//ĵĿ¼·:ʱɨbaseDir,֮inotify
+//·һιϣҼжǷɷ,realpath/stat/access
+class PathIndex
+{
+public:
+	struct Node
+	{
+		ino_t ino;
+		bool isDir;
+		off_t size;
+		time_t mtime;
+		std::string path;			//ϵʵ·(ΪĿ)
+		const std::string* mime;	//פMIMEַ,Ŀ¼Ϊnullptr
+	};
+
+	enum class Result
+	{
+		OK,
+		NOT_FOUND,
+		FORBIDDEN
+	};
+
+	using MimeFunc = std::function<std::string(const std::string& fileName)>;
+
+	PathIndex(const std::string& baseDir, FileWatcher& watcher, MimeFunc mime);
+	~PathIndex();
+
+	//ɨĿ¼,ʱԤĿʱֹͣģʽ
+	//budgetMsΪ0ʾֱʹöģʽ(Ŀ¼)
+	bool build(int budgetMs, size_t maxEntries);
+
+	//ѽurlӳ䵽ɷļĿ¼
+	//out.pathԭе,ظʹͬһNodeʱٷڴ
+	Result lookup(std::string_view decodedUrl, Node& out);
+
+	//ֻ,realpath·,reactor߳۵Ԥ
+	bool peek(std::string_view decodedUrl, Node& out);
+
+	//淶url:ȥ.Ͷ/,..;ԽĿ¼false
+	static bool normalize(std::string_view url, std::string& rel);
+
+	bool isComplete() const { return complete_; }
+	size_t size();
+
+private:
+	struct Entry
+	{
+		ino_t ino;
+		bool isDir;
+		bool isLink;		//ɷӵ,µ·Ҫ·
+		bool stale;			//ڼ䷢˱仯,ʱ½(ʱҲ404ж)
+		bool lazy;			//ڼֵĿ¼,µûɨ,δʱ·
+		off_t size;
+		time_t mtime;
+		std::string target;	//ʹ
+		const std::string* mime;
+	};
+
+	//ɨdirRelĿ¼(·),falseʾԤ
+	bool scanDir(const std::string& dirRel, long long deadlineMs, size_t maxEntries);
+	//ԵĿstat(),޸
+	bool indexEntry(int dfd, const std::string& rel, const char* name, Entry& out);
+	//δлĿѹʱĻ:realpath +  + stat,ɹ(Ŀ)
+	Result resolveSlow(const std::string& rel, Node& out);
+	bool contains(const char* resolved) const;
+	const std::string* internMime(const std::string& fileName);
+	void fillNode(const std::string& rel, const Entry& e, Node& out) const;
+	void eraseTreeLocked(const std::string& rel);
+	//reactor߳е,κļϵͳ:仯ĿֻΪ,һβ½
+	void onFsEvent(const std::string& dir, const std::string& name, uint32_t mask);
+
+	std::string baseDir_;	//realpathĸĿ¼
+	FileWatcher& watcher_;
+	MimeFunc mimeFunc_;
+	bool complete_;			//Ϊtrueʱδмֱж404
+	size_t maxEntries_;
+
+	pthread_rwlock_t lock_;
+	std::unordered_map<std::string, Entry> entries_;	//keyΪ/ͷ·,Ŀ¼Ϊ""
+	std::unordered_set<std::string> mimes_;
+};
@@ -0,0 +1,780 @@
+#include "Proxy.h"
+#include <sys/un.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <iostream>
+
+//Ӧͷ󳤶
+static const size_t MAX_RESPONSE_HEAD = 64 * 1024;
+//ÿsplice˵ֽ
+static const size_t RELAY_CHUNK = 65536;
+
+//ÿ߳һתܵ,߳˳ʱر
+struct RelayPipe
+{
+	int fds[2] = { -1, -1 };
+
+	bool ensure()
+	{
+		if (fds[0] != -1)return true;
+		if (pipe2(fds, O_CLOEXEC | O_NONBLOCK) == -1)
+		{
+			perror("pipe2:proxy");
+			fds[0] = fds[1] = -1;
+			return false;
+		}
+		return true;
+	}
+
+	//ʱܵܲ,ֱӻһµ
+	void reset()
+	{
+		if (fds[0] != -1)close(fds[0]);
+		if (fds[1] != -1)close(fds[1]);
+		fds[0] = fds[1] = -1;
+	}
+
+	~RelayPipe() { reset(); }
+};
+static thread_local RelayPipe relayPipe;
+
+static bool waitFd(int fd, short events, int timeoutMs)
+{
+	struct pollfd pfd = { fd, events, 0 };
+	int ret;
+	do {
+		ret = poll(&pfd, 1, timeoutMs);
+	} while (ret == -1 && errno == EINTR);
+	return ret > 0 && !(pfd.revents & POLLNVAL);
+}
+
+static bool sendAll(int fd, const char* data, size_t len)
+{
+	size_t sent = 0;
+	while (sent < len)
+	{
+		ssize_t n = send(fd, data + sent, len - sent, MSG_NOSIGNAL);
+		if (n < 0)
+		{
+			if (errno == EINTR)continue;
+			if ((errno == EAGAIN || errno == EWOULDBLOCK) && waitFd(fd, POLLOUT, Proxy::UPSTREAM_TIMEOUT_MS))continue;
+			return false;
+		}
+		sent += n;
+	}
+	return true;
+}
+
+//ֱдͻsocket
+class SocketSink : public ProxySink
+{
+public:
+	explicit SocketSink(int fd) : fd_(fd) {}
+	int fd() const override { return fd_; }
+	bool write(const char* data, size_t len) override { return sendAll(fd_, data, len); }
+
+private:
+	int fd_;
+};
+
+static void sendBadGateway(ProxySink& sink, int status, const char* descr)
+{
+	std::string body = "<html><body><h1>" + std::to_string(status) + " " + descr + "</h1></body></html>";
+	std::string response = "HTTP/1.1 " + std::to_string(status) + " " + descr + "\r\nContent-Type:text/html\r\nContent-Length:" +
+		std::to_string(body.size()) + "\r\nConnection:close\r\n\r\n" + body;
+	sink.write(response.data(), response.size());
+}
+
+//ͷת
+static bool isHopByHop(const std::string& name)
+{
+	static const char* HOP[] = { "connection", "keep-alive", "proxy-connection", "te", "trailer",
+		"transfer-encoding", "upgrade", "content-length", "expect" };
+	for (const char* h : HOP)
+	{
+		if (strcasecmp(name.c_str(), h) == 0)return true;
+	}
+	return false;
+}
+
+static std::string headerName(const std::string& line)
+{
+	size_t colon = line.find(':');
+	if (colon == std::string::npos)return "";
+	size_t end = colon;
+	while (end > 0 && (line[end - 1] == ' ' || line[end - 1] == '\t'))end--;
+	return line.substr(0, end);
+}
+
+static std::string headerValue(const std::string& line)
+{
+	size_t colon = line.find(':');
+	if (colon == std::string::npos)return "";
+	size_t b = line.find_first_not_of(" \t", colon + 1);
+	if (b == std::string::npos)return "";
+	size_t e = line.find_last_not_of(" \t\r");
+	return line.substr(b, e - b + 1);
+}
+
+//ֻchunkedı߽,ԭתͻ
+class ChunkScanner
+{
+public:
+	ChunkScanner() : state_(ChunkState::SIZE), remaining_(0), done_(false), error_(false) {}
+
+	//رѵֽ,֮ݲ
+	size_t feed(const char* p, size_t n)
+	{
+		size_t i = 0;
+		while (i < n && !done_ && !error_)
+		{
+			switch (state_)
+			{
+			case ChunkState::SIZE:
+			case ChunkState::DATA_CRLF:
+			case ChunkState::TRAILER:
+			{
+				const char* nl = static_cast<const char*>(memchr(p + i, '\n', n - i));
+				size_t take = nl ? static_cast<size_t>(nl - (p + i)) + 1 : n - i;
+				line_.append(p + i, take);
+				i += take;
+				if (!nl)
+				{
+					if (line_.size() > 4096)error_ = true;
+					break;
+				}
+				onLine();
+				line_.clear();
+				break;
+			}
+			case ChunkState::DATA:
+			{
+				size_t take = std::min<uint64_t>(remaining_, n - i);
+				i += take;
+				remaining_ -= take;
+				if (remaining_ == 0)state_ = ChunkState::DATA_CRLF;
+				break;
+			}
+			}
+		}
+		return i;
+	}
+
+	bool done() const { return done_; }
+	bool error() const { return error_; }
+
+private:
+	void onLine()
+	{
+		if (state_ == ChunkState::SIZE)
+		{
+			char* end = nullptr;
+			remaining_ = strtoull(line_.c_str(), &end, 16);
+			if (end == line_.c_str())
+			{
+				error_ = true;
+				return;
+			}
+			state_ = remaining_ == 0 ? ChunkState::TRAILER : ChunkState::DATA;
+		}
+		else if (state_ == ChunkState::DATA_CRLF)
+		{
+			state_ = ChunkState::SIZE;
+		}
+		else if (line_ == "\r\n" || line_ == "\n")
+		{
+			done_ = true;
+		}
+	}
+
+	ChunkState state_;
+	uint64_t remaining_;
+	std::string line_;
+	bool done_;
+	bool error_;
+};
+
+//spliceεremainingֽڰᵽͻ,remaining<0ʾֱιر
+//1: 0:γ -1:ͻ˳
+static int spliceRelay(int ufd, int cfd, int64_t remaining)
+{
+	if (!relayPipe.ensure())return 0;
+	int* p = relayPipe.fds;
+	while (remaining != 0)
+	{
+		size_t want = (remaining < 0 || remaining > static_cast<int64_t>(RELAY_CHUNK)) ? RELAY_CHUNK : static_cast<size_t>(remaining);
+		ssize_t n = splice(ufd, NULL, p[1], NULL, want, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+		if (n < 0)
+		{
+			if (errno == EINTR)continue;
+			if (errno == EAGAIN && waitFd(ufd, POLLIN, Proxy::UPSTREAM_TIMEOUT_MS))continue;
+			return 0;
+		}
+		if (n == 0)
+		{
+			return remaining < 0 ? 1 : 0;
+		}
+
+		size_t left = n;
+		while (left > 0)
+		{
+			ssize_t m = splice(p[0], NULL, cfd, NULL, left, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+			if (m < 0)
+			{
+				if (errno == EINTR)continue;
+				if (errno == EAGAIN && waitFd(cfd, POLLOUT, Proxy::UPSTREAM_TIMEOUT_MS))continue;
+				relayPipe.reset();
+				return -1;
+			}
+			left -= m;
+		}
+		if (remaining > 0)remaining -= n;
+	}
+	return 1;
+}
+
+//ͻ˲socketʱֻܶû̬ٽsink,ֵͬspliceRelay
+static int copyRelay(int ufd, ProxySink& sink, int64_t remaining)
+{
+	char buf[16384];
+	while (remaining != 0)
+	{
+		size_t want = (remaining < 0 || remaining > static_cast<int64_t>(sizeof(buf))) ? sizeof(buf) : static_cast<size_t>(remaining);
+		ssize_t n = recv(ufd, buf, want, 0);
+		if (n < 0)
+		{
+			if (errno == EINTR)continue;
+			if (errno == EAGAIN && waitFd(ufd, POLLIN, Proxy::UPSTREAM_TIMEOUT_MS))continue;
+			return 0;
+		}
+		if (n == 0)
+		{
+			return remaining < 0 ? 1 : 0;
+		}
+		if (!sink.write(buf, n))return -1;
+		if (remaining > 0)remaining -= n;
+	}
+	return 1;
+}
+
+static int relay(int ufd, ProxySink& sink, int64_t remaining)
+{
+	if (sink.fd() != -1)return spliceRelay(ufd, sink.fd(), remaining);
+	return copyRelay(ufd, sink, remaining);
+}
+
+Proxy::Upstream::Upstream()
+	: addrLen(0)
+{
+	memset(&addr, 0, sizeof(addr));
+	pthread_mutex_init(&mutex, NULL);
+}
+
+Proxy::Upstream::~Upstream()
+{
+	for (int fd : idle)close(fd);
+	pthread_mutex_destroy(&mutex);
+}
+
+Proxy::Proxy()
+{
+	pthread_mutex_init(&mutex_, NULL);
+}
+
+Proxy::~Proxy()
+{
+	pthread_mutex_destroy(&mutex_);
+}
+
+bool Proxy::resolve(const std::string& name, Upstream& upstream, std::string& error)
+{
+	upstream.name = name;
+	if (name.compare(0, 5, "unix:") == 0)
+	{
+		struct sockaddr_un* un = reinterpret_cast<struct sockaddr_un*>(&upstream.addr);
+		std::string path = name.substr(5);
+		if (path.empty() || path.size() >= sizeof(un->sun_path))
+		{
+			error = "bad unix socket path in " + name;
+			return false;
+		}
+		un->sun_family = AF_UNIX;
+		strcpy(un->sun_path, path.c_str());
+		upstream.addrLen = sizeof(struct sockaddr_un);
+		return true;
+	}
+
+	size_t colon = name.rfind(':');
+	if (colon == std::string::npos || colon == 0 || colon + 1 == name.size())
+	{
+		error = "upstream must be host:port or unix:/path: " + name;
+		return false;
+	}
+	std::string host = name.substr(0, colon);
+	std::string port = name.substr(colon + 1);
+	if (host.size() > 2 && host.front() == '[' && host.back() == ']')host = host.substr(1, host.size() - 2);
+
+	struct addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	struct addrinfo* res = nullptr;
+	int ret = getaddrinfo(host.c_str(), port.c_str(), &hints, &res);
+	if (ret != 0 || res == nullptr)
+	{
+		error = "cannot resolve " + name + ": " + gai_strerror(ret);
+		return false;
+	}
+	memcpy(&upstream.addr, res->ai_addr, res->ai_addrlen);
+	upstream.addrLen = res->ai_addrlen;
+	freeaddrinfo(res);
+	return true;
+}
+
+bool Proxy::parseRoute(const std::string& spec, Route& route, std::vector<std::string>& names, std::string& error)
+{
+	std::istringstream in(spec);
+	std::string list, balance;
+	in >> route.prefix >> list >> balance;
+	std::string extra;
+	if (route.prefix.empty() || route.prefix[0] != '/' || list.empty() || (in >> extra))
+	{
+		error = "proxy route must be \"prefix upstream[,upstream...] [balance]\": " + spec;
+		return false;
+	}
+
+	if (balance.empty() || balance == "round_robin")
+	{
+		route.balance = Balance::ROUND_ROBIN;
+	}
+	else if (balance == "least_outstanding")
+	{
+		route.balance = Balance::LEAST_OUTSTANDING;
+	}
+	else
+	{
+		error = "unknown balance " + balance;
+		return false;
+	}
+
+	names.clear();
+	size_t pos = 0;
+	while (pos <= list.size())
+	{
+		size_t comma = list.find(',', pos);
+		if (comma == std::string::npos)comma = list.size();
+		if (comma > pos)names.push_back(list.substr(pos, comma - pos));
+		pos = comma + 1;
+	}
+	if (names.empty())
+	{
+		error = "no upstream in " + spec;
+		return false;
+	}
+	return true;
+}
+
+bool Proxy::checkRoute(const std::string& spec, std::string& error)
+{
+	Route route;
+	std::vector<std::string> names;
+	if (!parseRoute(spec, route, names, error))return false;
+	for (auto& name : names)
+	{
+		Upstream upstream;
+		if (!resolve(name, upstream, error))return false;
+	}
+	return true;
+}
+
+bool Proxy::setRoutes(const std::vector<std::string>& specs, std::string& error)
+{
+	//ͬ,¼ʱеĿ
+	std::map<std::string, UpstreamPtr> existing;
+	pthread_mutex_lock(&mutex_);
+	for (auto& route : routes_)
+	{
+		for (auto& upstream : route->upstreams)existing[upstream->name] = upstream;
+	}
+	pthread_mutex_unlock(&mutex_);
+
+	std::vector<RoutePtr> routes;
+	for (auto& spec : specs)
+	{
+		RoutePtr route = std::make_shared<Route>();
+		std::vector<std::string> names;
+		if (!parseRoute(spec, *route, names, error))return false;
+		for (auto& name : names)
+		{
+			UpstreamPtr& upstream = existing[name];
+			if (!upstream)
+			{
+				upstream = std::make_shared<Upstream>();
+				if (!resolve(name, *upstream, error))
+				{
+					existing.erase(name);
+					return false;
+				}
+			}
+			route->upstreams.push_back(upstream);
+		}
+		routes.push_back(route);
+	}
+	std::stable_sort(routes.begin(), routes.end(), [](const RoutePtr& a, const RoutePtr& b) {
+		return a->prefix.size() > b->prefix.size();
+		});
+
+	pthread_mutex_lock(&mutex_);
+	routes_.swap(routes);
+	pthread_mutex_unlock(&mutex_);
+	return true;
+}
+
+Proxy::RoutePtr Proxy::match(std::string_view url)
+{
+	RoutePtr found;
+	pthread_mutex_lock(&mutex_);
+	for (auto& route : routes_)
+	{
+		if (url.compare(0, route->prefix.size(), route->prefix) == 0)
+		{
+			found = route;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&mutex_);
+	return found;
+}
+
+Proxy::Upstream* Proxy::pick(const Route& route)
+{
+	size_t n = route.upstreams.size();
+	if (n == 0)return nullptr;
+	unsigned start = const_cast<Route&>(route).next++;
+	if (route.balance == Balance::ROUND_ROBIN)
+	{
+		return route.upstreams[start % n].get();
+	}
+
+	//ѯλÿʼתٵ,ͬʱֻ
+	Upstream* best = nullptr;
+	for (size_t i = 0; i < n; i++)
+	{
+		Upstream* candidate = route.upstreams[(start + i) % n].get();
+		if (best == nullptr || candidate->outstanding < best->outstanding)best = candidate;
+	}
+	return best;
+}
+
+int Proxy::acquire(Upstream& upstream, bool& reused)
+{
+	reused = false;
+	pthread_mutex_lock(&upstream.mutex);
+	while (!upstream.idle.empty())
+	{
+		int fd = upstream.idle.back();
+		upstream.idle.pop_back();
+
+		//пɶ¼˵Ѿر(˶),
+		struct pollfd pfd = { fd, POLLIN, 0 };
+		if (poll(&pfd, 1, 0) == 0)
+		{
+			pthread_mutex_unlock(&upstream.mutex);
+			reused = true;
+			return fd;
+		}
+		close(fd);
+	}
+	pthread_mutex_unlock(&upstream.mutex);
+
+	int fd = socket(upstream.addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd == -1)
+	{
+		perror("socket:upstream");
+		return -1;
+	}
+	if (upstream.addr.ss_family != AF_UNIX)
+	{
+		int on = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+	}
+	if (connect(fd, reinterpret_cast<struct sockaddr*>(&upstream.addr), upstream.addrLen) == -1)
+	{
+		int err = errno;
+		if (err == EINPROGRESS || err == EAGAIN)
+		{
+			socklen_t len = sizeof(err);
+			if (!waitFd(fd, POLLOUT, CONNECT_TIMEOUT_MS) ||
+				getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1)
+			{
+				err = ETIMEDOUT;
+			}
+		}
+		if (err != 0)
+		{
+			std::cout << "" << upstream.name << "ʧ:" << strerror(err) << std::endl;
+			close(fd);
+			return -1;
+		}
+	}
+	return fd;
+}
+
+void Proxy::release(Upstream& upstream, int fd, bool reusable)
+{
+	if (reusable)
+	{
+		pthread_mutex_lock(&upstream.mutex);
+		if (upstream.idle.size() < MAX_IDLE_PER_UPSTREAM)
+		{
+			upstream.idle.push_back(fd);
+			fd = -1;
+		}
+		pthread_mutex_unlock(&upstream.mutex);
+	}
+	if (fd != -1)close(fd);
+}
+
+bool Proxy::forward(const Route& route, int cfd, const HttpRequest& req, const std::string& clientIp)
+{
+	SocketSink sink(cfd);
+	return forward(route, sink, req, clientIp);
+}
+
+bool Proxy::forward(const Route& route, ProxySink& sink, const HttpRequest& req, const std::string& clientIp)
+{
+	Upstream* upstream = pick(route);
+	if (upstream == nullptr)
+	{
+		sendBadGateway(sink, 502, "Bad Gateway");
+		return false;
+	}
+
+	//װ,ͷɴԼ
+	std::string head;
+	head.append(req.method).append(" ").append(req.url).append(" HTTP/1.1\r\n");
+	size_t pos = 0;
+	while (pos < req.headers.size())
+	{
+		size_t nl = req.headers.find('\n', pos);
+		if (nl == std::string::npos)nl = req.headers.size();
+		std::string line(req.headers.data() + pos, nl - pos);
+		pos = nl + 1;
+		std::string name = headerName(line);
+		if (name.empty() || isHopByHop(name))continue;
+		head += line + "\r\n";
+	}
+	if (!clientIp.empty())head += "X-Forwarded-For: " + clientIp + "\r\n";
+	if (!req.body.empty() || req.method == "POST" || req.method == "PUT" || req.method == "PATCH")
+	{
+		head += "Content-Length: " + std::to_string(req.body.size()) + "\r\n";
+	}
+	head += "Connection: keep-alive\r\n\r\n";
+
+	std::string resp;
+	size_t headEnd = std::string::npos;
+	int ufd = -1;
+	size_t failover = 0;
+	for (;;)
+	{
+		upstream->outstanding++;
+		upstream->requests++;
+
+		//ӳеӿѱιر,»һһ
+		bool connectFailed = false;
+		for (int attempt = 0; attempt < 2; attempt++)
+		{
+			bool reused = false;
+			ufd = acquire(*upstream, reused);
+			if (ufd == -1)
+			{
+				connectFailed = true;
+				break;
+			}
+
+			resp.clear();
+			bool sent = sendAll(ufd, head.data(), head.size()) &&
+				(req.body.empty() || sendAll(ufd, req.body.data(), req.body.size()));
+			while (sent && headEnd == std::string::npos && resp.size() < MAX_RESPONSE_HEAD)
+			{
+				char buf[4096];
+				ssize_t n = recv(ufd, buf, sizeof(buf), 0);
+				if (n > 0)
+				{
+					resp.append(buf, n);
+					headEnd = resp.find("\r\n\r\n");
+					continue;
+				}
+				if (n < 0 && errno == EINTR)continue;
+				if (n < 0 && errno == EAGAIN && waitFd(ufd, POLLIN, UPSTREAM_TIMEOUT_MS))continue;
+				break;
+			}
+			if (headEnd != std::string::npos)break;
+
+			close(ufd);
+			ufd = -1;
+			if (!reused || !resp.empty())break;
+		}
+		if (ufd != -1)break;
+
+		upstream->failures++;
+		upstream->outstanding--;
+		//ֻʧ(û)ʱŻһ,ݵִ
+		if (!connectFailed || ++failover >= route.upstreams.size())
+		{
+			sendBadGateway(sink, 502, "Bad Gateway");
+			return false;
+		}
+		upstream = pick(route);
+	}
+
+	//״̬к;Ӧ峤ȵͷ
+	int status = 0;
+	bool http11 = resp.compare(0, 9, "HTTP/1.1 ") == 0;
+	if (resp.size() > 12)status = atoi(resp.c_str() + 9);
+	int64_t contentLength = -1;
+	bool chunked = false;
+	bool upstreamClose = !http11;
+
+	std::string out;
+	size_t lineStart = 0;
+	bool first = true;
+	while (lineStart < headEnd)
+	{
+		size_t lineEnd = resp.find("\r\n", lineStart);
+		std::string line = resp.substr(lineStart, lineEnd - lineStart);
+		lineStart = lineEnd + 2;
+		if (first)
+		{
+			out += line + "\r\n";
+			first = false;
+			continue;
+		}
+		std::string name = headerName(line);
+		std::string value = headerValue(line);
+		if (strcasecmp(name.c_str(), "content-length") == 0)
+		{
+			contentLength = strtoll(value.c_str(), nullptr, 10);
+		}
+		else if (strcasecmp(name.c_str(), "transfer-encoding") == 0)
+		{
+			chunked = strcasestr(value.c_str(), "chunked") != nullptr;
+		}
+		else if (strcasecmp(name.c_str(), "connection") == 0)
+		{
+			if (strcasestr(value.c_str(), "close") != nullptr)upstreamClose = true;
+			else if (strcasestr(value.c_str(), "keep-alive") != nullptr)upstreamClose = false;
+			continue;
+		}
+		else if (strcasecmp(name.c_str(), "keep-alive") == 0 || strcasecmp(name.c_str(), "proxy-connection") == 0)
+		{
+			continue;
+		}
+		out += line + "\r\n";
+	}
+	out += "Connection:close\r\n\r\n";
+
+	bool noBody = req.method == "HEAD" || (status >= 100 && status < 200) || status == 204 || status == 304;
+	if (noBody)contentLength = 0;
+
+	//ͷ֮Ѿ
+	std::string prefix = resp.substr(headEnd + 4);
+	bool reusable = !upstreamClose;
+	int result = 1;
+	if (contentLength >= 0)
+	{
+		if (static_cast<int64_t>(prefix.size()) > contentLength)
+		{
+			prefix.resize(contentLength);
+			reusable = false;
+		}
+		out += prefix;
+		if (!sink.write(out.data(), out.size()))result = -1;
+		else result = relay(ufd, sink, contentLength - static_cast<int64_t>(prefix.size()));
+	}
+	else if (chunked)
+	{
+		//chunkedҪҵ,ֻû̬ת
+		ChunkScanner scanner;
+		size_t used = scanner.feed(prefix.data(), prefix.size());
+		if (used < prefix.size())reusable = false;
+		out.append(prefix, 0, used);
+		if (!sink.write(out.data(), out.size()))result = -1;
+		char buf[16384];
+		while (result == 1 && !scanner.done())
+		{
+			if (scanner.error())
+			{
+				result = 0;
+				break;
+			}
+			ssize_t n = recv(ufd, buf, sizeof(buf), 0);
+			if (n < 0 && errno == EINTR)continue;
+			if (n < 0 && errno == EAGAIN && waitFd(ufd, POLLIN, UPSTREAM_TIMEOUT_MS))continue;
+			if (n <= 0)
+			{
+				result = 0;
+				break;
+			}
+			used = scanner.feed(buf, n);
+			if (used < static_cast<size_t>(n))reusable = false;
+			if (!sink.write(buf, used))result = -1;
+		}
+	}
+	else
+	{
+		//ûгϢ,ιرΪֹ
+		reusable = false;
+		out += prefix;
+		if (!sink.write(out.data(), out.size()))result = -1;
+		else result = relay(ufd, sink, -1);
+	}
+
+	if (result == 0)upstream->failures++;
+	release(*upstream, ufd, reusable && result == 1);
+	upstream->outstanding--;
+	return result != -1;
+}
+
+std::string Proxy::statsJson()
+{
+	std::vector<RoutePtr> routes;
+	pthread_mutex_lock(&mutex_);
+	routes = routes_;
+	pthread_mutex_unlock(&mutex_);
+
+	std::string json = "{\"routes\":[";
+	for (size_t r = 0; r < routes.size(); r++)
+	{
+		Route& route = *routes[r];
+		if (r > 0)json += ",";
+		json += "{\"prefix\":\"" + route.prefix + "\",\"balance\":\"" +
+			(route.balance == Balance::ROUND_ROBIN ? "round_robin" : "least_outstanding") + "\",\"upstreams\":[";
+		for (size_t u = 0; u < route.upstreams.size(); u++)
+		{
+			Upstream& upstream = *route.upstreams[u];
+			pthread_mutex_lock(&upstream.mutex);
+			size_t idle = upstream.idle.size();
+			pthread_mutex_unlock(&upstream.mutex);
+			if (u > 0)json += ",";
+			json += "{\"name\":\"" + upstream.name + "\",\"outstanding\":" + std::to_string(upstream.outstanding.load()) +
+				",\"requests\":" + std::to_string(upstream.requests.load()) +
+				",\"failures\":" + std::to_string(upstream.failures.load()) +
+				",\"idle\":" + std::to_string(idle) + "}";
+		}
+		json += "]}";
+	}
+	json += "]}";
+	return json;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "HttpRequest.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <sys/socket.h>
+#include <pthread.h>
+#include <stdint.h>
+
+
+//תȥ:Ĭǿͻsocket;HTTP/2ûжsocket,ռHTTP/1.1ʽӦ
+class ProxySink
+{
+public:
+	virtual ~ProxySink() {}
+	//ֱsplicesocket,ûʱ-1
+	virtual int fd() const = 0;
+	virtual bool write(const char* data, size_t len) = 0;
+};
+
+//:urlǰ׺ƥת(host:portunix:/path),
+//ӱkeep-aliveŻӳظ,ӦspliceֱӴsocketᵽͻsocket
+class Proxy
+{
+public:
+	enum class Balance { ROUND_ROBIN, LEAST_OUTSTANDING };
+
+	struct Upstream
+	{
+		std::string name;			//ед
+		struct sockaddr_storage addr;
+		socklen_t addrLen;
+
+		std::atomic<int> outstanding{ 0 };	//ת
+		std::atomic<uint64_t> requests{ 0 };
+		std::atomic<uint64_t> failures{ 0 };
+
+		pthread_mutex_t mutex;
+		std::vector<int> idle;		//еkeep-alive
+
+		Upstream();
+		~Upstream();
+	};
+	using UpstreamPtr = std::shared_ptr<Upstream>;
+
+	struct Route
+	{
+		std::string prefix;
+		std::vector<UpstreamPtr> upstreams;
+		Balance balance;
+		std::atomic<unsigned> next{ 0 };	//ѯλ
+	};
+	using RoutePtr = std::shared_ptr<Route>;
+
+	Proxy();
+	~Proxy();
+
+	Proxy(const Proxy&) = delete;
+	Proxy& operator=(const Proxy&) = delete;
+
+	//һ·:"ǰ׺ [,...] [round_robin|least_outstanding]"
+	static bool checkRoute(const std::string& spec, std::string& error);
+
+	//滻ȫ·,ͬԭӳ;κһϷʱԭ·ɲ
+	bool setRoutes(const std::vector<std::string>& specs, std::string& error);
+
+	//ǰ׺ƥ,ûƥʱnullptr
+	RoutePtr match(std::string_view url);
+
+	//ת󲢰Ӧдؿͻ(ڹִ߳)
+	//falseʾͻдӦʧ
+	bool forward(const Route& route, int cfd, const HttpRequest& req, const std::string& clientIp);
+	bool forward(const Route& route, ProxySink& sink, const HttpRequest& req, const std::string& clientIp);
+
+	std::string statsJson();
+
+	//ÿౣĿ
+	static const size_t MAX_IDLE_PER_UPSTREAM = 32;
+	static const int CONNECT_TIMEOUT_MS = 1000;
+	static const int UPSTREAM_TIMEOUT_MS = 30000;
+
+private:
+	static bool parseRoute(const std::string& spec, Route& route, std::vector<std::string>& names, std::string& error);
+	static bool resolve(const std::string& name, Upstream& upstream, std::string& error);
+
+	Upstream* pick(const Route& route);
+
+	//ȡһε,reusedʾӳ
+	int acquire(Upstream& upstream, bool& reused);
+	void release(Upstream& upstream, int fd, bool reusable);
+
+	pthread_mutex_t mutex_;
+	std::vector<RoutePtr> routes_;	//ǰ׺ȴӳ
+};
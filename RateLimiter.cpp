@@ -0,0 +1,208 @@
+#include "RateLimiter.h"
+#include <time.h>
+#include <string.h>
+
+//ǧ֮һΪλ洢,⸡
+static const uint64_t TOKEN_UNIT = 1000;
+static const uint64_t TOKEN_MASK = 0xffffffffULL;
+
+static uint64_t mix(uint64_t x)
+{
+	//splitmix64
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+static uint64_t packState(uint32_t ts, uint64_t tokens)
+{
+	return (static_cast<uint64_t>(ts) << 32) | (tokens & TOKEN_MASK);
+}
+
+RateLimiter::RateLimiter(size_t slots)
+{
+	slotsPerShard_ = (slots + SHARD_COUNT - 1) / SHARD_COUNT;
+	if (slotsPerShard_ < PROBE_LIMIT)slotsPerShard_ = PROBE_LIMIT;
+	slots_.reset(new Slot[slotsPerShard_ * SHARD_COUNT]);
+	for (int i = 0; i < KIND_COUNT; i++)
+	{
+		allowed_[i] = 0;
+		rejected_[i] = 0;
+	}
+}
+
+void RateLimiter::setLimit(Kind kind, uint32_t ratePerSec, uint32_t burst)
+{
+	//Ͱܳ32λܱʾǧ֮һ
+	uint64_t maxBurst = TOKEN_MASK / TOKEN_UNIT;
+	if (burst < ratePerSec)burst = ratePerSec;
+	if (burst > maxBurst)burst = static_cast<uint32_t>(maxBurst);
+	limits_[kind].burst = burst;
+	limits_[kind].rate = ratePerSec;
+}
+
+bool RateLimiter::enabled() const
+{
+	for (int i = 0; i < KIND_COUNT; i++)
+	{
+		if (limits_[i].rate != 0)return true;
+	}
+	return false;
+}
+
+uint32_t RateLimiter::nowMs()
+{
+	//ʱ㹻,ֻͨʱӵļ֮һ
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+	return static_cast<uint32_t>(static_cast<uint64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000);
+}
+
+uint64_t RateLimiter::makeKey(Kind kind, uint64_t hi, uint64_t lo)
+{
+	uint64_t key = mix(mix(hi ^ (static_cast<uint64_t>(kind) << 56)) ^ lo);
+	return key == 0 ? 1 : key;
+}
+
+bool RateLimiter::take(Kind kind, uint64_t key, uint32_t now)
+{
+	uint32_t rate = limits_[kind].rate;
+	if (rate == 0)return true;
+	uint64_t capacity = static_cast<uint64_t>(limits_[kind].burst) * TOKEN_UNIT;
+
+	//λѡƬ,λѡƬڵʼ
+	Slot* shard = &slots_[(key >> 58) % SHARD_COUNT * slotsPerShard_];
+	size_t start = key % slotsPerShard_;
+	Slot* slot = nullptr;
+	Slot* oldest = nullptr;
+	uint32_t oldestAge = 0;
+	for (int i = 0; i < PROBE_LIMIT && slot == nullptr; i++)
+	{
+		Slot* s = &shard[(start + i) % slotsPerShard_];
+		uint64_t k = s->key.load(std::memory_order_acquire);
+		if (k == key)
+		{
+			slot = s;
+			break;
+		}
+		if (k == 0)
+		{
+			//ռղ,ʧ˵̸߳ոռ,ٿһǲͬһkey
+			uint64_t expected = 0;
+			if (s->key.compare_exchange_strong(expected, key, std::memory_order_acq_rel) || expected == key)
+			{
+				if (expected == 0)s->state.store(packState(now, capacity), std::memory_order_release);
+				slot = s;
+			}
+			continue;
+		}
+		uint32_t age = now - static_cast<uint32_t>(s->state.load(std::memory_order_relaxed) >> 32);
+		if (oldest == nullptr || age > oldestAge)
+		{
+			oldest = s;
+			oldestAge = age;
+		}
+	}
+
+	if (slot == nullptr)
+	{
+		//̽ⷶΧռ:̭δʵͰ,Ͱƿʼ
+		uint64_t expected = oldest->key.load(std::memory_order_relaxed);
+		if (!oldest->key.compare_exchange_strong(expected, key, std::memory_order_acq_rel))
+		{
+			//̭ʧʱ,ֵΪһ
+			return true;
+		}
+		oldest->state.store(packState(now, capacity), std::memory_order_release);
+		evictions_++;
+		slot = oldest;
+	}
+
+	uint64_t cur = slot->state.load(std::memory_order_acquire);
+	for (;;)
+	{
+		uint32_t ts = static_cast<uint32_t>(cur >> 32);
+		uint64_t tokens = cur & TOKEN_MASK;
+		uint32_t elapsed = now - ts;
+		//ʱӻƻ򲢷дɵ"δ"ʱ0
+		if (elapsed > 0x80000000U)elapsed = 0;
+
+		//rate/ = rateǧ֮һ/
+		tokens += static_cast<uint64_t>(elapsed) * rate;
+		if (tokens > capacity)tokens = capacity;
+
+		bool ok = tokens >= TOKEN_UNIT;
+		if (ok)tokens -= TOKEN_UNIT;
+		uint64_t next = packState(elapsed == 0 ? ts : now, tokens);
+		if (slot->state.compare_exchange_weak(cur, next, std::memory_order_acq_rel))
+		{
+			return ok;
+		}
+	}
+}
+
+bool RateLimiter::check(Kind ipKind, Kind netKind, uint64_t ipKey, uint64_t netKey)
+{
+	uint32_t now = nowMs();
+	//Ȳ,γʱĵַ
+	if (!take(netKind, netKey, now))
+	{
+		rejected_[netKind]++;
+		return false;
+	}
+	if (!take(ipKind, ipKey, now))
+	{
+		rejected_[ipKind]++;
+		return false;
+	}
+	allowed_[ipKind]++;
+	return true;
+}
+
+bool RateLimiter::allowConnection(const struct in_addr& addr)
+{
+	uint32_t ip = ntohl(addr.s_addr);
+	return check(CONN_IP, CONN_NET, makeKey(CONN_IP, 4, ip), makeKey(CONN_NET, 4, ip & 0xffffff00U));
+}
+
+bool RateLimiter::allowRequest(const struct in_addr& addr)
+{
+	uint32_t ip = ntohl(addr.s_addr);
+	return check(REQ_IP, REQ_NET, makeKey(REQ_IP, 4, ip), makeKey(REQ_NET, 4, ip & 0xffffff00U));
+}
+
+bool RateLimiter::allowConnection(const struct in6_addr& addr)
+{
+	uint64_t hi, lo;
+	memcpy(&hi, addr.s6_addr, 8);
+	memcpy(&lo, addr.s6_addr + 8, 8);
+	return check(CONN_IP, CONN_NET, makeKey(CONN_IP, hi, lo), makeKey(CONN_NET, hi, 6));
+}
+
+bool RateLimiter::allowRequest(const struct in6_addr& addr)
+{
+	uint64_t hi, lo;
+	memcpy(&hi, addr.s6_addr, 8);
+	memcpy(&lo, addr.s6_addr + 8, 8);
+	return check(REQ_IP, REQ_NET, makeKey(REQ_IP, hi, lo), makeKey(REQ_NET, hi, 6));
+}
+
+std::string RateLimiter::statsJson()
+{
+	static const char* NAMES[KIND_COUNT] = { "connIp", "connNet", "reqIp", "reqNet" };
+	std::string json = "{\"slots\":" + std::to_string(slotsPerShard_ * SHARD_COUNT) +
+		",\"evictions\":" + std::to_string(evictions_.load()) + ",\"limits\":{";
+	for (int i = 0; i < KIND_COUNT; i++)
+	{
+		if (i > 0)json += ",";
+		json += "\"" + std::string(NAMES[i]) + "\":{\"rate\":" + std::to_string(limits_[i].rate.load()) +
+			",\"burst\":" + std::to_string(limits_[i].burst.load()) +
+			",\"rejected\":" + std::to_string(rejected_[i].load());
+		//ֻͨڵַһ
+		if (i == CONN_IP || i == REQ_IP)json += ",\"allowed\":" + std::to_string(allowed_[i].load());
+		json += "}";
+	}
+	json += "}}";
+	return json;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+#include <netinet/in.h>
+
+
+//ͻ˵ַ:ÿַڵ(IPv4 /24,IPv6 /64)һͰ,
+//ֱ½ӵʺ
+//Ͱڹ̶СƬĿѰַ,ȫCAS,;
+//ʱ̭̽ⷶΧδʵͰ(LRU)
+class RateLimiter
+{
+public:
+	enum Kind
+	{
+		CONN_IP = 0,	//ַ½
+		CONN_NET,		//ε½
+		REQ_IP,			//ַ
+		REQ_NET,		//ε
+		KIND_COUNT
+	};
+
+	//slotsΪܲ,ȡƬ
+	explicit RateLimiter(size_t slots = 65536);
+
+	RateLimiter(const RateLimiter&) = delete;
+	RateLimiter& operator=(const RateLimiter&) = delete;
+
+	//ratePerSecΪ0ʱƸ
+	void setLimit(Kind kind, uint32_t ratePerSec, uint32_t burst);
+
+	//ַֽ
+	bool allowConnection(const struct in_addr& addr);
+	bool allowConnection(const struct in6_addr& addr);
+	bool allowRequest(const struct in_addr& addr);
+	bool allowRequest(const struct in6_addr& addr);
+
+	bool enabled() const;
+	std::string statsJson();
+
+	static const int SHARD_COUNT = 64;
+	static const int PROBE_LIMIT = 8;	//ÿkey̽Ĳ
+
+private:
+	struct Slot
+	{
+		std::atomic<uint64_t> key{ 0 };		//0ʾղ
+		std::atomic<uint64_t> state{ 0 };	//32λ:ϴβʱ(),32λ:(ǧ֮һ)
+	};
+
+	struct Limit
+	{
+		std::atomic<uint32_t> rate{ 0 };
+		std::atomic<uint32_t> burst{ 0 };
+	};
+
+	bool take(Kind kind, uint64_t key, uint32_t now);
+	bool check(Kind ipKind, Kind netKind, uint64_t ipKey, uint64_t netKey);
+	static uint64_t makeKey(Kind kind, uint64_t hi, uint64_t lo);
+	static uint32_t nowMs();
+
+	size_t slotsPerShard_;
+	std::unique_ptr<Slot[]> slots_;
+	Limit limits_[KIND_COUNT];
+	std::atomic<uint64_t> allowed_[KIND_COUNT];
+	std::atomic<uint64_t> rejected_[KIND_COUNT];
+	std::atomic<uint64_t> evictions_{ 0 };
+};
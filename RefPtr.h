@@ -0,0 +1,112 @@
+#pragma once
+#include <atomic>
+#include <utility>
+#include <stddef.h>
+
+
+//ʽüĻ:Ͷһ,Ҫshared_ptrĿƿ
+//һRefPtrͷʱdelete
+template<class T>
+class RefCounted
+{
+public:
+	void addRef() const
+	{
+		refs_.fetch_add(1, std::memory_order_relaxed);
+	}
+	void release() const
+	{
+		if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			delete static_cast<const T*>(this);
+		}
+	}
+	int refCount() const { return refs_.load(std::memory_order_relaxed); }
+
+protected:
+	RefCounted() : refs_(0) {}
+	~RefCounted() {}
+
+	RefCounted(const RefCounted&) = delete;
+	RefCounted& operator=(const RefCounted&) = delete;
+
+private:
+	mutable std::atomic<int> refs_;
+};
+
+//ָRefCountedָ:ʱһ,ƶı
+template<class T>
+class RefPtr
+{
+public:
+	RefPtr() : ptr_(nullptr) {}
+	RefPtr(std::nullptr_t) : ptr_(nullptr) {}
+	explicit RefPtr(T* p) : ptr_(p)
+	{
+		if (ptr_ != nullptr)ptr_->addRef();
+	}
+	RefPtr(const RefPtr& other) : ptr_(other.ptr_)
+	{
+		if (ptr_ != nullptr)ptr_->addRef();
+	}
+	RefPtr(RefPtr&& other) noexcept : ptr_(other.ptr_)
+	{
+		other.ptr_ = nullptr;
+	}
+	~RefPtr()
+	{
+		if (ptr_ != nullptr)ptr_->release();
+	}
+
+	RefPtr& operator=(const RefPtr& other)
+	{
+		RefPtr(other).swap(*this);
+		return *this;
+	}
+	RefPtr& operator=(RefPtr&& other) noexcept
+	{
+		RefPtr(std::move(other)).swap(*this);
+		return *this;
+	}
+
+	void reset()
+	{
+		RefPtr().swap(*this);
+	}
+	void swap(RefPtr& other) noexcept
+	{
+		std::swap(ptr_, other.ptr_);
+	}
+
+	//е,ı,֮ɵ߸adopt½ӹ
+	T* detach()
+	{
+		T* p = ptr_;
+		ptr_ = nullptr;
+		return p;
+	}
+	//ӹdetach,ı
+	static RefPtr adopt(T* p)
+	{
+		RefPtr r;
+		r.ptr_ = p;
+		return r;
+	}
+
+	T* get() const { return ptr_; }
+	T& operator*() const { return *ptr_; }
+	T* operator->() const { return ptr_; }
+	explicit operator bool() const { return ptr_ != nullptr; }
+
+	bool operator==(const RefPtr& other) const { return ptr_ == other.ptr_; }
+	bool operator!=(const RefPtr& other) const { return ptr_ != other.ptr_; }
+
+private:
+	T* ptr_;
+};
+
+template<class T, class... Args>
+RefPtr<T> makeRef(Args&&... args)
+{
+	return RefPtr<T>(new T(std::forward<Args>(args)...));
+}
@@ -0,0 +1,75 @@
+#include "RequestArena.h"
+#include "RingBuffer.h"
+#include <vector>
+#include <stdint.h>
+
+namespace
+{
+	//ÿ̵߳Ŀп,ֻBLOCK_SIZEСĿ
+	struct BlockCache
+	{
+		std::vector<char*> free;
+
+		BlockCache() { free.reserve(RequestArena::MAX_CACHED_BLOCKS); }
+		~BlockCache()
+		{
+			for (char* p : free)BufferPool::instance().release(p, RequestArena::BLOCK_SIZE);
+		}
+	};
+
+	thread_local BlockCache blockCache;
+}
+
+char* RequestArena::takeBlock(size_t& cap)
+{
+	if (cap == BLOCK_SIZE && !blockCache.free.empty())
+	{
+		char* p = blockCache.free.back();
+		blockCache.free.pop_back();
+		return p;
+	}
+	//reactorʱȡ,ʱڹ߳й黹,ߵĻͨBufferPoolƽ
+	return BufferPool::instance().acquire(cap);
+}
+
+void RequestArena::giveBlock(char* p, size_t cap)
+{
+	if (cap == BLOCK_SIZE && blockCache.free.size() < MAX_CACHED_BLOCKS)
+	{
+		blockCache.free.push_back(p);
+		return;
+	}
+	BufferPool::instance().release(p, cap);
+}
+
+void* RequestArena::do_allocate(size_t bytes, size_t align)
+{
+	uintptr_t p = (reinterpret_cast<uintptr_t>(cur_) + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+	if (cur_ == nullptr || p + bytes > reinterpret_cast<uintptr_t>(end_))
+	{
+		//ǰŲ:ȡһ¿,ͷȰҪĴСȡ
+		size_t cap = sizeof(Block) + bytes + align;
+		if (cap < BLOCK_SIZE)cap = BLOCK_SIZE;
+		char* raw = takeBlock(cap);
+		Block* block = reinterpret_cast<Block*>(raw);
+		block->next = blocks_;
+		block->cap = cap;
+		blocks_ = block;
+		cur_ = raw + sizeof(Block);
+		end_ = raw + cap;
+		p = (reinterpret_cast<uintptr_t>(cur_) + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+	}
+	cur_ = reinterpret_cast<char*>(p + bytes);
+	return reinterpret_cast<void*>(p);
+}
+
+void RequestArena::release()
+{
+	while (blocks_ != nullptr)
+	{
+		Block* next = blocks_->next;
+		giveBlock(reinterpret_cast<char*>(blocks_), blocks_->cap);
+		blocks_ = next;
+	}
+	cur_ = end_ = nullptr;
+}
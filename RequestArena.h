@@ -0,0 +1,43 @@
+#pragma once
+#include <memory_resource>
+#include <stddef.h>
+
+
+//ڵڴ:СͷURLַ,ֻ,ʱ黹
+//ڴ水BLOCK_SIZEĿӵǰ̵߳Ļȡ,˻ٺBufferPool,ȶٵȫַ
+//ͬһֻͬʱһ߳д(reactor,ִ߳,reactor),
+class RequestArena : public std::pmr::memory_resource
+{
+public:
+	RequestArena() : blocks_(nullptr), cur_(nullptr), end_(nullptr) {}
+	~RequestArena() { release(); }
+
+	RequestArena(const RequestArena&) = delete;
+	RequestArena& operator=(const RequestArena&) = delete;
+
+	//黹п,ַ֮ʹ;ֻͨһ
+	void release();
+
+	static const size_t BLOCK_SIZE = 4096;
+	static const size_t MAX_CACHED_BLOCKS = 64;	//ÿ̻߳Ŀп,ĻBufferPool
+
+private:
+	//Ŀͷ¼
+	struct Block
+	{
+		Block* next;
+		size_t cap;
+	};
+
+	void* do_allocate(size_t bytes, size_t align) override;
+	//ͷʲô,ڴreleaseʱ黹
+	void do_deallocate(void*, size_t, size_t) override {}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+	static char* takeBlock(size_t& cap);
+	static void giveBlock(char* p, size_t cap);
+
+	Block* blocks_;
+	char* cur_;
+	char* end_;
+};
@@ -0,0 +1,197 @@
+#include "RingBuffer.h"
+#include <sys/uio.h>
+#include <string.h>
+
+BufferPool& BufferPool::instance()
+{
+	static BufferPool pool;
+	return pool;
+}
+
+BufferPool::BufferPool()
+{
+	pthread_mutex_init(&mutex_, NULL);
+}
+
+int BufferPool::classOf(size_t cap)
+{
+	int c = 0;
+	size_t block = MIN_BLOCK;
+	while (block < cap)
+	{
+		block <<= 1;
+		c++;
+	}
+	return c;
+}
+
+char* BufferPool::acquire(size_t& cap)
+{
+	int c = classOf(cap);
+	cap = MIN_BLOCK << c;
+	if (c < CLASS_COUNT)
+	{
+		pthread_mutex_lock(&mutex_);
+		if (!free_[c].empty())
+		{
+			char* p = free_[c].back();
+			free_[c].pop_back();
+			pthread_mutex_unlock(&mutex_);
+			return p;
+		}
+		pthread_mutex_unlock(&mutex_);
+	}
+	return new char[cap];
+}
+
+void BufferPool::release(char* p, size_t cap)
+{
+	if (p == nullptr)return;
+	int c = classOf(cap);
+	if (c < CLASS_COUNT)
+	{
+		pthread_mutex_lock(&mutex_);
+		if (free_[c].size() < MAX_FREE_PER_CLASS)
+		{
+			free_[c].push_back(p);
+			p = nullptr;
+		}
+		pthread_mutex_unlock(&mutex_);
+	}
+	delete[] p;
+}
+
+RingBuffer::RingBuffer()
+	: buf_(nullptr), cap_(0), head_(0), size_(0)
+{
+}
+
+RingBuffer::~RingBuffer()
+{
+	clear();
+}
+
+void RingBuffer::reserve(size_t need)
+{
+	if (need <= cap_)return;
+
+	//ʱ˳ɴ0ʼ
+	size_t cap = need;
+	char* buf = BufferPool::instance().acquire(cap);
+	size_t first = size_ < cap_ - head_ ? size_ : cap_ - head_;
+	if (size_ > 0)
+	{
+		memcpy(buf, buf_ + head_, first);
+		memcpy(buf + first, buf_, size_ - first);
+	}
+	BufferPool::instance().release(buf_, cap_);
+	buf_ = buf;
+	cap_ = cap;
+	head_ = 0;
+}
+
+ssize_t RingBuffer::readFrom(int fd, char* spill, size_t spillSize)
+{
+	struct iovec iov[3];
+	int cnt = 0;
+	size_t room = cap_ - size_;
+	if (room > 0)
+	{
+		size_t tail = (head_ + size_) % cap_;
+		if (tail >= head_)
+		{
+			//вֳֿܷβͿͷ
+			iov[cnt].iov_base = buf_ + tail;
+			iov[cnt].iov_len = cap_ - tail;
+			cnt++;
+			if (head_ > 0)
+			{
+				iov[cnt].iov_base = buf_;
+				iov[cnt].iov_len = head_;
+				cnt++;
+			}
+		}
+		else
+		{
+			iov[cnt].iov_base = buf_ + tail;
+			iov[cnt].iov_len = head_ - tail;
+			cnt++;
+		}
+	}
+	iov[cnt].iov_base = spill;
+	iov[cnt].iov_len = spillSize;
+	cnt++;
+
+	ssize_t n = readv(fd, iov, cnt);
+	if (n <= 0)return n;
+
+	size_t inRing = static_cast<size_t>(n) < room ? static_cast<size_t>(n) : room;
+	size_ += inRing;
+	size_t extra = n - inRing;
+	if (extra > 0)
+	{
+		reserve(size_ + extra);
+		memcpy(buf_ + size_, spill, extra);
+		size_ += extra;
+	}
+	return n;
+}
+
+void RingBuffer::append(const char* p, size_t n)
+{
+	if (n == 0)return;
+	reserve(size_ + n);
+	size_t tail = (head_ + size_) % cap_;
+	size_t first = n < cap_ - tail ? n : cap_ - tail;
+	memcpy(buf_ + tail, p, first);
+	memcpy(buf_, p + first, n - first);
+	size_ += n;
+}
+
+const char* RingBuffer::data()
+{
+	if (size_ == 0)return buf_;
+	if (head_ + size_ <= cap_)return buf_ + head_;
+
+	//ƻصͷ:һͬСڴ
+	size_t cap = cap_;
+	char* buf = BufferPool::instance().acquire(cap);
+	size_t first = cap_ - head_;
+	memcpy(buf, buf_ + head_, first);
+	memcpy(buf + first, buf_, size_ - first);
+	BufferPool::instance().release(buf_, cap_);
+	buf_ = buf;
+	cap_ = cap;
+	head_ = 0;
+	return buf_;
+}
+
+void RingBuffer::consume(size_t n)
+{
+	if (n >= size_)
+	{
+		head_ = 0;
+		size_ = 0;
+		return;
+	}
+	head_ = (head_ + n) % cap_;
+	size_ -= n;
+}
+
+void RingBuffer::shrink()
+{
+	if (size_ == 0 && buf_ != nullptr)
+	{
+		BufferPool::instance().release(buf_, cap_);
+		buf_ = nullptr;
+		cap_ = 0;
+		head_ = 0;
+	}
+}
+
+void RingBuffer::clear()
+{
+	size_ = 0;
+	head_ = 0;
+	shrink();
+}
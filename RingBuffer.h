@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include <stddef.h>
+#include <sys/types.h>
+#include <pthread.h>
+
+
+//ڴ,2ݷֵ,ӹ黹ڴ︴
+class BufferPool
+{
+public:
+	static BufferPool& instance();
+
+	//capȡֵСʵ
+	char* acquire(size_t& cap);
+	void release(char* p, size_t cap);
+
+	static const size_t MIN_BLOCK = 4096;
+	static const size_t MAX_POOLED = 64 * 1024;	//Ŀֱͷ,
+	static const size_t MAX_FREE_PER_CLASS = 1024;
+
+private:
+	BufferPool();
+	static int classOf(size_t cap);
+
+	static const int CLASS_COUNT = 5;	//4K,8K,16K,32K,64K
+	pthread_mutex_t mutex_;
+	std::vector<char*> free_[CLASS_COUNT];
+};
+
+//ÿӵĻζ:δѵһζȡ
+//ʼռڴ,һζȡʱӳȡ,ݶ黹
+class RingBuffer
+{
+public:
+	RingBuffer();
+	~RingBuffer();
+
+	RingBuffer(const RingBuffer&) = delete;
+	RingBuffer& operator=(const RingBuffer&) = delete;
+
+	size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+	size_t capacity() const { return cap_; }
+
+	//һreadv:Ŀв,ʣµ䵽,ٰʵʴСݿ
+	//ֵreadvͬ
+	ssize_t readFrom(int fd, char* spill, size_t spillSize);
+	//׷Ѿ𴦵(OpenSSLܺ)
+	void append(const char* p, size_t n);
+
+	//Ŀɶ,ƻʱ
+	const char* data();
+	void consume(size_t n);
+
+	//ûʱڴ滹
+	void shrink();
+	void clear();
+
+private:
+	void reserve(size_t need);
+
+	char* buf_;
+	size_t cap_;
+	size_t head_;
+	size_t size_;
+};
@@ -0,0 +1,507 @@
+#include "Router.h"
+#include "HttpHeader.h"
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <errno.h>
+#include <strings.h>
+#include <algorithm>
+
+//·ģʽеһڵ:labelһ̬·("admin/file-strategy"),
+//ֻڷֲ洦,һûз֧ĳ·ֻռһڵ
+struct Router::Node
+{
+	std::string label;
+	std::vector<std::unique_ptr<Node>> children;	//̬ӽڵ,һ·
+	std::unique_ptr<Node> paramChild;			//:nameӽڵ,ƥһ·
+	std::string paramName;
+	std::vector<Entry> handlers;				//ڴ˴·
+	std::vector<Entry> wildcard;				//ڴ˴*·
+};
+
+static std::string_view firstSegment(std::string_view s)
+{
+	size_t slash = s.find('/');
+	return slash == std::string_view::npos ? s : s.substr(0, slash);
+}
+
+static std::string join(const std::vector<std::string>& segs, size_t from, size_t to)
+{
+	std::string out;
+	for (size_t i = from; i < to; i++)
+	{
+		if (i > from)out += '/';
+		out += segs[i];
+	}
+	return out;
+}
+
+static std::vector<std::string> split(const std::string& s)
+{
+	std::vector<std::string> segs;
+	size_t pos = 0;
+	while (pos <= s.size())
+	{
+		size_t slash = s.find('/', pos);
+		if (slash == std::string::npos)slash = s.size();
+		segs.push_back(s.substr(pos, slash - pos));
+		pos = slash + 1;
+	}
+	return segs;
+}
+
+unsigned parseMethod(std::string_view method)
+{
+	if (method == "GET")return METHOD_GET;
+	if (method == "HEAD")return METHOD_HEAD;
+	if (method == "POST")return METHOD_POST;
+	if (method == "PUT")return METHOD_PUT;
+	if (method == "DELETE")return METHOD_DELETE;
+	if (method == "PATCH")return METHOD_PATCH;
+	if (method == "OPTIONS")return METHOD_OPTIONS;
+	return 0;
+}
+
+std::string_view RouteMatch::param(std::string_view name) const
+{
+	for (int i = 0; i < paramCount; i++)
+	{
+		if (params[i].name == name)return params[i].value;
+	}
+	return std::string_view();
+}
+
+std::string_view RequestView::header(std::string_view name) const
+{
+	size_t pos = 0;
+	while (pos < headers.size())
+	{
+		size_t nl = headers.find('\n', pos);
+		if (nl == std::string_view::npos)nl = headers.size();
+		std::string_view line = headers.substr(pos, nl - pos);
+		pos = nl + 1;
+
+		if (line.size() > name.size() && line[name.size()] == ':' &&
+			strncasecmp(line.data(), name.data(), name.size()) == 0)
+		{
+			std::string_view value = line.substr(name.size() + 1);
+			while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))value.remove_prefix(1);
+			while (!value.empty() && (value.back() == '\r' || value.back() == ' '))value.remove_suffix(1);
+			return value;
+		}
+	}
+	return std::string_view();
+}
+
+ResponseWriter::ResponseWriter(int fd)
+	: fd_(fd), status_(200), reason_("OK"), sent_(false), bytes_(0),
+	streaming_(false), chunked_(true), keepAlive_(false), headSent_(false), ended_(false), failed_(false)
+{
+}
+
+ResponseWriter::ResponseWriter(Sink sink)
+	: fd_(-1), sink_(std::move(sink)), status_(200), reason_("OK"), sent_(false), bytes_(0),
+	streaming_(false), chunked_(true), keepAlive_(false), headSent_(false), ended_(false), failed_(false)
+{
+}
+
+void ResponseWriter::setStatus(int status, const char* reason)
+{
+	status_ = status;
+	reason_ = reason;
+}
+
+void ResponseWriter::addHeader(std::string_view name, std::string_view value)
+{
+	headers_.append(name.data(), name.size());
+	headers_ += ':';
+	headers_.append(value.data(), value.size());
+	headers_ += "\r\n";
+}
+
+void ResponseWriter::statusLine(ResponseHead& head, std::string_view contentType) const
+{
+	head.begin(status_, reason_);
+	head.header("Content-Type", contentType);
+}
+
+bool ResponseWriter::writeAll(struct iovec* iov, int count)
+{
+	//֮ǰдʱµȷ,ûʱݽں,֤˳
+	if (!unsent_.empty() && !drainUnsent())return false;
+	while (count > 0)
+	{
+		ssize_t n = unsent_.empty() ? writev(fd_, iov, count) : 0;
+		if (n < 0)
+		{
+			if (errno == EINTR)continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)return false;
+			n = 0;
+		}
+		if (n == 0 && count > 0)
+		{
+			//socketд:ʣ߽reactor,ڹ߳ȴд
+			for (int i = 0; i < count; i++)unsent_.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+			return true;
+		}
+		bytes_ += n;
+		//ѾдĲ
+		while (count > 0 && static_cast<size_t>(n) >= iov->iov_len)
+		{
+			n -= iov->iov_len;
+			iov++;
+			count--;
+		}
+		if (count > 0)
+		{
+			iov->iov_base = static_cast<char*>(iov->iov_base) + n;
+			iov->iov_len -= n;
+		}
+	}
+	return true;
+}
+
+bool ResponseWriter::drainUnsent()
+{
+	size_t done = 0;
+	while (done < unsent_.size())
+	{
+		ssize_t n = ::write(fd_, unsent_.data() + done, unsent_.size() - done);
+		if (n < 0)
+		{
+			if (errno == EINTR)continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)break;
+			return false;
+		}
+		done += n;
+	}
+	bytes_ += done;
+	unsent_.erase(0, done);
+	return true;
+}
+
+bool ResponseWriter::send(std::string_view body, std::string_view contentType)
+{
+	if (sent_ || streaming_)return false;
+	sent_ = true;
+	if (sink_)return sink_(status_, contentType, headers_, body);
+
+	ResponseHead head;
+	statusLine(head, contentType);
+	head.contentLength(body.size());
+	head.raw(headers_);
+	head.finish(keepAlive_);
+
+	//ͷӦһwritev,Ӧ岻ٿ
+	struct iovec iov[2];
+	iov[0].iov_base = const_cast<char*>(head.data());
+	iov[0].iov_len = head.size();
+	iov[1].iov_base = const_cast<char*>(body.data());
+	iov[1].iov_len = body.size();
+	if (!writeAll(iov, body.empty() ? 1 : 2))
+	{
+		failed_ = true;
+		return false;
+	}
+	return true;
+}
+
+bool ResponseWriter::begin(std::string_view contentType)
+{
+	if (sent_ || streaming_)return false;
+	streaming_ = true;
+	contentType_.assign(contentType.data(), contentType.size());
+	return true;
+}
+
+bool ResponseWriter::write(std::string_view data)
+{
+	if (!streaming_ && !begin())return false;
+	if (ended_ || failed_)return false;
+	if (sink_ || pending_.size() + data.size() < CHUNK_SIZE)
+	{
+		pending_.append(data.data(), data.size());
+		return true;
+	}
+	//ֱӷ,
+	if (pending_.empty())return sendChunk(data, false);
+	pending_.append(data.data(), data.size());
+	return flush();
+}
+
+bool ResponseWriter::flush()
+{
+	if (!streaming_ || ended_ || failed_)return false;
+	if (sink_)return true;
+	//ûʱҲͷ,ͻ˿Ծ翪ʼ
+	if (pending_.empty() && headSent_)return true;
+	bool ok = sendChunk(pending_, false);
+	pending_.clear();
+	return ok;
+}
+
+bool ResponseWriter::end()
+{
+	if (!streaming_ || ended_)return !failed_;
+	ended_ = true;
+	if (failed_)return false;
+	if (sink_)
+	{
+		sent_ = true;
+		return sink_(status_, contentType_, headers_, pending_);
+	}
+	bool ok = sendChunk(pending_, true);
+	pending_.clear();
+	return ok;
+}
+
+bool ResponseWriter::sendChunk(std::string_view data, bool last)
+{
+	ResponseHead head;
+	bool withHead = !headSent_;
+	if (withHead)
+	{
+		statusLine(head, contentType_);
+		if (chunked_)head.raw("Transfer-Encoding:chunked\r\n");
+		head.raw(headers_);
+		head.finish(keepAlive_ && chunked_);
+		headSent_ = true;
+		sent_ = true;
+	}
+
+	//ͷ鳤ȡݺͽһwritev
+	char size[24];
+	struct iovec iov[5];
+	int count = 0;
+	if (withHead)
+	{
+		iov[count].iov_base = const_cast<char*>(head.data());
+		iov[count++].iov_len = head.size();
+	}
+	if (!data.empty())
+	{
+		if (chunked_)
+		{
+			iov[count].iov_base = size;
+			iov[count++].iov_len = snprintf(size, sizeof(size), "%zx\r\n", data.size());
+		}
+		iov[count].iov_base = const_cast<char*>(data.data());
+		iov[count++].iov_len = data.size();
+		if (chunked_)
+		{
+			iov[count].iov_base = const_cast<char*>("\r\n");
+			iov[count++].iov_len = 2;
+		}
+	}
+	if (last && chunked_)
+	{
+		iov[count].iov_base = const_cast<char*>("0\r\n\r\n");
+		iov[count++].iov_len = 5;
+	}
+	if (count == 0)return true;
+	if (!writeAll(iov, count))
+	{
+		failed_ = true;
+		return false;
+	}
+	return true;
+}
+
+//ѺװHttpHandler
+class FunctionHandler : public HttpHandler
+{
+public:
+	explicit FunctionHandler(HandlerFunc func) : func_(std::move(func)) {}
+	void handle(const RequestView& req, ResponseWriter& resp) override { func_(req, resp); }
+
+private:
+	HandlerFunc func_;
+};
+
+Router::Router()
+	: root_(new Node), routes_(0)
+{
+}
+
+Router::~Router()
+{
+}
+
+bool Router::add(unsigned methods, const std::string& pattern, HandlerFunc func)
+{
+	return add(methods, pattern, std::make_shared<FunctionHandler>(std::move(func)));
+}
+
+bool Router::add(unsigned methods, const std::string& pattern, HandlerPtr handler)
+{
+	if (pattern.empty() || pattern[0] != '/' || !handler || methods == 0)return false;
+
+	//·"/"ӦյĶ,β/ƥ
+	std::string trimmed = pattern.substr(1);
+	if (!trimmed.empty() && trimmed.back() == '/')trimmed.pop_back();
+	std::vector<std::string> segs;
+	if (!trimmed.empty())segs = split(trimmed);
+
+	int params = 0;
+	for (size_t i = 0; i < segs.size(); i++)
+	{
+		const std::string& seg = segs[i];
+		if (seg == "*" && i + 1 != segs.size())return false;
+		if (!seg.empty() && seg[0] == ':' && (seg.size() == 1 || ++params > RouteMatch::MAX_PARAMS))return false;
+	}
+
+	Node* node = root_.get();
+	size_t i = 0;
+	std::vector<Entry>* target = nullptr;
+	while (i < segs.size())
+	{
+		const std::string& seg = segs[i];
+		if (seg == "*")
+		{
+			target = &node->wildcard;
+			break;
+		}
+
+		if (!seg.empty() && seg[0] == ':')
+		{
+			std::string name = seg.substr(1);
+			if (!node->paramChild)
+			{
+				node->paramChild.reset(new Node);
+				node->paramName = name;
+			}
+			else if (node->paramName != name)
+			{
+				//ͬһλõĲһ,ƥ
+				return false;
+			}
+			node = node->paramChild.get();
+			i++;
+			continue;
+		}
+
+		auto& children = node->children;
+		auto it = std::lower_bound(children.begin(), children.end(), seg,
+			[](const std::unique_ptr<Node>& child, const std::string& key) {
+				return firstSegment(child->label) < std::string_view(key);
+			});
+
+		if (it == children.end() || firstSegment((*it)->label) != std::string_view(seg))
+		{
+			//·֧:ľ̬κϲΪһڵ
+			size_t end = i;
+			while (end < segs.size() && segs[end] != "*" && (segs[end].empty() || segs[end][0] != ':'))end++;
+			std::unique_ptr<Node> child(new Node);
+			child->label = join(segs, i, end);
+			node = child.get();
+			children.insert(it, std::move(child));
+			i = end;
+			continue;
+		}
+
+		//нڵlabelαȽ,ֻƥһʱָýڵ
+		std::vector<std::string> labelSegs = split((*it)->label);
+		size_t k = 0;
+		while (k < labelSegs.size() && i + k < segs.size() && labelSegs[k] == segs[i + k])k++;
+		if (k < labelSegs.size())
+		{
+			std::unique_ptr<Node> middle(new Node);
+			middle->label = join(labelSegs, 0, k);
+			(*it)->label = join(labelSegs, k, labelSegs.size());
+			middle->children.push_back(std::move(*it));
+			*it = std::move(middle);
+		}
+		node = it->get();
+		i += k;
+	}
+	if (target == nullptr)target = &node->handlers;
+
+	for (auto& entry : *target)
+	{
+		if (entry.methods & methods)return false;
+	}
+	target->push_back(Entry{ methods, std::move(handler) });
+	routes_++;
+	return true;
+}
+
+Router::Result Router::pickHandler(const std::vector<Entry>& entries, unsigned method, HttpHandler*& handler)
+{
+	if (entries.empty())return Result::NOT_FOUND;
+	for (auto& entry : entries)
+	{
+		if (entry.methods & method)
+		{
+			handler = entry.handler.get();
+			return Result::FOUND;
+		}
+	}
+	return Result::METHOD_NOT_ALLOWED;
+}
+
+Router::Result Router::lookup(std::string_view method, std::string_view path, RouteMatch& match, HttpHandler*& handler) const
+{
+	match.paramCount = 0;
+	match.wildcard = std::string_view();
+	handler = nullptr;
+	if (path.empty() || path[0] != '/')return Result::NOT_FOUND;
+	path.remove_prefix(1);
+	return find(root_.get(), parseMethod(method), path, match, handler);
+}
+
+Router::Result Router::find(const Node* node, unsigned method, std::string_view rest, RouteMatch& match, HttpHandler*& handler) const
+{
+	if (rest.empty())
+	{
+		Result r = pickHandler(node->handlers, method, handler);
+		if (r != Result::NOT_FOUND)return r;
+		match.wildcard = rest;
+		return pickHandler(node->wildcard, method, handler);
+	}
+
+	Result best = Result::NOT_FOUND;
+	std::string_view seg = firstSegment(rest);
+
+	//̬ӽڵ
+	const auto& children = node->children;
+	auto it = std::lower_bound(children.begin(), children.end(), seg,
+		[](const std::unique_ptr<Node>& child, std::string_view key) {
+			return firstSegment(child->label) < key;
+		});
+	if (it != children.end())
+	{
+		const std::string& label = (*it)->label;
+		if (rest.compare(0, label.size(), label) == 0 && (rest.size() == label.size() || rest[label.size()] == '/'))
+		{
+			std::string_view next = rest.size() == label.size() ? std::string_view() : rest.substr(label.size() + 1);
+			Result r = find(it->get(), method, next, match, handler);
+			if (r == Result::FOUND)return r;
+			if (r == Result::METHOD_NOT_ALLOWED)best = r;
+		}
+	}
+
+	//
+	if (node->paramChild && !seg.empty() && match.paramCount < RouteMatch::MAX_PARAMS)
+	{
+		int saved = match.paramCount;
+		match.params[match.paramCount].name = node->paramName;
+		match.params[match.paramCount].value = seg;
+		match.paramCount++;
+		std::string_view next = seg.size() == rest.size() ? std::string_view() : rest.substr(seg.size() + 1);
+		Result r = find(node->paramChild.get(), method, next, match, handler);
+		if (r == Result::FOUND)return r;
+		if (r == Result::METHOD_NOT_ALLOWED)best = r;
+		match.paramCount = saved;
+	}
+
+	//ͨƥʣȫ·
+	if (!node->wildcard.empty())
+	{
+		match.wildcard = rest;
+		Result r = pickHandler(node->wildcard, method, handler);
+		if (r == Result::FOUND)return r;
+		if (r == Result::METHOD_NOT_ALLOWED)best = r;
+	}
+	return best;
+}
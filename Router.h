@@ -0,0 +1,177 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <stddef.h>
+#include <sys/uio.h>
+
+
+//󷽷,ע·ʱ԰λ
+enum HttpMethod : unsigned
+{
+	METHOD_GET = 1 << 0,
+	METHOD_HEAD = 1 << 1,
+	METHOD_POST = 1 << 2,
+	METHOD_PUT = 1 << 3,
+	METHOD_DELETE = 1 << 4,
+	METHOD_PATCH = 1 << 5,
+	METHOD_OPTIONS = 1 << 6,
+	METHOD_ANY = 0xff
+};
+
+//ѷתΪHttpMethod,ʶķ0
+unsigned parseMethod(std::string_view method);
+
+//һƥĽ,·ָеԭʼ,
+struct RouteMatch
+{
+	static const int MAX_PARAMS = 8;
+
+	struct Param
+	{
+		std::string_view name;
+		std::string_view value;
+	};
+	Param params[MAX_PARAMS];
+	int paramCount = 0;
+	std::string_view wildcard;	//*ƥ䵽ʣ·
+
+	std::string_view param(std::string_view name) const;
+};
+
+//:ֶζָHttpRequestConnectionе,ֻڴڼЧ
+struct RequestView
+{
+	std::string_view method;
+	std::string_view path;		//ѯ,δurl
+	std::string_view query;
+	std::string_view version;
+	std::string_view headers;	//ÿһͷ,\nָ
+	std::string_view body;
+	std::string_view peerIp;
+	const RouteMatch* match = nullptr;
+
+	//ֲͷ(ִСд),ʱؿ
+	std::string_view header(std::string_view name) const;
+	std::string_view param(std::string_view name) const { return match ? match->param(name) : std::string_view(); }
+};
+
+class ResponseHead;
+
+//ͨдӦ,ͷӦϲһη
+class ResponseWriter
+{
+public:
+	explicit ResponseWriter(int fd);
+	//Ӧֱдsocketʱ(HTTP/2)sink,headersΪaddHeaderӵ":ֵ\r\n"
+	using Sink = std::function<bool(int status, std::string_view contentType, std::string_view headers, std::string_view body)>;
+	explicit ResponseWriter(Sink sink);
+
+	void setStatus(int status, const char* reason);
+	void addHeader(std::string_view name, std::string_view value);
+
+	//Ӧ,ֻܵһ
+	bool send(std::string_view body, std::string_view contentType = "text/plain");
+	bool sendJson(std::string_view json) { return send(json, "application/json"); }
+
+	//ʽӦ:δ֪ʱʹ÷ֿ鴫,ͷڵһηʱ
+	//writeܵCHUNK_SIZEΪһ鷢,flushܵ,endͽ;֮ٵsend
+	//sinkģʽ(HTTP/2)Դ֡,ܵendʱһνsink
+	bool begin(std::string_view contentType = "text/plain");
+	bool write(std::string_view data);
+	bool flush();
+	bool end();
+	//HTTP/1.0ͻ˲ʶֿ,رպֱдԭʼ,ԹرӱʾӦ
+	void setChunked(bool chunked) { chunked_ = chunked; }
+	//ͻҪ󱣳ʱͷkeep-alive;ֿʽӦֻԹرӽ
+	void setKeepAlive(bool keepAlive) { keepAlive_ = keepAlive; }
+	//Ӧܷʹ
+	bool keepAlive() const { return keepAlive_ && !failed_ && (chunked_ || !streaming_); }
+
+	bool sent() const { return sent_; }
+	bool streaming() const { return streaming_; }
+	int fd() const { return fd_; }
+	//дsocketֽ(ͷӦ)
+	size_t bytesSent() const { return bytes_; }
+	//socketдʱûд,غɵȡ,socketдʱ
+	bool hasUnsent() const { return !unsent_.empty(); }
+	std::string takeUnsent() { std::string data; data.swap(unsent_); return data; }
+
+	static const size_t CHUNK_SIZE = 16 * 1024;
+
+private:
+	//дȫ,ͻʱʣಿַŽunsent_
+	bool writeAll(struct iovec* iov, int count);
+	//дunsent_,дʱͣ
+	bool drainUnsent();
+	//һ,һηʱͷ,lastΪtrueʱϽ
+	bool sendChunk(std::string_view data, bool last);
+	void statusLine(ResponseHead& head, std::string_view contentType) const;
+
+	int fd_;
+	Sink sink_;
+	int status_;
+	const char* reason_;
+	std::string headers_;
+	bool sent_;
+	size_t bytes_;
+
+	bool streaming_;
+	bool chunked_;
+	bool keepAlive_;
+	bool headSent_;
+	bool ended_;
+	bool failed_;
+	std::string contentType_;
+	std::string pending_;		//ûз͵Ӧ
+	std::string unsent_;		//Ѿɿ鵫socketдʱûд
+};
+
+class HttpHandler
+{
+public:
+	virtual ~HttpHandler() {}
+	virtual void handle(const RequestView& req, ResponseWriter& resp) = 0;
+};
+using HandlerPtr = std::shared_ptr<HttpHandler>;
+using HandlerFunc = std::function<void(const RequestView& req, ResponseWriter& resp)>;
+
+//·ѹǰ׺·
+//ģʽ/ָ,:nameƥһ·,һΪ*ʱƥʣȫ·;̬ڲ,β/
+//·Ӧڷʼǰע,ҹֻڴ,ڶ߳в
+class Router
+{
+public:
+	enum class Result { FOUND, NOT_FOUND, METHOD_NOT_ALLOWED };
+
+	Router();
+	~Router();
+
+	Router(const Router&) = delete;
+	Router& operator=(const Router&) = delete;
+
+	//ע·,ģʽϷ(*󡢲)ʱfalse
+	bool add(unsigned methods, const std::string& pattern, HandlerPtr handler);
+	bool add(unsigned methods, const std::string& pattern, HandlerFunc func);
+
+	//·,pathѯ;ʱ·ȳ
+	Result lookup(std::string_view method, std::string_view path, RouteMatch& match, HttpHandler*& handler) const;
+
+	size_t size() const { return routes_; }
+
+private:
+	struct Node;
+	struct Entry
+	{
+		unsigned methods;
+		HandlerPtr handler;
+	};
+
+	Result find(const Node* node, unsigned method, std::string_view rest, RouteMatch& match, HttpHandler*& handler) const;
+	static Result pickHandler(const std::vector<Entry>& entries, unsigned method, HttpHandler*& handler);
+
+	std::unique_ptr<Node> root_;
+	size_t routes_;
+};
@@ -0,0 +1,196 @@
+#include "SlowLog.h"
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <stdio.h>
+#include <sys/time.h>
+
+SlowLog::SlowLog()
+	: thresholdNs_(0), intervalNs_(60ull * 1000000000ull)
+{
+}
+
+void SlowLog::configure(int thresholdMs, int intervalSec)
+{
+	thresholdNs_.store(thresholdMs > 0 ? static_cast<uint64_t>(thresholdMs) * 1000000ull : 0, std::memory_order_relaxed);
+	intervalNs_.store(static_cast<uint64_t>(intervalSec > 0 ? intervalSec : 1) * 1000000000ull, std::memory_order_relaxed);
+}
+
+uint64_t SlowLog::currentEpoch() const
+{
+	//1ʼ,rankΪ0Ŀղ۲κ
+	return Tracer::nowNs() / intervalNs_.load(std::memory_order_relaxed) + 1;
+}
+
+static uint32_t spanUs(uint64_t start, uint64_t end)
+{
+	if (start == 0 || end < start)return 0;
+	uint64_t us = (end - start) / 1000;
+	return us > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(us);
+}
+
+static void copyField(char* dst, size_t size, const std::string& src)
+{
+	size_t n = std::min(src.size(), size - 1);
+	memcpy(dst, src.data(), n);
+	dst[n] = '\0';
+}
+
+void SlowLog::fill(Entry& e, const RequestTrace& trace, const std::string& method, const std::string& url, uint64_t end)
+{
+	copyField(e.method, sizeof(e.method), method);
+	copyField(e.url, sizeof(e.url), url);
+	uint64_t begin = trace.firstByte != 0 ? trace.firstByte : trace.parsed;
+	uint64_t handlerEnd = trace.sendStart != 0 ? trace.sendStart : trace.lastByte;
+	e.totalUs = spanUs(begin, end);
+	e.readUs = spanUs(trace.firstByte, trace.parsed);
+	e.queueUs = spanUs(trace.enqueue, trace.dequeue);
+	e.dispatchUs = spanUs(trace.dequeue, trace.handlerStart);
+	e.handlerUs = spanUs(trace.handlerStart, handlerEnd);
+	e.sendUs = trace.sendStart != 0 ? spanUs(trace.sendStart, trace.lastByte) : 0;
+	e.rearmUs = spanUs(trace.lastByte, end);
+	e.bytesOut = trace.bytesOut;
+	e.source = trace.source;
+	e.cached = trace.cached;
+	e.queueAtEnqueue = trace.queueDepth;
+	e.workerTid = trace.workerTid;
+
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	e.wallMs = static_cast<int64_t>(tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+}
+
+void SlowLog::capture(const Entry& e)
+{
+	uint64_t epoch = currentEpoch();
+	uint32_t dur = e.totalUs;
+	//һڵļ¼Ϳղ۰ʱ0Ƚ
+	auto score = [epoch](uint64_t rank) -> uint32_t {
+		return (rank >> 32) == epoch ? static_cast<uint32_t>(rank) : 0;
+	};
+
+	for (int attempt = 0; attempt < 4; attempt++)
+	{
+		int victim = -1;
+		uint32_t victimScore = UINT32_MAX;
+		for (int i = 0; i < CAPACITY; i++)
+		{
+			uint32_t s = score(slots_[i].rank.load(std::memory_order_relaxed));
+			if (s < victimScore)
+			{
+				victim = i;
+				victimScore = s;
+			}
+		}
+		//ȱÿһ,־
+		if (victim == -1 || victimScore >= dur)return;
+
+		Slot& slot = slots_[victim];
+		uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+		if ((seq & 1) != 0 || !slot.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire))continue;
+		std::atomic_thread_fence(std::memory_order_release);
+
+		//ȡòλ֮ǰѱ̻߳ɸ
+		if (score(slot.rank.load(std::memory_order_relaxed)) >= dur)
+		{
+			slot.seq.store(seq + 2, std::memory_order_release);
+			continue;
+		}
+		uint64_t words[ENTRY_WORDS] = {};
+		memcpy(words, &e, sizeof(Entry));
+		for (int i = 0; i < ENTRY_WORDS; i++)slot.words[i].store(words[i], std::memory_order_relaxed);
+		slot.rank.store((epoch << 32) | dur, std::memory_order_relaxed);
+		slot.seq.store(seq + 2, std::memory_order_release);
+		captured_++;
+		return;
+	}
+	contended_++;
+}
+
+//JSONַת
+static void appendString(std::string& out, const char* s)
+{
+	out += '"';
+	for (; *s != '\0'; s++)
+	{
+		unsigned char c = static_cast<unsigned char>(*s);
+		if (c == '"' || c == '\\')
+		{
+			out += '\\';
+			out += static_cast<char>(c);
+		}
+		else if (c < 0x20)
+		{
+			char buf[8];
+			snprintf(buf, sizeof(buf), "\\u%04x", c);
+			out += buf;
+		}
+		else
+		{
+			out += static_cast<char>(c);
+		}
+	}
+	out += '"';
+}
+
+std::string SlowLog::json()
+{
+	uint64_t epoch = currentEpoch();
+	std::vector<Entry> entries;
+	for (int i = 0; i < CAPACITY; i++)
+	{
+		Slot& slot = slots_[i];
+		uint32_t before = slot.seq.load(std::memory_order_acquire);
+		if ((before & 1) != 0)continue;
+		uint64_t rank = slot.rank.load(std::memory_order_relaxed);
+		//ǰһڵļ¼
+		if (rank == 0 || (rank >> 32) + 1 < epoch)continue;
+		uint64_t words[ENTRY_WORDS];
+		for (int w = 0; w < ENTRY_WORDS; w++)words[w] = slot.words[w].load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.seq.load(std::memory_order_relaxed) != before)continue;
+		Entry copy;
+		memcpy(&copy, words, sizeof(Entry));
+		entries.push_back(copy);
+	}
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+		return a.totalUs > b.totalUs;
+		});
+
+	std::string json = "{";
+	json += "\"thresholdMs\":" + std::to_string(thresholdNs_.load() / 1000000) + ",";
+	json += "\"intervalSec\":" + std::to_string(intervalNs_.load() / 1000000000) + ",";
+	json += "\"captured\":" + std::to_string(captured_.load()) + ",";
+	json += "\"contended\":" + std::to_string(contended_.load()) + ",";
+	json += "\"requests\":[";
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const Entry& e = entries[i];
+		if (i > 0)json += ",";
+		json += "{\"method\":";
+		appendString(json, e.method);
+		json += ",\"url\":";
+		appendString(json, e.url);
+		json += ",\"time\":" + std::to_string(e.wallMs);
+		json += ",\"totalUs\":" + std::to_string(e.totalUs);
+		json += ",\"stagesUs\":{\"read\":" + std::to_string(e.readUs) +
+			",\"queue\":" + std::to_string(e.queueUs) +
+			",\"dispatch\":" + std::to_string(e.dispatchUs) +
+			",\"handler\":" + std::to_string(e.handlerUs) +
+			",\"send\":" + std::to_string(e.sendUs) +
+			",\"rearm\":" + std::to_string(e.rearmUs) + "}";
+		json += ",\"bytesIn\":" + std::to_string(e.bytesIn);
+		json += ",\"bytesOut\":" + std::to_string(e.bytesOut);
+		json += ",\"source\":";
+		appendString(json, e.source);
+		json += std::string(",\"cached\":") + (e.cached ? "true" : "false");
+		json += ",\"worker\":" + std::to_string(e.workerTid);
+		json += ",\"pool\":{\"queueAtEnqueue\":" + std::to_string(e.queueAtEnqueue) +
+			",\"queueSize\":" + std::to_string(e.queueSize) +
+			",\"busyThreads\":" + std::to_string(e.busyThreads) +
+			",\"liveThreads\":" + std::to_string(e.liveThreads) + "}";
+		json += "}";
+	}
+	json += "]}";
+	return json;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "Trace.h"
+#include <string>
+#include <atomic>
+#include <type_traits>
+#include <stdint.h>
+
+
+//־:һͳCAPACITY
+//·ֻȽһֵ;ֵڹ̶Ĳλ滻ǰһ,λ,дߺͶ߶
+class SlowLog
+{
+public:
+	//һ¼,׶κʱλΪ΢
+	struct Entry
+	{
+		char method[8];
+		char url[120];
+		int64_t bytesIn;
+		int64_t bytesOut;
+		uint32_t totalUs;		//յһֽڵ¼ر
+		uint32_t readUs;
+		uint32_t queueUs;
+		uint32_t dispatchUs;
+		uint32_t handlerUs;
+		uint32_t sendUs;
+		uint32_t rearmUs;
+		uint32_t workerTid;
+		const char* source;
+		bool cached;
+		//̳߳״̬:гȡʱ,ȡԼ¼ʱ
+		int queueAtEnqueue;
+		int queueSize;
+		int busyThreads;
+		int liveThreads;
+		int64_t wallMs;			//¼ʱϵͳʱ
+	};
+
+	SlowLog();
+
+	//thresholdMsΪ0ʱر;intervalSecΪͳ,һڵļ¼𽥱滻
+	void configure(int thresholdMs, int intervalSec);
+	bool enabled() const { return thresholdNs_.load(std::memory_order_relaxed) != 0; }
+
+	//·:durationNsֵʱtrue,д¼capture
+	bool isSlow(uint64_t durationNs) const
+	{
+		uint64_t threshold = thresholdNs_.load(std::memory_order_relaxed);
+		return threshold != 0 && durationNs >= threshold;
+	}
+
+	//ʱд¼еĽ׶κʱURL
+	static void fill(Entry& e, const RequestTrace& trace, const std::string& method, const std::string& url, uint64_t end);
+	void capture(const Entry& e);
+
+	//ʱӴС
+	std::string json();
+
+	static const int CAPACITY = 32;
+
+private:
+	static_assert(std::is_trivially_copyable<Entry>::value, "SlowLog::Entry is copied as raw words");
+	static const int ENTRY_WORDS = (sizeof(Entry) + 7) / 8;
+
+	struct Slot
+	{
+		std::atomic<uint32_t> seq{ 0 };		//ʾд
+		std::atomic<uint64_t> rank{ 0 };	//32λΪڱ,32λΪtotalUs,ҳһ
+		//¼64λֱ,дrelaxedԭӲ:ߺд߲ʱֻ˺ѵֵ(seq鶪),
+		//ݾ;ֱӸEntryʱд߲δΪ
+		std::atomic<uint64_t> words[ENTRY_WORDS] = {};
+	};
+
+	uint64_t currentEpoch() const;
+
+	std::atomic<uint64_t> thresholdNs_;
+	std::atomic<uint64_t> intervalNs_;
+	Slot slots_[CAPACITY];
+
+	std::atomic<long> captured_{ 0 };
+	std::atomic<long> contended_{ 0 };	//߳ͬʱ滻ͬһλ,ļ¼
+};
@@ -1,12 +1,33 @@
 #pragma once 
-#include <queue>
-#include <functional>
-#include <memory>
+#include "RefPtr.h"
+#include <vector>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <cstddef>
+#include <pthread.h>
+#include <time.h>
 
 
 
 using namespace std;
 using callback = void (*)(void* arg);
+
+//ʱӺ,ڼŶʱ
+inline long long monotonicMs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<long long>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+//ʱ,·׷
+inline long long monotonicNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
 //ṹ
 
 //template<class T>
@@ -28,77 +49,269 @@ using callback = void (*)(void* arg);
 //};
 
 
-//ʹstd::functionԣʹlambdaʽ
-template<class T>//TӦstd::shared_ptr<Connection>
+//:std::function<void(void*)>,ɵöֱӷڲĻ,ڴ
+//ֻƶܿ,ݳINLINE_SIZEʱʧ(ӦΪָ)
+class TaskFunction
+{
+public:
+	static const size_t INLINE_SIZE = 48;
+
+	TaskFunction() : invoke_(nullptr), relocate_(nullptr) {}
+	TaskFunction(std::nullptr_t) : invoke_(nullptr), relocate_(nullptr) {}
+
+	template<class F, class Fn = typename std::decay<F>::type,
+		class = typename std::enable_if<!std::is_same<Fn, TaskFunction>::value>::type>
+	TaskFunction(F&& f)
+	{
+		static_assert(sizeof(Fn) <= INLINE_SIZE, "task callable too large for inline storage");
+		static_assert(alignof(Fn) <= alignof(std::max_align_t), "task callable over-aligned");
+		static_assert(std::is_nothrow_move_constructible<Fn>::value, "task callable must be nothrow movable");
+		new (buf_) Fn(std::forward<F>(f));
+		invoke_ = [](void* self, void* arg) {
+			(*static_cast<Fn*>(self))(arg);
+		};
+		relocate_ = [](void* dst, void* src) {
+			Fn* from = static_cast<Fn*>(src);
+			if (dst != nullptr)new (dst) Fn(std::move(*from));
+			from->~Fn();
+		};
+	}
+
+	TaskFunction(TaskFunction&& other) noexcept
+		: invoke_(other.invoke_), relocate_(other.relocate_)
+	{
+		if (relocate_ != nullptr)relocate_(buf_, other.buf_);
+		other.invoke_ = nullptr;
+		other.relocate_ = nullptr;
+	}
+	TaskFunction& operator=(TaskFunction&& other) noexcept
+	{
+		if (this != &other)
+		{
+			destroy();
+			invoke_ = other.invoke_;
+			relocate_ = other.relocate_;
+			if (relocate_ != nullptr)relocate_(buf_, other.buf_);
+			other.invoke_ = nullptr;
+			other.relocate_ = nullptr;
+		}
+		return *this;
+	}
+	TaskFunction(const TaskFunction&) = delete;
+	TaskFunction& operator=(const TaskFunction&) = delete;
+
+	~TaskFunction()
+	{
+		destroy();
+	}
+
+	explicit operator bool() const { return invoke_ != nullptr; }
+	void operator()(void* arg) { invoke_(buf_, arg); }
+
+private:
+	void destroy()
+	{
+		if (relocate_ != nullptr)relocate_(nullptr, buf_);
+		invoke_ = nullptr;
+		relocate_ = nullptr;
+	}
+
+	alignas(std::max_align_t) unsigned char buf_[INLINE_SIZE];
+	void (*invoke_)(void* self, void* arg);
+	void (*relocate_)(void* dst, void* src);	//dstǿʱƶdst,Ȼsrc
+};
+
+//ֻƶ:ӺͳӶ,üֻύʱһΡʱһ
+template<class T>//TǱĶ(Connection),Ҫ̳RefCounted<T>
 struct Task
 {
-	Task():function(nullptr),arg(nullptr){}
-	/*Task(callback f,void* arg):arg(static_cast<T*>(arg)),function(f){}*/
-	
-	//µĹ캯std::function
-	//Task(std::function<void(void*)>f,void* arg):function(f),arg(static_cast<T*>(arg)){}
-
-	Task(std::function<void(void*)> f,std::shared_ptr<T> a):function(f),arg(a){}
-	std::function<void(void*)>function; 
-	std::shared_ptr<T> arg;
+	Task():enqueueMs(0){}
+	Task(TaskFunction f, RefPtr<T> a):function(std::move(f)),arg(std::move(a)),enqueueMs(0){}
+	Task(Task&&) = default;
+	Task& operator=(Task&&) = default;
+	Task(const Task&) = delete;
+	Task& operator=(const Task&) = delete;
+
+	TaskFunction function;
+	RefPtr<T> arg;
+	long long enqueueMs;	//ʱ,ڶŶӹõ
+};
+
+//һȼ:2Ļ,ֻŶʷֵʱ
+//std::queueײdequeÿҪһ¿,ȶӳӶڴ
+template<class T>
+class TaskRing
+{
+public:
+	TaskRing():m_head(0),m_size(0){}
+
+	bool empty() const { return m_size == 0; }
+	size_t size() const { return m_size; }
+	Task<T>& front() { return m_slots[m_head]; }
+
+	void push(Task<T>&& task)
+	{
+		if (m_size == m_slots.size())grow();
+		m_slots[(m_head + m_size) & (m_slots.size() - 1)] = std::move(task);
+		m_size++;
+	}
+	//ȡ,λѱߵĿ
+	Task<T> pop()
+	{
+		Task<T> t = std::move(m_slots[m_head]);
+		m_head = (m_head + 1) & (m_slots.size() - 1);
+		m_size--;
+		return t;
+	}
+
+private:
+	void grow()
+	{
+		size_t cap = m_slots.empty() ? 64 : m_slots.size() * 2;
+		std::vector<Task<T>> slots(cap);
+		for (size_t i = 0; i < m_size; ++i)
+		{
+			slots[i] = std::move(m_slots[(m_head + i) & (m_slots.size() - 1)]);
+		}
+		m_slots.swap(slots);
+		m_head = 0;
+	}
+
+	std::vector<Task<T>> m_slots;
+	size_t m_head;
+	size_t m_size;
+};
+
+//ȼ,ֵԽСԽ
+enum class TaskPriority
+{
+	HIGH = 0,	//ӿڡ
+	NORMAL = 1,	//ͨСļ
+	LOW = 2,	//Ŀ¼бļʽ
 };
+static const int PRIORITY_LEVELS = 3;
 
 template<class T>
 class TaskQueue
 {
 public:
-	TaskQueue()
+	TaskQueue():m_maxSize(0),m_agingMs(DEFAULT_AGING_MS)
 	{
 		pthread_mutex_init(&m_mutex, NULL);
+		for (int i = 0; i < PRIORITY_LEVELS; ++i)
+		{
+			m_waitMs[i] = 0;
+		}
 	}
 	~TaskQueue()
 	{
 		pthread_mutex_destroy(&m_mutex);
 	}
 
-	//
-	void addTask(Task<T> task)
-	{
-		pthread_mutex_lock(&m_mutex);
-		m_taskQ.push(task);
-		pthread_mutex_unlock(&m_mutex);
-	}
-	void addTask(callback f, std::shared_ptr<T> arg)//Ϊ˱һغ
+	//,ʱfalse;depthǿʱдӺĶг,ȡ߳һܿ
+	//ȼܶг,֤ʱܵõӦ
+	bool addTask(Task<T>&& task, TaskPriority priority = TaskPriority::NORMAL, int* depth = nullptr)
 	{
+		int level = static_cast<int>(priority);
+		task.enqueueMs = monotonicMs();
 		pthread_mutex_lock(&m_mutex);
-		Task<T> task;
-		task.function = f;	//ûص
-		task.arg = arg;		//ò
-		m_taskQ.push(task);	//һ
-		m_taskQ.push(Task<T>(f, arg));	//ڶ
+		if (m_maxSize > 0 && priority != TaskPriority::HIGH && sizeLocked() >= m_maxSize)
+		{
+			pthread_mutex_unlock(&m_mutex);
+			return false;
+		}
+		m_taskQ[level].push(std::move(task));
+		if (depth != nullptr)*depth = static_cast<int>(sizeLocked());
 		pthread_mutex_unlock(&m_mutex);
+		return true;
 	}
-
-	//Ӷstd::function֧
-	void addTask(std::function<void(void*)>f, std::shared_ptr<T> arg) {
-		addTask(Task<T>(f, arg));
+	//ָlambdaֱӹڲ
+	template<class F>
+	bool addTask(F&& f, RefPtr<T> arg, TaskPriority priority = TaskPriority::NORMAL) {
+		return addTask(Task<T>(TaskFunction(std::forward<F>(f)), std::move(arg)), priority);
 	}
 
-	//ȡһd
+	//ȡһ
+	//ϸȼϻ:ȼÿȴm_agingMs൱һ,ⱻ
 	Task<T> takeTask()
 	{
 		Task<T> t;
 		pthread_mutex_lock(&m_mutex);
-		if (!m_taskQ.empty())
+		long long now = monotonicMs();
+		int best = -1;
+		long long bestScore = 0;
+		for (int i = 0; i < PRIORITY_LEVELS; ++i)
 		{
-			t = m_taskQ.front();
-			m_taskQ.pop();
+			if (m_taskQ[i].empty())continue;
+			long long waited = now - m_taskQ[i].front().enqueueMs;
+			long long score = static_cast<long long>(i) * m_agingMs - waited;
+			if (best == -1 || score < bestScore)
+			{
+				best = i;
+				bestScore = score;
+			}
+		}
+		if (best != -1)
+		{
+			t = m_taskQ[best].pop();
+			//1/8ȨƽÿһŶʱ
+			long long waited = now - t.enqueueMs;
+			m_waitMs[best] = (m_waitMs[best] * 7 + waited) / 8;
 		}
 		pthread_mutex_unlock(&m_mutex);
 		return t;
 	}
-	//ȡǰĸ
+	//ȡǰĸ;߳ͬʱӳ,ȡҲҪ
+	//̳߳ڳԼʱ,ڴӲȡ̳߳ص,
 	inline size_t taskNumber()
 	{
-		return m_taskQ.size();
+		pthread_mutex_lock(&m_mutex);
+		size_t n = sizeLocked();
+		pthread_mutex_unlock(&m_mutex);
+		return n;
+	}
+
+	//ȡĳһƽŶʱ()
+	void levelStatus(int level, int& size, int& waitMs)
+	{
+		pthread_mutex_lock(&m_mutex);
+		size = static_cast<int>(m_taskQ[level].size());
+		waitMs = static_cast<int>(m_waitMs[level]);
+		pthread_mutex_unlock(&m_mutex);
+	}
+
+	//ö󳤶,0ʾ
+	void setMaxSize(size_t maxSize)
+	{
+		pthread_mutex_lock(&m_mutex);
+		m_maxSize = maxSize;
+		pthread_mutex_unlock(&m_mutex);
+	}
+
+	//ϻʱ,ÿȴagingMs൱һȼ
+	void setAgingMs(int agingMs)
+	{
+		pthread_mutex_lock(&m_mutex);
+		m_agingMs = agingMs > 0 ? agingMs : DEFAULT_AGING_MS;
+		pthread_mutex_unlock(&m_mutex);
 	}
 
 private:
+	size_t sizeLocked()
+	{
+		size_t n = 0;
+		for (int i = 0; i < PRIORITY_LEVELS; ++i)
+		{
+			n += m_taskQ[i].size();
+		}
+		return n;
+	}
+
+	static const int DEFAULT_AGING_MS = 200;
+
 	pthread_mutex_t	m_mutex;
-	queue<Task<T>> m_taskQ;
-};
+	size_t m_maxSize;
+	long long m_agingMs;
+	TaskRing<T> m_taskQ[PRIORITY_LEVELS];
+	long long m_waitMs[PRIORITY_LEVELS];	//ÿһƽŶʱ
+};
\ No newline at end of file
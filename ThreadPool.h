@@ -24,10 +24,14 @@ public:
 		int busyThreads;
 		int queueSize;
 		float loadFactor;
+		long rejectedTasks;	//ܾ
+		long staleTasks;	//Ŷӳʱ
+		int classQueueSize[PRIORITY_LEVELS];	//ÿȼŶ
+		int classWaitMs[PRIORITY_LEVELS];		//ÿȼƽŶʱ()
 	};
 
-	//ڲָ
-	using SmartPtr = std::shared_ptr<T>;
+	//ڲָ:ʽü,ڶƶʱı
+	using SmartPtr = RefPtr<T>;
 
 	//̳߳زҳʼ
 	ThreadPool<T>(int min, int max)
@@ -51,11 +55,15 @@ public:
 				break;
 			}
 			memset(threadIDs, 0, sizeof(pthread_t) * max);
+			capacity = max;
 			minNum = min;
 			maxNum = max;
 			busyNum = 0;
 			liveNum = min;	//С
 			exitNum = 0;
+			maxWaitMs = 0;
+			rejectedNum = 0;
+			staleNum = 0;
 
 			//Իʼ
 			if (pthread_mutex_init(&mutexPool, NULL) != 0 ||
@@ -104,26 +112,55 @@ public:
 		pthread_cond_destroy(&notEmpty);
 	}
 
-	//ɻص
-	void setTaskCallback(std::function<void(std::shared_ptr<T>)> callback) {
+	//ɻص:ڹ߳е,еƽص,ص԰ת߳
+	void setTaskCallback(std::function<void(SmartPtr)> callback) {
 		taskCallback= callback;	//ⲿߵǰִɺ󣬽taskCallbackУԱʹ
 	}
 
-	//̳߳
-	void addTask(std::function<void(void*)>func,SmartPtr arg)
+	//ŶӹñĻص(ڹ߳е,ɻص)
+	void setTaskDropCallback(std::function<void(SmartPtr)> callback) {
+		dropCallback = callback;
+	}
+
+	//ȼϻʱ()
+	void setPriorityAging(int agingMs)
+	{
+		taskQ->setAgingMs(agingMs);
+	}
+
+	//׼:󳤶ȺŶʱ(),0ʾ
+	void setAdmissionLimits(int maxQueue, int maxWait)
+	{
+		taskQ->setMaxSize(maxQueue > 0 ? static_cast<size_t>(maxQueue) : 0);
+		pthread_mutex_lock(&mutexPool);
+		maxWaitMs = maxWait;
+		pthread_mutex_unlock(&mutexPool);
+	}
+
+	//̳߳,̳߳عرջʱfalse,ɵ߸ܾ
+	//queueDepthǿʱдӺĶг(ڶ˳ȡ,)
+	//funcֱӹڲ,argôӵһ·ƶ߳,ıü
+	//falseʱargԭ,Ȼر
+	template<class F>
+	bool addTask(F&& func, SmartPtr&& arg, TaskPriority priority = TaskPriority::NORMAL, int* queueDepth = nullptr)
 	{
-		if (shutdown)return;
+		if (shutdown)return false;
 		
-		//TaskargSmartPtr(st::shared_ptr<T>)
-		Task<T> task;
-		task.function = func;
-		task.arg = arg;//ü
+		Task<T> task(TaskFunction(std::forward<F>(func)), std::move(arg));
 
 		//
-		taskQ->addTask(task);
+		if (!taskQ->addTask(std::move(task), priority, queueDepth))
+		{
+			arg = std::move(task.arg);
+			pthread_mutex_lock(&mutexPool);
+			rejectedNum++;
+			pthread_mutex_unlock(&mutexPool);
+			return false;
+		}
 
 		//ˣڹе߳
 		pthread_cond_signal(&notEmpty);
+		return true;
 	}
 
 	//ȡ̳߳й̵߳ĸ
@@ -144,12 +181,53 @@ public:
 		return liveNum;
 	}
 
-	ThreadPool& operator=(ThreadPool&& other)noexcept {
-		if (this != &other) {
-			//ʵƶ߼
-			//תԴȨ
+	//̳߳thisָ,̳߳ؼȲܿҲƶ,Сʹresize
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	ThreadPool& operator=(ThreadPool&& other) = delete;
+
+	//ڲֹ̳ͣ߳ءŶµ߳Χ
+	void resize(int min, int max)
+	{
+		if (min < 1 || max < min)return;
+
+		pthread_mutex_lock(&mutexPool);
+		//߳IDֻ,˳̵߳ĲλԸ
+		if (max > capacity)
+		{
+			pthread_t* ids = new pthread_t[max];
+			memset(ids, 0, sizeof(pthread_t) * max);
+			memcpy(ids, threadIDs, sizeof(pthread_t) * capacity);
+			delete[]threadIDs;
+			threadIDs = ids;
+			capacity = max;
 		}
-		return *this;
+		minNum = min;
+		maxNum = max;
+
+		//С߳ʱ
+		for (int i = 0; i < capacity && liveNum < minNum; ++i)
+		{
+			if (threadIDs[i] == 0)
+			{
+				pthread_create(&threadIDs[i], NULL, worker, this);
+				liveNum++;
+			}
+		}
+
+		//߳ʱöĿ߳˳
+		int extra = liveNum - maxNum;
+		if (extra > 0)
+		{
+			exitNum = extra;
+		}
+		pthread_mutex_unlock(&mutexPool);
+
+		for (int i = 0; i < extra; ++i)
+		{
+			pthread_cond_signal(&notEmpty);
+		}
+		cout << "̳߳ص:min=" << min << ",max=" << max << endl;
 	}
 
 	//ȡ̳߳״̬,Ӧⲿ̳߳صǰ״̬
@@ -162,7 +240,13 @@ public:
 		status.busyThreads = busyNum;
 		status.queueSize = static_cast<int>(taskQ->taskNumber());
 		status.loadFactor = liveNum > 0 ? static_cast<float>(busyNum) / static_cast<float>(liveNum) : 0.0f;
+		status.rejectedTasks = rejectedNum;
+		status.staleTasks = staleNum;
 		pthread_mutex_unlock(&mutexPool);
+		for (int i = 0; i < PRIORITY_LEVELS; ++i)
+		{
+			taskQ->levelStatus(i, status.classQueueSize[i], status.classWaitMs[i]);
+		}
 		return status;
 	}
 
@@ -183,7 +267,15 @@ public:
 	{
 		taskCallback = nullptr;
 	}
+
+	//ǰִ߳еӶȡʱ(),Ϳʼִ֮Ĳǵȿ
+	static long long dequeueNs()
+	{
+		return dequeueNs_;
+	}
 private: 
+	static inline thread_local long long dequeueNs_ = 0;
+
 	//ص - ʹָ
 	std::function<void(SmartPtr)> taskCallback;
 
@@ -229,6 +321,19 @@ private:
 
 			//ȡһ
 			auto task = pool->taskQ->takeTask();
+			dequeueNs_ = monotonicNs();
+
+			//ŶʱѾ޵,ͻ˴Ѿ,ֱӶִ
+			if (pool->maxWaitMs > 0 && task.arg &&
+				monotonicMs() - task.enqueueMs > pool->maxWaitMs)
+			{
+				pool->staleNum++;
+				pthread_mutex_unlock(&pool->mutexPool);
+				if (pool->dropCallback) {
+					pool->dropCallback(std::move(task.arg));
+				}
+				continue;
+			}
 
 			//æµ̼߳
 			pool->busyNum++;
@@ -240,9 +345,9 @@ private:
 			cout << "thread" << to_string(pthread_self()) << "start working..." << endl;
 			pthread_mutex_unlock(&pool->mutexOutput);
 
-			// ִtask.arg  SmartPtr ( std::shared_ptr<T>)
-			// task.function ǩӦΪ void(*)(void*)Ҫ get() õԭʼָ
-			// Ҫע⣬task.arg ָ뱣ִ֤ڼЧ
+			// ִtask.arg  SmartPtr ( RefPtr<T>)
+			// task.function ǩΪ void(void*)Ҫ get() õԭʼָ
+			// task.arg ִڼЧ֮ƽɻص
 			if (task.function && task.arg)
 			{
 				task.function(task.arg.get());//ԭʼָ
@@ -250,7 +355,7 @@ private:
 
 			//ӻص----ɺ֪ͨ
 			if (pool->taskCallback && task.arg) {
-				pool->taskCallback(task.arg);//ֱӴSmartPtr
+				pool->taskCallback(std::move(task.arg));//ƽ,ıü
 			}
 
 			//̴߳ӳɹ
@@ -287,7 +392,7 @@ private:
 				//ִ߼
 				pthread_mutex_lock(&pool->mutexPool);
 				int counter = 0;
-				for (int i = 0; i < pool->maxNum && counter < NUMBER && pool->liveNum < pool->maxNum; ++i)
+				for (int i = 0; i < pool->capacity && counter < NUMBER && pool->liveNum < pool->maxNum; ++i)
 				{
 					if (pool->threadIDs[i] == 0)
 					{
@@ -332,7 +437,7 @@ private:
 			{
 				pthread_mutex_lock(&pool->mutexPool);
 				int counter = 0;
-				for (int i = 0; i < pool->maxNum && counter < NUMBER && pool->liveNum < pool->maxNum; ++i)
+				for (int i = 0; i < pool->capacity && counter < NUMBER && pool->liveNum < pool->maxNum; ++i)
 				{
 					if (pool->threadIDs[i] == 0)
 					{
@@ -364,7 +469,9 @@ private:
 	void threadExit()
 	{
 		pthread_t tid = pthread_self();
-		for (int i = 0; i < maxNum; ++i)
+		//resize滻threadIDs,Ҫ
+		pthread_mutex_lock(&mutexPool);
+		for (int i = 0; i < capacity; ++i)
 		{
 			if (threadIDs[i] == tid)
 			{
@@ -373,6 +480,7 @@ private:
 				break;
 			}
 		}
+		pthread_mutex_unlock(&mutexPool);
 		pthread_exit(NULL);
 	}
 
@@ -446,6 +554,7 @@ private:
 	int liveNum;			//̸߳
 	int minNum;				//С߳
 	int maxNum;				//߳
+	int capacity;			//threadIDsĳ,resizemaxʱ
 	int exitNum;			//Ҫٵ̸߳
 
 	//̬
@@ -454,8 +563,11 @@ private:
 	time_t lastShrinkTime;		  //ϴʱ
 	const int SHRINK_COOLDOWN = 10;	//ȴʱ()
 
-	//ɻص
-	std::function<void(SmartPtr)> taskCallback;
+	//׼
+	int maxWaitMs;			//Ŷʱ(),0ʾ
+	long rejectedNum;		//ܾ
+	long staleNum;			//Ŷӳʱ
+	std::function<void(SmartPtr)> dropCallback;
 
 	pthread_mutex_t mutexPool;	//̳߳صĻ߳
 	pthread_mutex_t mutexOutput;	//߳˳ʱϵһֹ߳˳ʱԻ
@@ -0,0 +1,337 @@
+#include "Throttle.h"
+#include <sstream>
+#include <algorithm>
+#include <map>
+#include <time.h>
+#include <stdlib.h>
+#include <errno.h>
+
+static bool parseKb(const std::string& value, long long minValue, uint64_t& bytesPerSec)
+{
+	char* end = nullptr;
+	errno = 0;
+	long long v = strtoll(value.c_str(), &end, 10);
+	if (errno != 0 || end == value.c_str() || *end != '\0' || v < minValue || v > 0x7fffffff)return false;
+	bytesPerSec = static_cast<uint64_t>(v) * 1024;
+	return true;
+}
+
+static bool parseRule(const std::string& spec, std::string& prefix, uint64_t& rate, std::string& className, std::string& error)
+{
+	std::istringstream in(spec);
+	std::string kb, extra;
+	in >> prefix >> kb >> className;
+	if (prefix.empty() || prefix[0] != '/' || kb.empty() || (in >> extra) || !parseKb(kb, 0, rate))
+	{
+		error = "throttle must be \"prefix KB/s [class]\": " + spec;
+		return false;
+	}
+	if (rate == 0 && className.empty())
+	{
+		error = "throttle without a class needs a rate: " + spec;
+		return false;
+	}
+	return true;
+}
+
+static bool parseClass(const std::string& spec, std::string& name, uint64_t& rate, std::string& error)
+{
+	std::istringstream in(spec);
+	std::string kb, extra;
+	in >> name >> kb;
+	if (name.empty() || kb.empty() || (in >> extra) || !parseKb(kb, 1, rate))
+	{
+		error = "throttle_class must be \"name KB/s\": " + spec;
+		return false;
+	}
+	return true;
+}
+
+uint64_t Throttle::nowNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+Throttle::Bucket::Bucket(uint64_t rate)
+	: rate_(rate), lastNs_(nowNs())
+{
+	capacity_ = std::max<double>(static_cast<double>(rate) / RATE_WINDOW_DIV, MIN_QUANTUM);
+	tokens_ = capacity_;
+}
+
+void Throttle::Bucket::refill(uint64_t nowNs)
+{
+	if (nowNs <= lastNs_)return;
+	tokens_ = std::min(capacity_, tokens_ + static_cast<double>(rate_) * (nowNs - lastNs_) / 1e9);
+	lastNs_ = nowNs;
+}
+
+size_t Throttle::Bucket::take(size_t want, uint64_t nowNs)
+{
+	refill(nowNs);
+	size_t got = tokens_ > 0 ? static_cast<size_t>(std::min<double>(tokens_, static_cast<double>(want))) : 0;
+	tokens_ -= static_cast<double>(got);
+	return got;
+}
+
+void Throttle::Bucket::refund(size_t n)
+{
+	tokens_ = std::min(capacity_, tokens_ + static_cast<double>(n));
+}
+
+uint64_t Throttle::Bucket::waitNs(size_t need, uint64_t nowNs)
+{
+	refill(nowNs);
+	double target = std::min(capacity_, static_cast<double>(need));
+	if (tokens_ >= target)return 0;
+	return static_cast<uint64_t>((target - tokens_) * 1e9 / static_cast<double>(rate_)) + 1;
+}
+
+Throttle::Meter::Meter()
+	: windowStart_(nowNs()), windowBytes_(0), lastRate_(0), total_(0)
+{
+	pthread_mutex_init(&mutex_, NULL);
+}
+
+Throttle::Meter::~Meter()
+{
+	pthread_mutex_destroy(&mutex_);
+}
+
+void Throttle::Meter::add(size_t bytes, uint64_t nowNs)
+{
+	total_.fetch_add(bytes, std::memory_order_relaxed);
+	pthread_mutex_lock(&mutex_);
+	if (nowNs - windowStart_ >= 1000000000ull)
+	{
+		lastRate_ = windowBytes_ * 1000000000ull / (nowNs - windowStart_);
+		windowStart_ = nowNs;
+		windowBytes_ = 0;
+	}
+	windowBytes_ += bytes;
+	pthread_mutex_unlock(&mutex_);
+}
+
+uint64_t Throttle::Meter::rate(uint64_t nowNs)
+{
+	pthread_mutex_lock(&mutex_);
+	uint64_t rate = lastRate_;
+	//һûз,һڵѾܴ
+	if (nowNs - windowStart_ >= 2000000000ull)rate = windowBytes_ * 1000000000ull / (nowNs - windowStart_);
+	pthread_mutex_unlock(&mutex_);
+	return rate;
+}
+
+Throttle::Class::Class(const std::string& n, uint64_t rate)
+	: name(n), bucket(rate), active(0)
+{
+	pthread_mutex_init(&mutex, NULL);
+}
+
+Throttle::Class::~Class()
+{
+	pthread_mutex_destroy(&mutex);
+}
+
+Throttle::Pacer::Pacer(const RulePtr& rule)
+	: rule_(rule)
+{
+	if (rule_->connRate > 0)conn_.reset(new Bucket(rule_->connRate));
+	rule_->active++;
+	if (rule_->cls)rule_->cls->active++;
+}
+
+Throttle::Pacer::~Pacer()
+{
+	rule_->active--;
+	if (rule_->cls)rule_->cls->active--;
+}
+
+size_t Throttle::Pacer::acquire(size_t want)
+{
+	uint64_t now = nowNs();
+	size_t got = conn_ ? conn_->take(want, now) : want;
+	Class* cls = rule_->cls.get();
+	if (got > 0 && cls != nullptr)
+	{
+		pthread_mutex_lock(&cls->mutex);
+		size_t shared = cls->bucket.take(got, now);
+		pthread_mutex_unlock(&cls->mutex);
+		if (conn_ && shared < got)conn_->refund(got - shared);
+		got = shared;
+	}
+	return got;
+}
+
+void Throttle::Pacer::refund(size_t n)
+{
+	if (n == 0)return;
+	if (conn_)conn_->refund(n);
+	Class* cls = rule_->cls.get();
+	if (cls != nullptr)
+	{
+		pthread_mutex_lock(&cls->mutex);
+		cls->bucket.refund(n);
+		pthread_mutex_unlock(&cls->mutex);
+	}
+}
+
+void Throttle::Pacer::sent(size_t n)
+{
+	if (n == 0)return;
+	uint64_t now = nowNs();
+	rule_->meter.add(n, now);
+	if (rule_->cls)rule_->cls->meter.add(n, now);
+}
+
+long long Throttle::Pacer::delayMs()
+{
+	uint64_t now = nowNs();
+	uint64_t wait = conn_ ? conn_->waitNs(MIN_QUANTUM, now) : 0;
+	Class* cls = rule_->cls.get();
+	if (cls != nullptr)
+	{
+		pthread_mutex_lock(&cls->mutex);
+		wait = std::max(wait, cls->bucket.waitNs(MIN_QUANTUM, now));
+		pthread_mutex_unlock(&cls->mutex);
+	}
+	return static_cast<long long>((wait + 999999) / 1000000);
+}
+
+Throttle::Throttle()
+	: connKb_(0)
+{
+	pthread_mutex_init(&mutex_, NULL);
+}
+
+bool Throttle::checkRule(const std::string& spec, std::string& error)
+{
+	std::string prefix, className;
+	uint64_t rate;
+	return parseRule(spec, prefix, rate, className, error);
+}
+
+bool Throttle::checkClass(const std::string& spec, std::string& error)
+{
+	std::string name;
+	uint64_t rate;
+	return parseClass(spec, name, rate, error);
+}
+
+bool Throttle::configure(int connKb, const std::vector<std::string>& rules, const std::vector<std::string>& classes, std::string& error)
+{
+	std::map<std::string, ClassPtr> existing;
+	pthread_mutex_lock(&mutex_);
+	for (auto& cls : classes_)existing[cls->name] = cls;
+	pthread_mutex_unlock(&mutex_);
+
+	//ͬʲԭͰ,ٵӺͳƲ¼Ӱ
+	std::map<std::string, ClassPtr> byName;
+	std::vector<ClassPtr> nextClasses;
+	for (auto& spec : classes)
+	{
+		std::string name;
+		uint64_t rate;
+		if (!parseClass(spec, name, rate, error))return false;
+		if (byName.count(name) > 0)
+		{
+			error = "duplicate throttle_class " + name;
+			return false;
+		}
+		auto it = existing.find(name);
+		ClassPtr cls = it != existing.end() && it->second->bucket.rate() == rate ? it->second : std::make_shared<Class>(name, rate);
+		byName[name] = cls;
+		nextClasses.push_back(cls);
+	}
+
+	std::vector<RulePtr> nextRules;
+	for (auto& spec : rules)
+	{
+		RulePtr rule = std::make_shared<Rule>();
+		std::string className;
+		if (!parseRule(spec, rule->prefix, rule->connRate, className, error))return false;
+		if (!className.empty())
+		{
+			auto it = byName.find(className);
+			if (it == byName.end())
+			{
+				error = "unknown throttle_class " + className;
+				return false;
+			}
+			rule->cls = it->second;
+		}
+		nextRules.push_back(rule);
+	}
+	std::stable_sort(nextRules.begin(), nextRules.end(), [](const RulePtr& a, const RulePtr& b) {
+		return a->prefix.size() > b->prefix.size();
+		});
+	if (connKb > 0)
+	{
+		RulePtr fallback = std::make_shared<Rule>();
+		fallback->connRate = static_cast<uint64_t>(connKb) * 1024;
+		nextRules.push_back(fallback);
+	}
+
+	pthread_mutex_lock(&mutex_);
+	rules_.swap(nextRules);
+	classes_.swap(nextClasses);
+	connKb_ = connKb;
+	pthread_mutex_unlock(&mutex_);
+	return true;
+}
+
+Throttle::PacerPtr Throttle::match(std::string_view url)
+{
+	RulePtr found;
+	pthread_mutex_lock(&mutex_);
+	for (auto& rule : rules_)
+	{
+		if (url.compare(0, rule->prefix.size(), rule->prefix) == 0)
+		{
+			found = rule;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&mutex_);
+	if (!found)return PacerPtr();
+	return PacerPtr(new Pacer(found));
+}
+
+std::string Throttle::statsJson()
+{
+	std::vector<RulePtr> rules;
+	std::vector<ClassPtr> classes;
+	pthread_mutex_lock(&mutex_);
+	rules = rules_;
+	classes = classes_;
+	int connKb = connKb_;
+	pthread_mutex_unlock(&mutex_);
+
+	//ʵλΪֽ/,rateΪõ,actualΪ1ʵ
+	uint64_t now = nowNs();
+	std::string json = "{\"connKb\":" + std::to_string(connKb) + ",\"rules\":[";
+	for (size_t i = 0; i < rules.size(); i++)
+	{
+		Rule& rule = *rules[i];
+		if (i > 0)json += ",";
+		json += "{\"prefix\":\"" + rule.prefix + "\",\"class\":\"" + (rule.cls ? rule.cls->name : std::string()) +
+			"\",\"connRate\":" + std::to_string(rule.connRate) +
+			",\"active\":" + std::to_string(rule.active.load()) +
+			",\"bytes\":" + std::to_string(rule.meter.total()) +
+			",\"actual\":" + std::to_string(rule.meter.rate(now)) + "}";
+	}
+	json += "],\"classes\":[";
+	for (size_t i = 0; i < classes.size(); i++)
+	{
+		Class& cls = *classes[i];
+		if (i > 0)json += ",";
+		json += "{\"name\":\"" + cls.name + "\",\"rate\":" + std::to_string(cls.bucket.rate()) +
+			",\"active\":" + std::to_string(cls.active.load()) +
+			",\"bytes\":" + std::to_string(cls.meter.total()) +
+			",\"actual\":" + std::to_string(cls.meter.rate(now)) + "}";
+	}
+	json += "]}";
+	return json;
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+
+//:URLǰ׺ÿһͰ,·ɿһ,ͬٹһʵͰ
+//ڷÿһƬ֮ǰ;ûʱreactorĶʱ㹻ʱύ,ù߳˯ߵȴ
+class Throttle
+{
+public:
+	//Ͱ,Ϊֽ/,ΪRATE_WINDOW_DIV֮һ,MIN_QUANTUM,ʼʱ
+	class Bucket
+	{
+	public:
+		explicit Bucket(uint64_t rate);
+		uint64_t rate() const { return rate_; }
+		//ƺȡwant
+		size_t take(size_t want, uint64_t nowNs);
+		void refund(size_t n);
+		//ƴﵽneed()Ҫȴ
+		uint64_t waitNs(size_t need, uint64_t nowNs);
+
+	private:
+		void refill(uint64_t nowNs);
+
+		uint64_t rate_;
+		double capacity_;
+		double tokens_;
+		uint64_t lastNs_;
+	};
+
+	//ʵ:1Ĵͳ
+	class Meter
+	{
+	public:
+		Meter();
+		~Meter();
+		void add(size_t bytes, uint64_t nowNs);
+		uint64_t total() const { return total_.load(std::memory_order_relaxed); }
+		uint64_t rate(uint64_t nowNs);
+
+	private:
+		pthread_mutex_t mutex_;
+		uint64_t windowStart_;
+		uint64_t windowBytes_;
+		uint64_t lastRate_;
+		std::atomic<uint64_t> total_;
+	};
+
+	struct Class
+	{
+		std::string name;
+		pthread_mutex_t mutex;		//bucket,ͬڲͬĹ߳з
+		Bucket bucket;
+		Meter meter;
+		std::atomic<int> active;
+
+		Class(const std::string& n, uint64_t rate);
+		~Class();
+	};
+	using ClassPtr = std::shared_ptr<Class>;
+
+	struct Rule
+	{
+		std::string prefix;		//ձʾthrottle_conn_kbõĬ
+		uint64_t connRate;		//ÿӵ,0ʾֻ
+		ClassPtr cls;
+		Meter meter;
+		std::atomic<int> active;
+
+		Rule() : connRate(0), active(0) {}
+	};
+	using RulePtr = std::shared_ptr<Rule>;
+
+	//һӦ״̬,Ӧʱͷ
+	class Pacer
+	{
+	public:
+		explicit Pacer(const RulePtr& rule);
+		~Pacer();
+		Pacer(const Pacer&) = delete;
+		Pacer& operator=(const Pacer&) = delete;
+
+		//wantֽڵ,صõֽ
+		size_t acquire(size_t want);
+		//ûõƻȥ
+		void refund(size_t n);
+		//¼ʵʷ͵ֽ
+		void sent(size_t n);
+		//һܵõMIN_QUANTUMֽڵƻҪȴĺ
+		long long delayMs();
+
+	private:
+		RulePtr rule_;
+		std::unique_ptr<Bucket> conn_;
+	};
+	using PacerPtr = std::unique_ptr<Pacer>;
+
+	Throttle();
+	Throttle(const Throttle&) = delete;
+	Throttle& operator=(const Throttle&) = delete;
+
+	//"ǰ׺ ÿKB/s []"
+	static bool checkRule(const std::string& spec, std::string& error);
+	//" KB/s"
+	static bool checkClass(const std::string& spec, std::string& error);
+
+	//滻,connKbΪƥκιӵĬ,0ʾ;ʧʱԭй
+	//ͬԭͰͳ
+	bool configure(int connKb, const std::vector<std::string>& rules, const std::vector<std::string>& classes, std::string& error);
+
+	//URLҵ,ʱؿ
+	PacerPtr match(std::string_view url);
+
+	std::string statsJson();
+
+	static const size_t MIN_QUANTUM = 16 * 1024;
+	static const int RATE_WINDOW_DIV = 4;
+
+	static uint64_t nowNs();
+
+private:
+	pthread_mutex_t mutex_;
+	std::vector<RulePtr> rules_;	//ǰ׺ȴӳ,ĬϹ
+	std::vector<ClassPtr> classes_;
+	int connKb_;
+};
@@ -0,0 +1,348 @@
+#include "TlsTerminator.h"
+#include <openssl/err.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <iostream>
+
+static std::string opensslError()
+{
+	char msg[256];
+	unsigned long code = ERR_get_error();
+	if (code == 0)return "unknown error";
+	ERR_error_string_n(code, msg, sizeof(msg));
+	ERR_clear_error();
+	return msg;
+}
+
+TlsTerminator::TlsTerminator()
+	: ctx_(nullptr), epollFd_(-1), buf_(RELAY_CHUNK), handshaking_(0), http2_(false)
+{
+}
+
+TlsTerminator::~TlsTerminator()
+{
+	//ÿỰmapгһ,ռͷ
+	std::vector<Session*> all;
+	for (auto& pair : sessions_)
+	{
+		if (pair.first == pair.second->tcpFd)all.push_back(pair.second);
+	}
+	for (Session* s : all)
+	{
+		destroy(s);
+	}
+	if (ctx_ != nullptr)SSL_CTX_free(ctx_);
+}
+
+bool TlsTerminator::init(const std::string& certFile, const std::string& keyFile, std::string& error)
+{
+	SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+	if (ctx == nullptr)
+	{
+		error = opensslError();
+		return false;
+	}
+	SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+
+	//ʱOpenSSLTCP_ULP "tls"дỰԿ,֧ʱĬ
+	SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+	//м÷д,д,ʱַԱ仯
+	SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+	SSL_CTX_set_alpn_select_cb(ctx, selectAlpn, this);
+
+	if (SSL_CTX_use_certificate_chain_file(ctx, certFile.c_str()) != 1 ||
+		SSL_CTX_use_PrivateKey_file(ctx, keyFile.c_str(), SSL_FILETYPE_PEM) != 1 ||
+		SSL_CTX_check_private_key(ctx) != 1)
+	{
+		error = opensslError();
+		SSL_CTX_free(ctx);
+		return false;
+	}
+
+	if (ctx_ != nullptr)SSL_CTX_free(ctx_);
+	ctx_ = ctx;
+	return true;
+}
+
+int TlsTerminator::selectAlpn(SSL* ssl, const unsigned char** out, unsigned char* outLen,
+	const unsigned char* in, unsigned int inLen, void* arg)
+{
+	(void)ssl;
+	//˵˳ѡh2,ͻ˶֧ʱӦALPN,ճ
+	static const unsigned char BOTH[] = "\x02h2\x08http/1.1";
+	static const unsigned char HTTP1[] = "\x08http/1.1";
+	TlsTerminator* self = static_cast<TlsTerminator*>(arg);
+	const unsigned char* server = self->http2_ ? BOTH : HTTP1;
+	unsigned int serverLen = self->http2_ ? sizeof(BOTH) - 1 : sizeof(HTTP1) - 1;
+	unsigned char* selected = nullptr;
+	if (SSL_select_next_proto(&selected, outLen, server, serverLen, in, inLen) != OPENSSL_NPN_NEGOTIATED)
+	{
+		return SSL_TLSEXT_ERR_NOACK;
+	}
+	*out = selected;
+	return SSL_TLSEXT_ERR_OK;
+}
+
+bool TlsTerminator::watch(int fd)
+{
+	//˶ñشͬʱעд,һһͣʱ,һ˵¼
+	struct epoll_event ev = {};
+	ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+	ev.data.fd = fd;
+	if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) == -1)
+	{
+		perror("epoll_ctl:tls");
+		return false;
+	}
+	return true;
+}
+
+void TlsTerminator::start(int fd, const struct sockaddr_in& addr)
+{
+	SSL* ssl = SSL_new(ctx_);
+	if (ssl == nullptr || SSL_set_fd(ssl, fd) != 1)
+	{
+		std::cout << "TLSỰʧ:" << opensslError() << std::endl;
+		if (ssl != nullptr)SSL_free(ssl);
+		close(fd);
+		return;
+	}
+	SSL_set_accept_state(ssl);
+
+	Session* s = new Session;
+	s->tcpFd = fd;
+	s->ssl = ssl;
+	s->addr = addr;
+	sessions_[fd] = s;
+	handshaking_++;
+	if (!watch(fd))
+	{
+		destroy(s);
+		return;
+	}
+	handshake(s);
+}
+
+bool TlsTerminator::handleEvent(int fd)
+{
+	auto it = sessions_.find(fd);
+	if (it == sessions_.end())return false;
+
+	Session* s = it->second;
+	if (s->plainFd == -1)
+	{
+		handshake(s);
+	}
+	else
+	{
+		pump(s);
+	}
+	return true;
+}
+
+void TlsTerminator::handshake(Session* s)
+{
+	ERR_clear_error();
+	int ret = SSL_do_handshake(s->ssl);
+	if (ret == 1)
+	{
+		finishHandshake(s);
+		return;
+	}
+	int err = SSL_get_error(s->ssl, ret);
+	if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE)return;//ȴһ¼
+
+	handshakeFailures_++;
+	ERR_clear_error();
+	destroy(s);
+}
+
+void TlsTerminator::finishHandshake(Session* s)
+{
+	handshakes_++;
+	s->handshaking = false;
+	handshaking_--;
+	bool ktlsSend = BIO_get_ktls_send(SSL_get_wbio(s->ssl)) != 0;
+	bool ktlsRecv = BIO_get_ktls_recv(SSL_get_rbio(s->ssl)) != 0;
+
+	if (ktlsSend)
+	{
+		//ں˸,socketֱӽHttpServer,epollƳɶԷEPOLLONESHOTע
+		epoll_ctl(epollFd_, EPOLL_CTL_DEL, s->tcpFd, NULL);
+		sessions_.erase(s->tcpFd);
+		SSL* ssl = s->ssl;
+		if (ktlsRecv)
+		{
+			//SSL_freeرsocket,Ҳᷢκ
+			SSL_free(ssl);
+			ssl = nullptr;
+			ktlsFull_++;
+		}
+		else
+		{
+			ktlsSend_++;
+		}
+		int fd = s->tcpFd;
+		struct sockaddr_in addr = s->addr;
+		delete s;
+		ready_(fd, ssl, addr);
+		return;
+	}
+
+	//û̬:HttpServerõsocketpairһ,ͨһд
+	int sv[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) == -1)
+	{
+		perror("socketpair:tls");
+		destroy(s);
+		return;
+	}
+	s->plainFd = sv[0];
+	sessions_[sv[0]] = s;
+	if (!watch(sv[0]))
+	{
+		close(sv[1]);
+		destroy(s);
+		return;
+	}
+	userspace_++;
+	ready_(sv[1], nullptr, s->addr);
+	pump(s);
+}
+
+void TlsTerminator::pump(Session* s)
+{
+	char* buf = buf_.data();
+	bool fatal = false;
+
+	//TLS -> :дϴʣµ,ٽܵsocketpairдȥsocketûΪֹ
+	for (;;)
+	{
+		if (!s->toPlain.empty())
+		{
+			ssize_t w = send(s->plainFd, s->toPlain.data(), s->toPlain.size(), MSG_NOSIGNAL);
+			if (w < 0)
+			{
+				if (errno == EINTR)continue;
+				if (errno != EAGAIN && errno != EWOULDBLOCK)
+				{
+					//HttpServerѹرһ,ֻ֮ܵȵĶ˵EOF
+					s->toPlain.clear();
+					s->tlsEof = true;
+				}
+				break;
+			}
+			s->toPlain.erase(0, w);
+			if (!s->toPlain.empty())break;
+		}
+		if (s->tlsEof)break;
+
+		ERR_clear_error();
+		int n = SSL_read(s->ssl, buf, static_cast<int>(buf_.size()));
+		if (n > 0)
+		{
+			s->toPlain.assign(buf, n);
+			continue;
+		}
+		int err = SSL_get_error(s->ssl, n);
+		if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE)break;
+		//close_notifyӳ,ͻ˲ٷ
+		s->tlsEof = true;
+		ERR_clear_error();
+		break;
+	}
+	//ͻ˵ݶHttpServerٹرд,EOF
+	if (s->tlsEof && s->toPlain.empty() && !s->plainShut)
+	{
+		shutdown(s->plainFd, SHUT_WR);
+		s->plainShut = true;
+	}
+
+	// -> TLS
+	for (;;)
+	{
+		if (!s->toTls.empty())
+		{
+			ERR_clear_error();
+			int n = SSL_write(s->ssl, s->toTls.data(), static_cast<int>(s->toTls.size()));
+			if (n > 0)
+			{
+				relayed_ += n;
+				s->toTls.erase(0, n);
+				continue;
+			}
+			int err = SSL_get_error(s->ssl, n);
+			if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE)break;
+			fatal = true;
+			ERR_clear_error();
+			break;
+		}
+		if (s->plainEof)break;
+
+		ssize_t n = recv(s->plainFd, buf, buf_.size(), 0);
+		if (n > 0)
+		{
+			s->toTls.assign(buf, n);
+			continue;
+		}
+		if (n < 0 && errno == EINTR)continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))break;
+		s->plainEof = true;
+		break;
+	}
+
+	//HttpServerرӦȫỰ;ͻ˶Ͽʱдʧͬ
+	if (fatal || (s->plainEof && s->toTls.empty()))
+	{
+		if (!fatal)SSL_shutdown(s->ssl);
+		destroy(s);
+	}
+}
+
+void TlsTerminator::destroy(Session* s)
+{
+	if (s->handshaking)handshaking_--;
+	sessions_.erase(s->tcpFd);
+	close(s->tcpFd);
+	if (s->plainFd != -1)
+	{
+		sessions_.erase(s->plainFd);
+		close(s->plainFd);
+	}
+	SSL_free(s->ssl);
+	delete s;
+}
+
+ssize_t TlsTerminator::read(SSL* ssl, char* buf, size_t len)
+{
+	ERR_clear_error();
+	int n = SSL_read(ssl, buf, static_cast<int>(len));
+	if (n > 0)return n;
+	int err = SSL_get_error(ssl, n);
+	if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE)
+	{
+		errno = EAGAIN;
+		return -1;
+	}
+	ERR_clear_error();
+	if (err == SSL_ERROR_ZERO_RETURN)return 0;
+	if (err != SSL_ERROR_SYSCALL || errno == 0)errno = ECONNRESET;
+	return -1;
+}
+
+std::string TlsTerminator::statsJson()
+{
+	std::string json = "{";
+	json += "\"enabled\":" + std::string(enabled() ? "true" : "false") + ",";
+	json += "\"handshakes\":" + std::to_string(handshakes_.load()) + ",";
+	json += "\"handshakeFailures\":" + std::to_string(handshakeFailures_.load()) + ",";
+	json += "\"ktlsFull\":" + std::to_string(ktlsFull_.load()) + ",";
+	json += "\"ktlsSendOnly\":" + std::to_string(ktlsSend_.load()) + ",";
+	json += "\"userspace\":" + std::to_string(userspace_.load()) + ",";
+	json += "\"relayedBytes\":" + std::to_string(relayed_.load());
+	json += "}";
+	return json;
+}
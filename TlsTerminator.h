@@ -0,0 +1,92 @@
+#pragma once
+#include <string>
+#include <map>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <netinet/in.h>
+#include <sys/types.h>
+#include <openssl/ssl.h>
+
+
+//HTTPS˿ϵTLSս,reactorԷʽ
+//ɺѻỰԿں(kTLS),֮ݰַʽHttpServer:
+//  1.ͺͽնں˼ӽ:ֱӽsocket,sendfile㿽·Ӱ
+//  2.ֻзͷں˼:socketSSL,ȡʱTlsTerminator::read
+//  3.ں˲֧kTLS:reactorsocketpairû̬м,HttpServerõĵһ
+class TlsTerminator
+{
+public:
+	//ɺĻص,fdssl(Ϊ)Ȩص
+	using ReadyCallback = std::function<void(int fd, SSL* ssl, const struct sockaddr_in& addr)>;
+
+	TlsTerminator();
+	~TlsTerminator();
+
+	TlsTerminator(const TlsTerminator&) = delete;
+	TlsTerminator& operator=(const TlsTerminator&) = delete;
+
+	//֤˽Կ,ʧʱerrorΪOpenSSLĴϢ
+	bool init(const std::string& certFile, const std::string& keyFile, std::string& error);
+	bool enabled() const { return ctx_ != nullptr; }
+
+	void setEpoll(int epollFd) { epollFd_ = epollFd; }
+	void setReadyCallback(ReadyCallback cb) { ready_ = std::move(cb); }
+	//ALPNǷṩh2,رʱֻЭhttp/1.1;Эh2Ŀͻǰ,HttpServerʶ
+	void setHttp2(bool enabled) { http2_ = enabled; }
+
+	//ӹһacceptķsocket,ʼ
+	void start(int fd, const struct sockaddr_in& addr);
+
+	//fdеӻû̬мʱ¼true
+	bool handleEvent(int fd);
+
+	//ֵ(меѼHttpServerӱ)
+	size_t handshaking() const { return handshaking_; }
+
+	//readֻж˷ͷжȡ:ʱ-1errnoΪEAGAIN,Զ˹رշ0
+	static ssize_t read(SSL* ssl, char* buf, size_t len);
+
+	std::string statsJson();
+
+private:
+	struct Session
+	{
+		int tcpFd = -1;
+		int plainFd = -1;		//socketpairм̳еһ,ڼΪ-1
+		SSL* ssl = nullptr;
+		struct sockaddr_in addr = {};
+		std::string toPlain;	//ѽܡûдsocketpair
+		std::string toTls;		//ܷ͵,SSL_writeʱ뱣ֲ
+		bool handshaking = true;
+		bool tlsEof = false;
+		bool plainEof = false;
+		bool plainShut = false;
+	};
+
+	void handshake(Session* s);
+	void finishHandshake(Session* s);
+	//֮,ֱ
+	void pump(Session* s);
+	void destroy(Session* s);
+	bool watch(int fd);
+	static int selectAlpn(SSL* ssl, const unsigned char** out, unsigned char* outLen,
+		const unsigned char* in, unsigned int inLen, void* arg);
+
+	SSL_CTX* ctx_;
+	int epollFd_;
+	ReadyCallback ready_;
+	std::map<int, Session*> sessions_;	//tcpFdplainFdָͬһỰ
+	std::vector<char> buf_;
+	size_t handshaking_;
+	bool http2_;
+
+	std::atomic<long> handshakes_{ 0 };
+	std::atomic<long> handshakeFailures_{ 0 };
+	std::atomic<long> ktlsFull_{ 0 };		//շں˴
+	std::atomic<long> ktlsSend_{ 0 };		//ֻзں˴
+	std::atomic<long> userspace_{ 0 };		//û̬м
+	std::atomic<long> relayed_{ 0 };		//мֽ̼ܵ
+
+	static const size_t RELAY_CHUNK = 16384;	//һTLS¼ĳ
+};
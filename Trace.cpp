@@ -0,0 +1,258 @@
+#include "Trace.h"
+#include <vector>
+#include <algorithm>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <string.h>
+#include <stdio.h>
+
+std::atomic<int> Tracer::sampleRate_{ 0 };
+std::atomic<bool> Tracer::timeAll_{ false };
+std::atomic<bool> Tracer::timing_{ false };
+std::atomic<uint64_t> Tracer::requests_{ 0 };
+std::atomic<uint32_t> Tracer::reactorTid_{ 0 };
+
+//дߵĻλ:ддλٷhead,߰headжЩλѱ
+struct Tracer::Ring
+{
+	Event events[RING_SIZE];
+	std::atomic<uint64_t> head{ 0 };
+	std::atomic<bool> inUse{ true };
+};
+
+//̵߳Ļ,߳˳󻺳̸߳,¼Ϊֹ
+static pthread_mutex_t ringsMutex = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<Tracer::Ring*>& rings()
+{
+	static std::vector<Tracer::Ring*> all;
+	return all;
+}
+
+namespace
+{
+	struct RingHolder
+	{
+		Tracer::Ring* ring = nullptr;
+		~RingHolder();
+	};
+}
+
+RingHolder::~RingHolder()
+{
+	if (ring != nullptr)ring->inUse.store(false, std::memory_order_release);
+}
+
+static thread_local RingHolder localHolder;
+
+void Tracer::setSampleRate(int oneInN)
+{
+	sampleRate_.store(oneInN > 0 ? oneInN : 0, std::memory_order_relaxed);
+	updateTiming();
+}
+
+void Tracer::setTimeAll(bool on)
+{
+	timeAll_.store(on, std::memory_order_relaxed);
+	updateTiming();
+}
+
+void Tracer::updateTiming()
+{
+	timing_.store(timeAll_.load(std::memory_order_relaxed) || sampleRate_.load(std::memory_order_relaxed) != 0,
+		std::memory_order_relaxed);
+}
+
+void Tracer::sample(RequestTrace& trace)
+{
+	if (!timing())return;
+	trace.timed = true;
+	trace.readTid = threadId();
+	trace.parsed = nowNs();
+
+	int rate = sampleRate_.load(std::memory_order_relaxed);
+	if (rate == 0)return;
+	//ֻreactorе,ûо
+	uint64_t n = requests_.fetch_add(1, std::memory_order_relaxed) + 1;
+	if (n % static_cast<uint64_t>(rate) == 0)trace.id = n;
+}
+
+uint32_t Tracer::threadId()
+{
+	static thread_local uint32_t tid = static_cast<uint32_t>(syscall(SYS_gettid));
+	return tid;
+}
+
+void Tracer::setReactorThread()
+{
+	reactorTid_.store(threadId(), std::memory_order_relaxed);
+}
+
+Tracer::Ring* Tracer::localRing()
+{
+	if (localHolder.ring != nullptr)return localHolder.ring;
+	pthread_mutex_lock(&ringsMutex);
+	Ring* ring = nullptr;
+	for (Ring* r : rings())
+	{
+		bool idle = false;
+		if (r->inUse.compare_exchange_strong(idle, true))
+		{
+			ring = r;
+			break;
+		}
+	}
+	if (ring == nullptr)
+	{
+		ring = new Ring();
+		rings().push_back(ring);
+	}
+	pthread_mutex_unlock(&ringsMutex);
+	localHolder.ring = ring;
+	return ring;
+}
+
+void Tracer::record(Ring* ring, const char* name, uint64_t start, uint64_t end, uint64_t requestId,
+	uint32_t tid, bool async, const std::string* detail)
+{
+	//׶εյûм¼(Ŷӳʱ)ʱ
+	if (start == 0 || end < start)return;
+	uint64_t h = ring->head.load(std::memory_order_relaxed);
+	Event& e = ring->events[h % RING_SIZE];
+	e.name = name;
+	e.start = start;
+	e.dur = end - start;
+	e.requestId = requestId;
+	e.tid = tid;
+	e.async = async;
+	e.detail[0] = '\0';
+	if (detail != nullptr)
+	{
+		size_t n = std::min(detail->size(), sizeof(e.detail) - 1);
+		memcpy(e.detail, detail->data(), n);
+		e.detail[n] = '\0';
+	}
+	ring->head.store(h + 1, std::memory_order_release);
+}
+
+void Tracer::recordRequest(const RequestTrace& trace, const std::string& name, uint64_t end)
+{
+	Ring* ring = localRing();
+	uint32_t worker = trace.workerTid != 0 ? trace.workerTid : trace.readTid;
+	uint64_t id = trace.id;
+	uint64_t handlerEnd = trace.sendStart != 0 ? trace.sendStart : trace.lastByte;
+
+	//Ӿʼ,ȴĽ׶Ϊʾ
+	uint64_t begin = trace.accept != 0 ? trace.accept : (trace.firstByte != 0 ? trace.firstByte : trace.parsed);
+	record(ring, "request", begin, end, id, trace.readTid, true, &name);
+	record(ring, "wait_request", trace.accept, trace.firstByte, id, trace.readTid, true);
+	record(ring, "read_parse", trace.firstByte, trace.parsed, id, trace.readTid, false);
+	record(ring, "queue_wait", trace.enqueue, trace.dequeue, id, worker, true);
+	record(ring, "dispatch", trace.dequeue, trace.handlerStart, id, worker, false);
+	record(ring, "handler", trace.handlerStart, handlerEnd, id, worker, false);
+	if (trace.sendStart != 0)record(ring, "send", trace.sendStart, trace.lastByte, id, worker, false);
+	record(ring, "rearm", trace.lastByte, end, id, worker, false);
+}
+
+//JSONַת,URLпźͿַ
+static void appendEscaped(std::string& out, const char* s)
+{
+	for (; *s != '\0'; s++)
+	{
+		unsigned char c = static_cast<unsigned char>(*s);
+		if (c == '"' || c == '\\')
+		{
+			out += '\\';
+			out += static_cast<char>(c);
+		}
+		else if (c < 0x20)
+		{
+			char buf[8];
+			snprintf(buf, sizeof(buf), "\\u%04x", c);
+			out += buf;
+		}
+		else
+		{
+			out += static_cast<char>(c);
+		}
+	}
+}
+
+std::string Tracer::chromeJson()
+{
+	std::vector<Event> events;
+	pthread_mutex_lock(&ringsMutex);
+	std::vector<Ring*> all = rings();
+	pthread_mutex_unlock(&ringsMutex);
+	for (Ring* ring : all)
+	{
+		uint64_t head = ring->head.load(std::memory_order_acquire);
+		uint64_t from = head > RING_SIZE ? head - RING_SIZE : 0;
+		size_t first = events.size();
+		for (uint64_t i = from; i < head; i++)
+		{
+			events.push_back(ring->events[i % RING_SIZE]);
+		}
+		//ڼд߿ѾɵĲλ,дһλҲ
+		uint64_t after = ring->head.load(std::memory_order_acquire);
+		uint64_t valid = after + 1 > RING_SIZE ? after + 1 - RING_SIZE : 0;
+		if (valid > from)
+		{
+			size_t drop = static_cast<size_t>(std::min(valid - from, head - from));
+			events.erase(events.begin() + first, events.begin() + first + drop);
+		}
+	}
+
+	int pid = static_cast<int>(getpid());
+	uint32_t reactor = reactorTid_.load(std::memory_order_relaxed);
+	std::vector<uint32_t> tids;
+	std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	char buf[256];
+	bool firstEvent = true;
+	for (const Event& e : events)
+	{
+		if (std::find(tids.begin(), tids.end(), e.tid) == tids.end())tids.push_back(e.tid);
+		if (!firstEvent)json += ",";
+		firstEvent = false;
+
+		//ʱ䵥λΪ΢
+		double ts = e.start / 1000.0;
+		if (e.async)
+		{
+			//첽ÿʼͽ¼,Ź
+			snprintf(buf, sizeof(buf),
+				"{\"name\":\"%s\",\"cat\":\"http\",\"ph\":\"b\",\"id\":%llu,\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"args\":{\"request\":%llu",
+				e.name, static_cast<unsigned long long>(e.requestId), pid, e.tid, ts, static_cast<unsigned long long>(e.requestId));
+			json += buf;
+			if (e.detail[0] != '\0')
+			{
+				json += ",\"detail\":\"";
+				appendEscaped(json, e.detail);
+				json += "\"";
+			}
+			snprintf(buf, sizeof(buf),
+				"}},{\"name\":\"%s\",\"cat\":\"http\",\"ph\":\"e\",\"id\":%llu,\"pid\":%d,\"tid\":%u,\"ts\":%.3f}",
+				e.name, static_cast<unsigned long long>(e.requestId), pid, e.tid, (e.start + e.dur) / 1000.0);
+			json += buf;
+		}
+		else
+		{
+			snprintf(buf, sizeof(buf),
+				"{\"name\":\"%s\",\"cat\":\"http\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"request\":%llu}}",
+				e.name, pid, e.tid, ts, e.dur / 1000.0, static_cast<unsigned long long>(e.requestId));
+			json += buf;
+		}
+	}
+
+	//߳,Perfettoʾʱ
+	for (uint32_t tid : tids)
+	{
+		if (!firstEvent)json += ",";
+		firstEvent = false;
+		snprintf(buf, sizeof(buf), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+			pid, tid, tid == reactor ? "reactor" : "worker");
+		json += buf;
+	}
+	json += "]}";
+	return json;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <string>
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+
+//һ׶εʱ(,CLOCK_MONOTONIC),Connection,0ʾý׶ûз
+struct RequestTrace
+{
+	bool timed = false;			//׷ٻ־ʱÿ󶼼¼ʱ
+	uint64_t id = 0;			//,0ʾд׷ٻ
+	uint32_t readTid = 0;		//ȡͽ߳(reactor)
+	uint32_t workerTid = 0;		//ִĹ߳,ʱreactor¼
+	uint64_t accept = 0;		//ӽ,keep-aliveʱΪһ
+	uint64_t firstByte = 0;
+	uint64_t parsed = 0;
+	uint64_t enqueue = 0;
+	uint64_t dequeue = 0;
+	uint64_t handlerStart = 0;
+	uint64_t sendStart = 0;		//ʼдӦ(̬ļĿ¼),ûеķͽ׶
+	uint64_t lastByte = 0;
+	int queueDepth = -1;		//Ӻ̳߳ضеĳ
+
+	//ӦϢ,־ʹ
+	int64_t bytesOut = 0;
+	const char* source = "";	//filedirrouteproxyerror
+	bool cached = false;		//ļԹmmap,Ŀ¼бDirCache
+};
+
+//·׷:ʼ¼ĸ׶,ΪChrome trace JSON,ֱPerfettoд
+//ÿ߳дԼĻλ,;ʱȡڼ䱻ǵļ¼
+class Tracer
+{
+public:
+	//ÿoneInNһ,0ʾر
+	static void setSampleRate(int oneInN);
+	//־Ҫÿʱ,ʹ׷ûп
+	static void setTimeAll(bool on);
+	static bool timing() { return timing_.load(std::memory_order_relaxed); }
+	//ʱ(reactor߳):Ҫ¼ʱʱtrace.timed,Ƿ
+	static void sample(RequestTrace& trace);
+
+	static uint64_t nowNs()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+	}
+	static uint32_t threadId();
+	//ʱ̱߳Ϊreactor
+	static void setReactorThread();
+
+	//(reactor¼ر֮)ʱ,Ѹ׶д뵱ǰ̵߳Ļ
+	static void recordRequest(const RequestTrace& trace, const std::string& name, uint64_t end);
+
+	static std::string chromeJson();
+
+	static const size_t RING_SIZE = 4096;		//ÿ̱߳¼
+
+	struct Ring;
+
+private:
+	struct Event
+	{
+		const char* name;
+		uint64_t start;
+		uint64_t dur;
+		uint64_t requestId;
+		uint32_t tid;
+		bool async;				//ȴĽ׶βռ߳,Ϊ첽
+		char detail[64];
+	};
+
+	static Ring* localRing();
+	static void record(Ring* ring, const char* name, uint64_t start, uint64_t end, uint64_t requestId,
+		uint32_t tid, bool async, const std::string* detail = nullptr);
+
+	static void updateTiming();
+
+	static std::atomic<int> sampleRate_;
+	static std::atomic<bool> timeAll_;
+	static std::atomic<bool> timing_;
+	static std::atomic<uint64_t> requests_;
+	static std::atomic<uint32_t> reactorTid_;
+};
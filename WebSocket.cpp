@@ -0,0 +1,515 @@
+#include "WebSocket.h"
+#include "TlsTerminator.h"
+#include <openssl/sha.h>
+#include <openssl/evp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//RFC 6455涨GUID,ƴSec-WebSocket-Key֮SHA-1
+static const char HANDSHAKE_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+//ر
+static const uint16_t CLOSE_NORMAL = 1000;
+static const uint16_t CLOSE_PROTOCOL_ERROR = 1002;
+static const uint16_t CLOSE_TOO_BIG = 1009;
+
+WebSocketSession::WebSocketSession(int fd, SSL* ssl, int epollFd, WebSocketHub& hub, std::string topic, MessageHandler onMessage)
+	: fd_(fd), ssl_(ssl), epollFd_(epollFd), hub_(hub), topic_(std::move(topic)), onMessage_(std::move(onMessage)),
+	messageOpcode_(0), outOffset_(0), queuedBytes_(0),
+	closing_(false), failed_(false), closed_(false), closeTaken_(false), armQueued_(false), hubIndex_(0)
+{
+	pthread_mutex_init(&mutex_, NULL);
+}
+
+WebSocketSession::~WebSocketSession()
+{
+	pthread_mutex_destroy(&mutex_);
+}
+
+std::string WebSocketSession::acceptKey(std::string_view key)
+{
+	std::string input(key);
+	input += HANDSHAKE_GUID;
+	unsigned char digest[SHA_DIGEST_LENGTH];
+	SHA1(reinterpret_cast<const unsigned char*>(input.data()), input.size(), digest);
+	//20ֽڵժҪΪ28ַ
+	unsigned char encoded[32];
+	int n = EVP_EncodeBlock(encoded, digest, SHA_DIGEST_LENGTH);
+	return std::string(reinterpret_cast<char*>(encoded), n);
+}
+
+WebSocketSession::Frame WebSocketSession::makeFrame(uint8_t opcode, std::string_view payload)
+{
+	//֡
+	auto frame = std::make_shared<std::string>();
+	size_t len = payload.size();
+	frame->reserve(len + 10);
+	frame->push_back(static_cast<char>(0x80 | opcode));
+	if (len < 126)
+	{
+		frame->push_back(static_cast<char>(len));
+	}
+	else if (len <= 0xffff)
+	{
+		frame->push_back(static_cast<char>(126));
+		frame->push_back(static_cast<char>(len >> 8));
+		frame->push_back(static_cast<char>(len));
+	}
+	else
+	{
+		frame->push_back(static_cast<char>(127));
+		for (int shift = 56; shift >= 0; shift -= 8)
+		{
+			frame->push_back(static_cast<char>(static_cast<uint64_t>(len) >> shift));
+		}
+	}
+	frame->append(payload.data(), payload.size());
+	return frame;
+}
+
+void WebSocketSession::unmask(char* p, size_t n, const uint8_t key[4])
+{
+	uint32_t k32;
+	memcpy(&k32, key, 4);
+	size_t i = 0;
+#if defined(__SSE2__)
+	//1684ı,ÿ㶼뵽ĵһֽ
+	__m128i mask = _mm_set1_epi32(static_cast<int>(k32));
+	for (; i + 16 <= n; i += 16)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), _mm_xor_si128(v, mask));
+	}
+#endif
+	uint64_t k64 = static_cast<uint64_t>(k32) | (static_cast<uint64_t>(k32) << 32);
+	for (; i + 8 <= n; i += 8)
+	{
+		uint64_t v;
+		memcpy(&v, p + i, 8);
+		v ^= k64;
+		memcpy(p + i, &v, 8);
+	}
+	for (; i < n; i++)
+	{
+		p[i] ^= key[i & 3];
+	}
+}
+
+void WebSocketSession::feed(const char* p, size_t n)
+{
+	in_.append(p, n);
+}
+
+bool WebSocketSession::serve()
+{
+	std::vector<std::pair<std::string, bool>> messages;
+	pthread_mutex_lock(&mutex_);
+	if (closed_)
+	{
+		pthread_mutex_unlock(&mutex_);
+		return false;
+	}
+	bool eof = !readInput();
+	if (!closing_ && !failed_)parseFrames(messages);
+	flushLocked();
+	bool done = eof || failed_ || (closing_ && out_.empty());
+	if (done)closed_ = true;
+	pthread_mutex_unlock(&mutex_);
+
+	if (done)
+	{
+		//ڳлỰʱ˶:߳ĶȴỰ
+		hub_.unsubscribe(this);
+		return false;
+	}
+
+	//ܵsendpublish,Ҫִ
+	if (onMessage_)
+	{
+		for (auto& msg : messages)
+		{
+			onMessage_(*this, msg.first, msg.second);
+		}
+	}
+	return true;
+}
+
+bool WebSocketSession::readInput()
+{
+	char buf[16384];
+	for (;;)
+	{
+		//ͻ˳Ͷȡʱ,Ϣ޴ͣ,parseFramesر
+		if (in_.size() > MAX_MESSAGE + 16)return true;
+		ssize_t n = ssl_ != nullptr ? TlsTerminator::read(ssl_, buf, sizeof(buf)) : recv(fd_, buf, sizeof(buf), 0);
+		if (n > 0)
+		{
+			in_.append(buf, n);
+			continue;
+		}
+		if (n == 0)return false;
+		if (errno == EINTR)continue;
+		if (errno == EAGAIN || errno == EWOULDBLOCK)return true;
+		return false;
+	}
+}
+
+bool WebSocketSession::parseFrames(std::vector<std::pair<std::string, bool>>& messages)
+{
+	size_t pos = 0;
+	while (!closing_)
+	{
+		const uint8_t* h = reinterpret_cast<const uint8_t*>(in_.data()) + pos;
+		size_t avail = in_.size() - pos;
+		if (avail < 2)break;
+		bool fin = (h[0] & 0x80) != 0;
+		uint8_t opcode = h[0] & 0x0f;
+		bool masked = (h[1] & 0x80) != 0;
+		//ͻ˵֡,ûЭչʱRSVλΪ0
+		if (!masked || (h[0] & 0x70) != 0)
+		{
+			closeLocked(CLOSE_PROTOCOL_ERROR);
+			break;
+		}
+		uint64_t len = h[1] & 0x7f;
+		size_t headLen = 2;
+		if (len == 126)headLen += 2;
+		else if (len == 127)headLen += 8;
+		headLen += 4;
+		if (avail < headLen)break;
+		if (len == 126)
+		{
+			len = (static_cast<uint64_t>(h[2]) << 8) | h[3];
+		}
+		else if (len == 127)
+		{
+			len = 0;
+			for (int i = 0; i < 8; i++)len = (len << 8) | h[2 + i];
+		}
+		bool control = (opcode & 0x8) != 0;
+		if (control && (len > 125 || !fin))
+		{
+			closeLocked(CLOSE_PROTOCOL_ERROR);
+			break;
+		}
+		if (len > MAX_MESSAGE || message_.size() + len > MAX_MESSAGE)
+		{
+			closeLocked(CLOSE_TOO_BIG);
+			break;
+		}
+		if (avail < headLen + len)break;
+
+		uint8_t key[4];
+		memcpy(key, h + headLen - 4, 4);
+		char* payload = &in_[pos + headLen];
+		unmask(payload, static_cast<size_t>(len), key);
+		std::string_view data(payload, static_cast<size_t>(len));
+		pos += headLen + static_cast<size_t>(len);
+
+		switch (opcode)
+		{
+		case OP_TEXT:
+		case OP_BINARY:
+			if (messageOpcode_ != 0)
+			{
+				closeLocked(CLOSE_PROTOCOL_ERROR);
+				break;
+			}
+			if (fin)
+			{
+				messages.emplace_back(std::string(data), opcode == OP_BINARY);
+			}
+			else
+			{
+				messageOpcode_ = opcode;
+				message_.assign(data.data(), data.size());
+			}
+			break;
+		case OP_CONTINUATION:
+			if (messageOpcode_ == 0)
+			{
+				closeLocked(CLOSE_PROTOCOL_ERROR);
+				break;
+			}
+			message_.append(data.data(), data.size());
+			if (fin)
+			{
+				messages.emplace_back(std::move(message_), messageOpcode_ == OP_BINARY);
+				message_.clear();
+				messageOpcode_ = 0;
+			}
+			break;
+		case OP_PING:
+			pushLocked(makeFrame(OP_PONG, data));
+			break;
+		case OP_PONG:
+			break;
+		case OP_CLOSE:
+		{
+			//ͶԷĹر,
+			uint16_t code = CLOSE_NORMAL;
+			if (data.size() >= 2)code = static_cast<uint16_t>((static_cast<uint8_t>(data[0]) << 8) | static_cast<uint8_t>(data[1]));
+			closeLocked(code);
+			break;
+		}
+		default:
+			closeLocked(CLOSE_PROTOCOL_ERROR);
+			break;
+		}
+	}
+	in_.erase(0, pos);
+	return !closing_;
+}
+
+void WebSocketSession::pushLocked(const Frame& frame)
+{
+	out_.push_back(frame);
+	queuedBytes_ += frame->size();
+}
+
+void WebSocketSession::closeLocked(uint16_t code)
+{
+	if (closing_)return;
+	char payload[2] = { static_cast<char>(code >> 8), static_cast<char>(code) };
+	pushLocked(makeFrame(OP_CLOSE, std::string_view(payload, 2)));
+	closing_ = true;
+}
+
+bool WebSocketSession::send(std::string_view message, bool binary)
+{
+	return enqueue(makeFrame(binary ? OP_BINARY : OP_TEXT, message));
+}
+
+bool WebSocketSession::enqueue(const Frame& frame)
+{
+	pthread_mutex_lock(&mutex_);
+	if (closed_ || closing_ || failed_)
+	{
+		pthread_mutex_unlock(&mutex_);
+		return false;
+	}
+	if (queuedBytes_ + frame->size() > MAX_QUEUE_BYTES)
+	{
+		//ٶ:Ŷ,ù߳̾
+		failed_ = true;
+		hub_.slowClosed_++;
+		requestArmLocked();
+		pthread_mutex_unlock(&mutex_);
+		return false;
+	}
+
+	bool wasEmpty = out_.empty();
+	pushLocked(frame);
+	//ԭΪʱ,ҪôѾڵEPOLLOUT,Ҫô߳̽ע,ֻŶ
+	if (wasEmpty)
+	{
+		flushLocked();
+		if (!out_.empty() || failed_)requestArmLocked();
+	}
+	pthread_mutex_unlock(&mutex_);
+	return true;
+}
+
+void WebSocketSession::flushLocked()
+{
+	while (!out_.empty() && !failed_)
+	{
+		//еĶ֡һwritev
+		struct iovec iov[MAX_IOV];
+		int count = 0;
+		for (auto it = out_.begin(); it != out_.end() && count < MAX_IOV; ++it, ++count)
+		{
+			size_t skip = count == 0 ? outOffset_ : 0;
+			iov[count].iov_base = const_cast<char*>((*it)->data()) + skip;
+			iov[count].iov_len = (*it)->size() - skip;
+		}
+		ssize_t n = writev(fd_, iov, count);
+		if (n < 0)
+		{
+			if (errno == EINTR)continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)failed_ = true;
+			return;
+		}
+
+		//Ѿ֡,֡ڴһ߷ͷ
+		size_t left = static_cast<size_t>(n);
+		while (left > 0)
+		{
+			size_t rest = out_.front()->size() - outOffset_;
+			if (left < rest)
+			{
+				outOffset_ += left;
+				break;
+			}
+			left -= rest;
+			queuedBytes_ -= out_.front()->size();
+			out_.pop_front();
+			outOffset_ = 0;
+		}
+	}
+}
+
+void WebSocketSession::arm()
+{
+	pthread_mutex_lock(&mutex_);
+	armQueued_ = false;
+	armLocked();
+	pthread_mutex_unlock(&mutex_);
+}
+
+void WebSocketSession::armLocked()
+{
+	//ӽsocketѱرղ,޸
+	if (closed_)return;
+	struct epoll_event ev = {};
+	ev.events = EPOLLIN | EPOLLET | EPOLLONESHOT;
+	if (!out_.empty())ev.events |= EPOLLOUT;
+	ev.data.fd = fd_;
+	epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd_, &ev);
+}
+
+void WebSocketSession::requestArmLocked()
+{
+	//ͬһỰֻһ;ڹ߳ʱreactor,armעд
+	if (armQueued_ || closed_)return;
+	armQueued_ = true;
+	hub_.requestArm(shared_from_this());
+}
+
+bool WebSocketSession::takeClose()
+{
+	pthread_mutex_lock(&mutex_);
+	bool first = closed_ && !closeTaken_;
+	if (first)closeTaken_ = true;
+	pthread_mutex_unlock(&mutex_);
+	return first;
+}
+
+bool WebSocketSession::failed()
+{
+	pthread_mutex_lock(&mutex_);
+	bool failed = failed_;
+	pthread_mutex_unlock(&mutex_);
+	return failed;
+}
+
+void WebSocketSession::abort()
+{
+	pthread_mutex_lock(&mutex_);
+	closed_ = true;
+	pthread_mutex_unlock(&mutex_);
+	hub_.unsubscribe(this);
+}
+
+WebSocketHub::WebSocketHub()
+	: subscribers_(0)
+{
+	pthread_rwlockattr_t attr;
+	pthread_rwlockattr_init(&attr);
+	pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+	pthread_rwlock_init(&lock_, &attr);
+	pthread_rwlockattr_destroy(&attr);
+	pthread_mutex_init(&armMutex_, NULL);
+}
+
+WebSocketHub::~WebSocketHub()
+{
+	pthread_mutex_destroy(&armMutex_);
+	pthread_rwlock_destroy(&lock_);
+}
+
+void WebSocketHub::requestArm(std::shared_ptr<WebSocketSession> session)
+{
+	pthread_mutex_lock(&armMutex_);
+	bool first = arms_.empty();
+	arms_.push_back(std::move(session));
+	pthread_mutex_unlock(&armMutex_);
+	//бԭΪʱreactorѾѹ
+	if (first && armNotify_)armNotify_();
+}
+
+void WebSocketHub::takeArmRequests(std::vector<std::shared_ptr<WebSocketSession>>& out)
+{
+	pthread_mutex_lock(&armMutex_);
+	out.swap(arms_);
+	pthread_mutex_unlock(&armMutex_);
+}
+
+void WebSocketHub::subscribe(const std::shared_ptr<WebSocketSession>& session)
+{
+	pthread_rwlock_wrlock(&lock_);
+	auto& subs = topics_[session->topic()];
+	session->hubIndex_ = subs.size();
+	subs.push_back(session);
+	subscribers_++;
+	pthread_rwlock_unlock(&lock_);
+}
+
+void WebSocketHub::unsubscribe(WebSocketSession* session)
+{
+	pthread_rwlock_wrlock(&lock_);
+	auto it = topics_.find(session->topic());
+	if (it != topics_.end())
+	{
+		//һɾ,ƶ
+		auto& subs = it->second;
+		size_t i = session->hubIndex_;
+		if (i < subs.size() && subs[i].get() == session)
+		{
+			if (i + 1 != subs.size())
+			{
+				subs[i] = std::move(subs.back());
+				subs[i]->hubIndex_ = i;
+			}
+			subs.pop_back();
+			subscribers_--;
+		}
+		if (subs.empty())topics_.erase(it);
+	}
+	pthread_rwlock_unlock(&lock_);
+}
+
+size_t WebSocketHub::publish(const std::string& topic, std::string_view message, bool binary)
+{
+	//ֻһ,жߵĶͬһ֡
+	WebSocketSession::Frame frame = WebSocketSession::makeFrame(
+		binary ? WebSocketSession::OP_BINARY : WebSocketSession::OP_TEXT, message);
+	size_t delivered = 0;
+	pthread_rwlock_rdlock(&lock_);
+	auto it = topics_.find(topic);
+	if (it != topics_.end())
+	{
+		for (auto& session : it->second)
+		{
+			if (session->enqueue(frame))delivered++;
+		}
+	}
+	pthread_rwlock_unlock(&lock_);
+	published_++;
+	delivered_ += delivered;
+	return delivered;
+}
+
+std::string WebSocketHub::statsJson()
+{
+	pthread_rwlock_rdlock(&lock_);
+	size_t topics = topics_.size();
+	size_t subscribers = subscribers_;
+	pthread_rwlock_unlock(&lock_);
+
+	std::string json = "{";
+	json += "\"topics\":" + std::to_string(topics) + ",";
+	json += "\"subscribers\":" + std::to_string(subscribers) + ",";
+	json += "\"published\":" + std::to_string(published_.load()) + ",";
+	json += "\"delivered\":" + std::to_string(delivered_.load()) + ",";
+	json += "\"slowClosed\":" + std::to_string(slowClosed_.load());
+	json += "}";
+	return json;
+}
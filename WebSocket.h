@@ -0,0 +1,154 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <deque>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <openssl/ssl.h>
+
+
+class WebSocketHub;
+
+//WebSocket(RFC 6455):֮ͻ˵֡ڹ߳д,
+//㲥Ϣɷߵֱ߳дsocket,дĲֵEPOLLOUTɹ̼߳;
+//epollֻreactorע,ֻѻỰreactor
+class WebSocketSession : public std::enable_shared_from_this<WebSocketSession>
+{
+public:
+	//õ֡,һι㲥ж߹ͬһ
+	using Frame = std::shared_ptr<const std::string>;
+	//ͻ˷Ϣ(Ƭƴ),ڹ߳е,пԵsendpublish
+	using MessageHandler = std::function<void(WebSocketSession& session, std::string_view message, bool binary)>;
+
+	enum Opcode : uint8_t
+	{
+		OP_CONTINUATION = 0x0,
+		OP_TEXT = 0x1,
+		OP_BINARY = 0x2,
+		OP_CLOSE = 0x8,
+		OP_PING = 0x9,
+		OP_PONG = 0xa
+	};
+
+	//sslǿʱȡҪOpenSSL(kTLSֻж˷ͷ)
+	WebSocketSession(int fd, SSL* ssl, int epollFd, WebSocketHub& hub, std::string topic, MessageHandler onMessage);
+	~WebSocketSession();
+
+	WebSocketSession(const WebSocketSession&) = delete;
+	WebSocketSession& operator=(const WebSocketSession&) = delete;
+
+	//֮Ѿ
+	void feed(const char* p, size_t n);
+
+	//EAGAIN,յ֡Ͷе;falseʾѽ
+	bool serve();
+	//עEPOLLONESHOT,д͵ʱͬʱעд;ֻreactorе
+	void arm();
+	//ӽֻеһε÷true,ɵ߹رsocket
+	bool takeClose();
+	//д߶,Ӧ
+	bool failed();
+	//Ŷӳʱֹͣʱֱӽ,֮Ĺ㲥дsocket
+	void abort();
+
+	//һϢ
+	bool send(std::string_view message, bool binary = false);
+	//֡뷢Ͷ,ԭΪʱԷ;ѽʱfalse
+	bool enqueue(const Frame& frame);
+
+	const std::string& topic() const { return topic_; }
+	int fd() const { return fd_; }
+
+	static Frame makeFrame(uint8_t opcode, std::string_view payload);
+	//ȥͻ֡,SSE2һδ16ֽ
+	static void unmask(char* p, size_t n, const uint8_t key[4]);
+
+	//:Sec-WebSocket-KeySec-WebSocket-Accept
+	static std::string acceptKey(std::string_view key);
+
+	static const size_t MAX_MESSAGE = 1024 * 1024;			//ͻϢ(Ƭ)
+	static const size_t MAX_QUEUE_BYTES = 4 * 1024 * 1024;	//Ͷгֵٶ߱Ͽ
+	static const int MAX_IOV = 64;
+
+private:
+	friend class WebSocketHub;
+
+	bool readInput();
+	bool parseFrames(std::vector<std::pair<std::string, bool>>& messages);
+	void pushLocked(const Frame& frame);
+	void closeLocked(uint16_t code);
+	void flushLocked();
+	void armLocked();
+	//Ҫעдڹ߳:reactorע
+	void requestArmLocked();
+
+	int fd_;
+	SSL* ssl_;
+	int epollFd_;
+	WebSocketHub& hub_;
+	std::string topic_;
+	MessageHandler onMessage_;
+
+	pthread_mutex_t mutex_;
+	std::string in_;
+	std::string message_;		//ƴӵķƬϢ
+	uint8_t messageOpcode_;		//0ʾûзƬеϢ
+
+	std::deque<Frame> out_;
+	size_t outOffset_;			//׵֡Ѿֽ
+	size_t queuedBytes_;
+	bool closing_;				//ѷر֡,
+	bool failed_;				//д,ٷ
+	bool closed_;				//ѽ,֮Ĺ㲥ֱ
+	bool closeTaken_;
+	bool armQueued_;			//Ѿhubеȴreactorע
+	size_t hubIndex_;			//ⶩеλ
+};
+
+//ķ/:һϢֻһ,֡üҵÿߵķͶ
+class WebSocketHub
+{
+public:
+	WebSocketHub();
+	~WebSocketHub();
+
+	WebSocketHub(const WebSocketHub&) = delete;
+	WebSocketHub& operator=(const WebSocketHub&) = delete;
+
+	void subscribe(const std::shared_ptr<WebSocketSession>& session);
+	void unsubscribe(WebSocketSession* session);
+
+	//ж߹㲥,ؽյĶ,߳е
+	size_t publish(const std::string& topic, std::string_view message, bool binary = false);
+
+	std::string statsJson();
+
+	//лỰȴעʱ,ڷߵִ߳,ֻ軽reactor
+	void setArmNotify(std::function<void()> notify) { armNotify_ = std::move(notify); }
+	//reactor:ȡȴעĻỰ
+	void takeArmRequests(std::vector<std::shared_ptr<WebSocketSession>>& out);
+
+private:
+	friend class WebSocketSession;
+
+	void requestArm(std::shared_ptr<WebSocketSession> session);
+
+	//ж,ĺ˶д;д,㲥ʱ˶Ҳ
+	pthread_rwlock_t lock_;
+	std::map<std::string, std::vector<std::shared_ptr<WebSocketSession>>> topics_;
+	size_t subscribers_;
+
+	pthread_mutex_t armMutex_;
+	std::vector<std::shared_ptr<WebSocketSession>> arms_;
+	std::function<void()> armNotify_;
+
+	std::atomic<long> published_{ 0 };
+	std::atomic<long> delivered_{ 0 };
+	std::atomic<long> slowClosed_{ 0 };		//ϿĶ
+};
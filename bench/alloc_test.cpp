@@ -0,0 +1,187 @@
+//:ͬһ,һkeep-aliveӷ,ͳÿoperator new
+//÷:./alloc_test [port],дstderr;һ·ʱ1
+#include "HttpServer.h"
+#include <iostream>
+#include <atomic>
+#include <new>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+//ͳ̵߳ķ,ԿͻֻջϵĻ,ͳƵĶǷķ
+static std::atomic<unsigned long> g_allocs(0);
+
+//滻new/delete:GCCnewʽfree,-Wmismatched-new-delete
+__attribute__((noinline)) void* operator new(std::size_t n)
+{
+	g_allocs.fetch_add(1, std::memory_order_relaxed);
+	void* p = std::malloc(n ? n : 1);
+	if (p == nullptr)throw std::bad_alloc();
+	return p;
+}
+__attribute__((noinline)) void* operator new[](std::size_t n)
+{
+	g_allocs.fetch_add(1, std::memory_order_relaxed);
+	void* p = std::malloc(n ? n : 1);
+	if (p == nullptr)throw std::bad_alloc();
+	return p;
+}
+__attribute__((noinline)) void* operator new(std::size_t n, const std::nothrow_t&) noexcept
+{
+	g_allocs.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(n ? n : 1);
+}
+__attribute__((noinline)) void* operator new[](std::size_t n, const std::nothrow_t&) noexcept
+{
+	g_allocs.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(n ? n : 1);
+}
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+static const int WARMUP = 2000;
+static const int REQUESTS = 20000;
+//̨߳(̳߳عߡ״̬)ż,ƽÿӦԶС1
+static const double MAX_ALLOCS_PER_REQUEST = 0.05;
+
+static void writeFile(const std::string& path, const char* data)
+{
+	int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1 || write(fd, data, strlen(data)) < 0)perror(path.c_str());
+	if (fd != -1)close(fd);
+}
+
+static int connectTo(unsigned short port)
+{
+	for (int i = 0; i < 100; i++)
+	{
+		int fd = socket(AF_INET, SOCK_STREAM, 0);
+		struct sockaddr_in addr = {};
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(port);
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0)
+		{
+			int one = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+			return fd;
+		}
+		close(fd);
+		usleep(50000);
+	}
+	return -1;
+}
+
+//һ󲢶Ӧ,Ӧ뱣;Ŀ¼һгʱǷֿ
+static bool roundTrip(int fd, const char* request, size_t requestLen, int expectStatus)
+{
+	if (send(fd, request, requestLen, MSG_NOSIGNAL) != static_cast<ssize_t>(requestLen))return false;
+	char buf[65536];
+	size_t have = 0;
+	for (;;)
+	{
+		ssize_t n = recv(fd, buf + have, sizeof(buf) - 1 - have, 0);
+		if (n <= 0)return false;
+		have += n;
+		buf[have] = '\0';
+		const char* end = strstr(buf, "\r\n\r\n");
+		if (end == nullptr)continue;
+		if (strcasestr(buf, "Connection:keep-alive") == nullptr)return false;
+		const char* cl = strcasestr(buf, "Content-Length:");
+		if (cl == nullptr || cl > end)
+		{
+			if (have < 5 || memcmp(buf + have - 5, "0\r\n\r\n", 5) != 0)continue;
+			return atoi(buf + 9) == expectStatus;
+		}
+		size_t total = (end + 4 - buf) + strtoul(cl + 15, nullptr, 10);
+		if (have < total)continue;
+		return have == total && atoi(buf + 9) == expectStatus;
+	}
+}
+
+static bool measure(unsigned short port, const char* path, int expectStatus, double& perRequest)
+{
+	char request[512];
+	int len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n", path);
+	int fd = connectTo(port);
+	if (fd == -1)return false;
+	bool ok = true;
+	for (int i = 0; ok && i < WARMUP; i++)ok = roundTrip(fd, request, len, expectStatus);
+	unsigned long before = g_allocs.load();
+	for (int i = 0; ok && i < REQUESTS; i++)ok = roundTrip(fd, request, len, expectStatus);
+	unsigned long after = g_allocs.load();
+	close(fd);
+	perRequest = static_cast<double>(after - before) / REQUESTS;
+	return ok;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned short port = static_cast<unsigned short>(argc > 1 ? atoi(argv[1]) : 18099);
+
+	//ʱԴĿ¼:Сļ·ϵļĿ¼
+	char dir[] = "/tmp/alloc_test.XXXXXX";
+	if (mkdtemp(dir) == nullptr)
+	{
+		perror("mkdtemp");
+		return 1;
+	}
+	std::string base = dir;
+	writeFile(base + "/a.txt", "abc");
+	std::string deep = base;
+	for (const char* part : { "/assets", "/javascripts", "/vendor", "/2024" })
+	{
+		deep += part;
+		mkdir(deep.c_str(), 0755);
+	}
+	writeFile(deep + "/application-bundle.min.js", "console.log(1);");
+
+	//־ǲԶ,ص׼
+	std::cout.setstate(std::ios::failbit);
+	HttpServer* server = new HttpServer(port, base);
+	std::thread([server]() { server->run(); }).detach();
+	//ʱһ,Ϊ0˵滻operator newûЧ,Խ
+	if (g_allocs.load() == 0)
+	{
+		fprintf(stderr, "operator new is not counted\n");
+		_exit(1);
+	}
+
+	struct Case
+	{
+		const char* path;
+		int status;
+	};
+	const Case cases[] = {
+		{ "/a.txt", 200 },
+		{ "/assets/javascripts/vendor/2024/application-bundle.min.js", 200 },
+		{ "/missing.txt", 404 },
+		{ "/assets/", 200 },
+	};
+
+	bool pass = true;
+	for (const Case& c : cases)
+	{
+		double perRequest = 0;
+		bool ok = measure(port, c.path, c.status, perRequest);
+		bool within = ok && perRequest <= MAX_ALLOCS_PER_REQUEST;
+		fprintf(stderr, "%-60s %s %.3f allocs/request\n", c.path, !ok ? "FAILED" : within ? "ok" : "OVER", perRequest);
+		pass = pass && within;
+	}
+	fprintf(stderr, "%s\n", pass ? "PASS" : "FAIL");
+
+	//̻߳,ֱ˳
+	std::string cleanup = "rm -rf " + base;
+	if (system(cleanup.c_str()) != 0)perror("rm");
+	_exit(pass ? 0 : 1);
+}
@@ -0,0 +1,140 @@
+//·ɲһ׼:עǧ̬ͨ·,ͳÿβҵĺʱoperator new
+//÷:./router_bench [·] [Ҵ],дstderr;ҽԻзʱ1
+#include "Router.h"
+#include <atomic>
+#include <new>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <time.h>
+
+static std::atomic<unsigned long> g_allocs(0);
+
+void* operator new(std::size_t n)
+{
+	g_allocs.fetch_add(1, std::memory_order_relaxed);
+	void* p = std::malloc(n ? n : 1);
+	if (p == nullptr)throw std::bad_alloc();
+	return p;
+}
+void* operator new[](std::size_t n)
+{
+	g_allocs.fetch_add(1, std::memory_order_relaxed);
+	void* p = std::malloc(n ? n : 1);
+	if (p == nullptr)throw std::bad_alloc();
+	return p;
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+static double nowNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+//ÿסԼı,ҽ
+class IdHandler : public HttpHandler
+{
+public:
+	explicit IdHandler(int id) : id(id) {}
+	void handle(const RequestView&, ResponseWriter&) override {}
+	int id;
+};
+
+struct Probe
+{
+	std::string method;
+	std::string path;
+	int expect;			//Ĵ,-1ʾ404,-2ʾ405
+};
+
+//ÿ4·:̬ͨ;·С404405
+static void buildRoutes(Router& router, int count, std::vector<Probe>& probes)
+{
+	int id = 0;
+	for (int svc = 0; id < count; svc++)
+	{
+		std::string base = "/api/v" + std::to_string(svc % 3 + 1) + "/svc" + std::to_string(svc);
+		const std::pair<unsigned, std::string> patterns[] = {
+			{ METHOD_GET, base + "/status" },
+			{ METHOD_GET | METHOD_PUT, base + "/items/:id" },
+			{ METHOD_GET, base + "/items/:id/tags/:tag" },
+			{ METHOD_GET, "/static/svc" + std::to_string(svc) + "/*" },
+		};
+		int first = id;
+		for (auto& p : patterns)
+		{
+			if (id >= count)break;
+			router.add(p.first, p.second, HandlerPtr(new IdHandler(id)));
+			id++;
+		}
+		//·4ıʱ,һ,
+		if (id - first < 4)break;
+		probes.push_back({ "GET", base + "/status", first });
+		probes.push_back({ "PUT", base + "/items/12345", first + 1 });
+		probes.push_back({ "GET", base + "/items/12345/tags/release-2024", first + 2 });
+		probes.push_back({ "GET", "/static/svc" + std::to_string(svc) + "/js/vendor/app.min.js", first + 3 });
+		probes.push_back({ "GET", base + "/missing", -1 });
+		probes.push_back({ "POST", base + "/status", -2 });
+	}
+}
+
+static bool check(const Router& router, const Probe& p)
+{
+	RouteMatch match;
+	HttpHandler* handler = nullptr;
+	Router::Result r = router.lookup(p.method, p.path, match, handler);
+	if (p.expect == -1)return r == Router::Result::NOT_FOUND;
+	if (p.expect == -2)return r == Router::Result::METHOD_NOT_ALLOWED;
+	return r == Router::Result::FOUND && static_cast<IdHandler*>(handler)->id == p.expect;
+}
+
+int main(int argc, char* argv[])
+{
+	int maxRoutes = argc > 1 ? atoi(argv[1]) : 5000;
+	long lookups = argc > 2 ? atol(argv[2]) : 5000000;
+
+	bool pass = true;
+	for (int count : { 40, 400, 4000, maxRoutes })
+	{
+		if (count > maxRoutes)continue;
+		Router router;
+		std::vector<Probe> probes;
+		buildRoutes(router, count, probes);
+
+		bool correct = true;
+		for (auto& p : probes)correct = correct && check(router, p);
+
+		//ʵĲʸ·,βҲͬһ
+		size_t n = probes.size();
+		size_t step = n % 7 != 0 ? 7 : 1;
+		size_t idx = 0;
+		volatile int sink = 0;
+		unsigned long before = g_allocs.load();
+		double start = nowNs();
+		for (long i = 0; i < lookups; i++)
+		{
+			const Probe& p = probes[idx];
+			idx += step;
+			if (idx >= n)idx -= n;
+			RouteMatch match;
+			HttpHandler* handler = nullptr;
+			sink += static_cast<int>(router.lookup(p.method, p.path, match, handler));
+		}
+		double ns = (nowNs() - start) / lookups;
+		unsigned long allocs = g_allocs.load() - before;
+
+		bool ok = correct && allocs == 0;
+		fprintf(stderr, "%5zu routes: %.0f ns/lookup, %lu allocations in %ld lookups %s\n",
+			router.size(), ns, allocs, lookups, !correct ? "WRONG" : ok ? "ok" : "ALLOCATES");
+		pass = pass && ok;
+		if (count == maxRoutes)break;
+	}
+	fprintf(stderr, "%s\n", pass ? "PASS" : "FAIL");
+	return pass ? 0 : 1;
+}
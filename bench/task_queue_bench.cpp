@@ -0,0 +1,169 @@
+//΢׼:ThreadPool::addTask͹̵߳Ĳύȡִ,ͳÿĺʱѷü
+//÷:./task_queue_bench [],߳,дstderr;зÿü1ʱ1
+#include "TaskQueue.h"
+#include <atomic>
+#include <new>
+#include <functional>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <time.h>
+
+static std::atomic<unsigned long> g_allocs(0);
+
+void* operator new(std::size_t n)
+{
+	g_allocs.fetch_add(1, std::memory_order_relaxed);
+	void* p = std::malloc(n ? n : 1);
+	if (p == nullptr)throw std::bad_alloc();
+	return p;
+}
+void* operator new[](std::size_t n)
+{
+	g_allocs.fetch_add(1, std::memory_order_relaxed);
+	void* p = std::malloc(n ? n : 1);
+	if (p == nullptr)throw std::bad_alloc();
+	return p;
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+//Connection:RefPtrֻҪaddRef/release,ü֮ͳƵô
+struct BenchConn
+{
+	mutable std::atomic<int> refs{ 0 };
+	mutable std::atomic<unsigned long> ops{ 0 };
+	unsigned long handled = 0;
+
+	void addRef() const
+	{
+		ops.fetch_add(1, std::memory_order_relaxed);
+		refs.fetch_add(1, std::memory_order_relaxed);
+	}
+	void release() const
+	{
+		ops.fetch_add(1, std::memory_order_relaxed);
+		if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)delete this;
+	}
+};
+
+static const int BATCH = 64;
+
+static double nowNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+struct Result
+{
+	double ns;
+	double allocs;
+	double refOps;
+};
+
+//slots൱ӱ:HttpServerһ,ύʱλеƽ,ɻصƻԭλ
+template<class MakeTask>
+static Result run(long tasks, MakeTask makeTask)
+{
+	TaskQueue<BenchConn> queue;
+	std::vector<RefPtr<BenchConn>> slots(BATCH);
+	for (auto& slot : slots)slot = RefPtr<BenchConn>(new BenchConn());
+	std::vector<BenchConn*> conns;
+	for (auto& slot : slots)conns.push_back(slot.get());
+	int next = 0;
+	std::function<void(RefPtr<BenchConn>)> taskCallback = [&](RefPtr<BenchConn> done) {
+		//reactor÷Żӱ¼
+		slots[next++ % BATCH] = std::move(done);
+		};
+
+	auto round = [&](long count) {
+		for (long i = 0; i < count; i += BATCH)
+		{
+			for (int j = 0; j < BATCH; j++)
+			{
+				queue.addTask(Task<BenchConn>(makeTask(), std::move(slots[j])), TaskPriority::NORMAL);
+			}
+			for (int j = 0; j < BATCH; j++)
+			{
+				Task<BenchConn> task = queue.takeTask();
+				if (task.function && task.arg)task.function(task.arg.get());
+				if (task.arg)taskCallback(std::move(task.arg));
+			}
+		}
+		};
+	auto ops = [&]() {
+		unsigned long n = 0;
+		for (BenchConn* c : conns)n += c->ops.load();
+		return n;
+		};
+
+	//һûζݵȶС
+	round(BATCH * 16);
+	unsigned long allocsBefore = g_allocs.load();
+	unsigned long opsBefore = ops();
+	double start = nowNs();
+	round(tasks);
+	double ns = nowNs() - start;
+	Result r;
+	r.ns = ns / tasks;
+	r.allocs = static_cast<double>(g_allocs.load() - allocsBefore) / tasks;
+	r.refOps = static_cast<double>(ops() - opsBefore) / tasks;
+	slots.clear();
+	return r;
+}
+
+int main(int argc, char* argv[])
+{
+	long tasks = argc > 1 ? atol(argv[1]) : 12800000;
+	tasks = (tasks + BATCH - 1) / BATCH * BATCH;
+
+	struct Capture32
+	{
+		void* server;
+		long long a, b, c;
+	};
+	static int serverTag;
+
+	bool pass = true;
+	for (int kind = 0; kind < 2; kind++)
+	{
+		//̲߳ܵӰ:ʱȡ5һ,üȡһ
+		Result best = { 1e18, 0, 0 };
+		for (int rep = 0; rep < 5; rep++)
+		{
+			Result r;
+			if (kind == 0)
+			{
+				void* self = &serverTag;
+				r = run(tasks, [self]() {
+					return TaskFunction([self](void* arg) {
+						static_cast<BenchConn*>(arg)->handled += self != nullptr;
+						});
+					});
+			}
+			else
+			{
+				Capture32 cap = { &serverTag, 1, 2, 3 };
+				r = run(tasks, [cap]() {
+					return TaskFunction([cap](void* arg) {
+						static_cast<BenchConn*>(arg)->handled += cap.a + cap.b + cap.c;
+						});
+					});
+			}
+			if (r.ns < best.ns)best.ns = r.ns;
+			best.allocs = std::max(best.allocs, r.allocs);
+			best.refOps = std::max(best.refOps, r.refOps);
+		}
+		bool ok = best.allocs == 0 && best.refOps <= 1;
+		fprintf(stderr, "%-20s %.0f ns/task  %.2f allocs/task  %.2f refcount ops/task %s\n",
+			kind == 0 ? "capture [this]" : "32-byte capture", best.ns, best.allocs, best.refOps, ok ? "ok" : "OVER");
+		pass = pass && ok;
+	}
+	fprintf(stderr, "%s\n", pass ? "PASS" : "FAIL");
+	return pass ? 0 : 1;
+}
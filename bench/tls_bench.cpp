@@ -0,0 +1,253 @@
+//HTTPS׼:ػÿɵ(ûỰ),ԼͬһļHTTPSHTTPص
+//÷:./tls_bench [] [ļMB] [port],дstderr;ֻʧʱ1
+//֤ΪʱɵǩRSA-2048֤,kTLSģʽ/admin/tls
+#include "HttpServer.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+static double nowSec()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool writeCert(const std::string& certPath, const std::string& keyPath)
+{
+	EVP_PKEY* key = EVP_RSA_gen(2048);
+	X509* cert = X509_new();
+	if (key == nullptr || cert == nullptr)return false;
+	ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+	X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+	X509_gmtime_adj(X509_getm_notAfter(cert), 86400);
+	X509_set_pubkey(cert, key);
+	X509_NAME* name = X509_get_subject_name(cert);
+	X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+	X509_set_issuer_name(cert, name);
+	bool ok = X509_sign(cert, key, EVP_sha256()) > 0;
+
+	FILE* f = fopen(certPath.c_str(), "w");
+	ok = ok && f != nullptr && PEM_write_X509(f, cert) == 1;
+	if (f != nullptr)fclose(f);
+	f = fopen(keyPath.c_str(), "w");
+	ok = ok && f != nullptr && PEM_write_PrivateKey(f, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+	if (f != nullptr)fclose(f);
+	X509_free(cert);
+	EVP_PKEY_free(key);
+	return ok;
+}
+
+static int connectTo(unsigned short port)
+{
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	return fd;
+}
+
+//һֺر,ÿζµSSL,ỰƱ
+static bool handshake(SSL_CTX* ctx, unsigned short port)
+{
+	int fd = connectTo(port);
+	if (fd == -1)return false;
+	SSL* ssl = SSL_new(ctx);
+	SSL_set_fd(ssl, fd);
+	bool ok = SSL_connect(ssl) == 1;
+	if (ok)SSL_shutdown(ssl);
+	SSL_free(ssl);
+	close(fd);
+	return ok;
+}
+
+//path,Ӧֽ;ctxΪʱ
+static long long download(SSL_CTX* ctx, unsigned short port, const char* path)
+{
+	int fd = connectTo(port);
+	if (fd == -1)return -1;
+	SSL* ssl = nullptr;
+	if (ctx != nullptr)
+	{
+		ssl = SSL_new(ctx);
+		SSL_set_fd(ssl, fd);
+		if (SSL_connect(ssl) != 1)
+		{
+			SSL_free(ssl);
+			close(fd);
+			return -1;
+		}
+	}
+	char request[256];
+	int len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n", path);
+	bool ok = ssl != nullptr ? SSL_write(ssl, request, len) == len : send(fd, request, len, MSG_NOSIGNAL) == len;
+
+	static char buf[256 * 1024];
+	long long total = 0;
+	bool headDone = false;
+	std::string head;
+	while (ok)
+	{
+		int n = ssl != nullptr ? SSL_read(ssl, buf, sizeof(buf)) : static_cast<int>(recv(fd, buf, sizeof(buf), 0));
+		if (n <= 0)break;
+		if (!headDone)
+		{
+			head.append(buf, n);
+			size_t end = head.find("\r\n\r\n");
+			if (end != std::string::npos)
+			{
+				if (head.compare(0, 12, "HTTP/1.1 200") != 0)ok = false;
+				headDone = true;
+				total = static_cast<long long>(head.size() - end - 4);
+			}
+			continue;
+		}
+		total += n;
+	}
+	if (ssl != nullptr)SSL_free(ssl);
+	close(fd);
+	return ok && headDone ? total : -1;
+}
+
+static std::string fetchPlain(unsigned short port, const char* path)
+{
+	int fd = connectTo(port);
+	if (fd == -1)return std::string();
+	char request[256];
+	int len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n", path);
+	std::string out;
+	if (send(fd, request, len, MSG_NOSIGNAL) == len)
+	{
+		char buf[4096];
+		ssize_t n;
+		while ((n = recv(fd, buf, sizeof(buf), 0)) > 0)out.append(buf, n);
+	}
+	close(fd);
+	size_t end = out.find("\r\n\r\n");
+	return end == std::string::npos ? std::string() : out.substr(end + 4);
+}
+
+int main(int argc, char* argv[])
+{
+	double seconds = argc > 1 ? atof(argv[1]) : 5;
+	long mb = argc > 2 ? atol(argv[2]) : 200;
+	unsigned short port = static_cast<unsigned short>(argc > 3 ? atoi(argv[3]) : 18095);
+	unsigned short tlsPort = port + 1;
+
+	char dir[] = "/tmp/tls_bench.XXXXXX";
+	if (mkdtemp(dir) == nullptr)
+	{
+		perror("mkdtemp");
+		return 1;
+	}
+	std::string base = dir;
+	if (!writeCert(base + "/cert.pem", base + "/key.pem"))
+	{
+		fprintf(stderr, "failed to create a certificate\n");
+		return 1;
+	}
+	std::ofstream(base + "/bench.conf") << "tls_port = " << tlsPort << "\ntls_cert = " << base << "/cert.pem\ntls_key = " << base << "/key.pem\n";
+	//Դļ֤֮Ŀ¼,֤鲻ᱻ̬ļ
+	std::string docroot = base + "/www";
+	mkdir(docroot.c_str(), 0755);
+	{
+		std::ofstream out(docroot + "/big.bin", std::ios::binary);
+		std::string block(1024 * 1024, 'b');
+		for (long i = 0; i < mb; i++)out.write(block.data(), block.size());
+	}
+
+	pid_t pid = fork();
+	if (pid == -1)
+	{
+		perror("fork");
+		return 1;
+	}
+	if (pid == 0)
+	{
+		std::cout.setstate(std::ios::failbit);
+		HttpServer server(port, docroot);
+		if (!server.loadConfig(base + "/bench.conf"))_exit(1);
+		server.run();
+		_exit(0);
+	}
+
+	SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+	SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+	bool ready = false;
+	for (int i = 0; i < 100 && !ready; i++)
+	{
+		ready = handshake(ctx, tlsPort);
+		if (!ready)usleep(50000);
+	}
+	bool pass = ready;
+
+	if (pass)
+	{
+		long count = 0;
+		long failed = 0;
+		double start = nowSec();
+		double elapsed = 0;
+		while ((elapsed = nowSec() - start) < seconds)
+		{
+			if (handshake(ctx, tlsPort))count++;
+			else failed++;
+		}
+		fprintf(stderr, "handshakes: %ld in %.2f s, %.0f/s, %ld failed (%s)\n",
+			count, elapsed, count / elapsed, failed, "RSA-2048, no resumption");
+		pass = failed == 0;
+	}
+
+	long long expect = mb * 1024 * 1024;
+	for (int tls = 1; pass && tls >= 0; tls--)
+	{
+		//һذļҳ,ȡڶεĽ
+		double elapsed = 0;
+		long long got = 0;
+		for (int round = 0; round < 2 && got >= 0; round++)
+		{
+			double start = nowSec();
+			got = download(tls ? ctx : nullptr, tls ? tlsPort : port, "/big.bin");
+			elapsed = nowSec() - start;
+		}
+		bool ok = got == expect;
+		fprintf(stderr, "%-5s download: %ld MB in %.2f s, %.0f MB/s %s\n",
+			tls ? "HTTPS" : "HTTP", mb, elapsed, got / elapsed / (1024 * 1024), ok ? "ok" : "FAILED");
+		pass = pass && ok;
+	}
+
+	std::string stats = fetchPlain(port, "/admin/tls");
+	fprintf(stderr, "/admin/tls: %s\n%s\n", stats.c_str(), pass ? "PASS" : "FAIL");
+
+	SSL_CTX_free(ctx);
+	kill(pid, SIGKILL);
+	waitpid(pid, nullptr, 0);
+	std::string cleanup = "rm -rf " + base;
+	if (system(cleanup.c_str()) != 0)perror("rm");
+	return pass ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+//ļϴڴռ:̽ն(splice)chunkedPUT,ϴڼÿ10msһηVmRSS
+//÷:./upload_rss [MB] [port],дstderr;RSS޻ļȲʱ1
+#include "HttpServer.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+
+//С޹,ֵRSSӦԶСϴĳ
+static const long MAX_RSS_GROWTH_KB = 32 * 1024;
+
+static double nowSec()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long rssKb(pid_t pid)
+{
+	char path[64];
+	snprintf(path, sizeof(path), "/proc/%d/status", static_cast<int>(pid));
+	FILE* f = fopen(path, "r");
+	if (f == nullptr)return -1;
+	char line[256];
+	long kb = -1;
+	while (fgets(line, sizeof(line), f) != nullptr)
+	{
+		if (strncmp(line, "VmRSS:", 6) == 0)
+		{
+			kb = atol(line + 6);
+			break;
+		}
+	}
+	fclose(f);
+	return kb;
+}
+
+static int connectTo(unsigned short port)
+{
+	for (int i = 0; i < 100; i++)
+	{
+		int fd = socket(AF_INET, SOCK_STREAM, 0);
+		struct sockaddr_in addr = {};
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(port);
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0)return fd;
+		close(fd);
+		usleep(50000);
+	}
+	return -1;
+}
+
+static bool sendAll(int fd, const char* p, size_t n)
+{
+	while (n > 0)
+	{
+		ssize_t r = send(fd, p, n, MSG_NOSIGNAL);
+		if (r <= 0)return false;
+		p += r;
+		n -= r;
+	}
+	return true;
+}
+
+//ϴbytesֽ,chunkedʱÿ64KB;ط״̬
+static int upload(unsigned short port, const char* path, size_t bytes, bool chunked)
+{
+	int fd = connectTo(port);
+	if (fd == -1)return -1;
+	char head[256];
+	int len = chunked ?
+		snprintf(head, sizeof(head), "PUT %s HTTP/1.1\r\nHost: localhost\r\nTransfer-Encoding: chunked\r\n\r\n", path) :
+		snprintf(head, sizeof(head), "PUT %s HTTP/1.1\r\nHost: localhost\r\nContent-Length: %zu\r\n\r\n", path, bytes);
+	bool ok = sendAll(fd, head, len);
+
+	static char block[65536];
+	memset(block, 'u', sizeof(block));
+	size_t sent = 0;
+	while (ok && sent < bytes)
+	{
+		size_t n = std::min(sizeof(block), bytes - sent);
+		if (chunked)
+		{
+			char size[32];
+			int sl = snprintf(size, sizeof(size), "%zx\r\n", n);
+			ok = sendAll(fd, size, sl) && sendAll(fd, block, n) && sendAll(fd, "\r\n", 2);
+		}
+		else
+		{
+			ok = sendAll(fd, block, n);
+		}
+		sent += n;
+	}
+	if (ok && chunked)ok = sendAll(fd, "0\r\n\r\n", 5);
+
+	char resp[512];
+	ssize_t n = ok ? recv(fd, resp, sizeof(resp) - 1, 0) : -1;
+	close(fd);
+	if (n < 12)return -1;
+	resp[n] = '\0';
+	return atoi(resp + 9);
+}
+
+int main(int argc, char* argv[])
+{
+	size_t mb = static_cast<size_t>(argc > 1 ? atol(argv[1]) : 512);
+	unsigned short port = static_cast<unsigned short>(argc > 2 ? atoi(argv[2]) : 18097);
+
+	char dir[] = "/tmp/upload_rss.XXXXXX";
+	if (mkdtemp(dir) == nullptr)
+	{
+		perror("mkdtemp");
+		return 1;
+	}
+	std::string base = dir;
+
+	//ӽ,RSSֻԼ
+	pid_t pid = fork();
+	if (pid == -1)
+	{
+		perror("fork");
+		return 1;
+	}
+	if (pid == 0)
+	{
+		std::cout.setstate(std::ios::failbit);
+		HttpServer server(port, base);
+		server.setUploadDir(base);
+		server.run();
+		_exit(0);
+	}
+
+	//һС,̳߳غͻȶ״̬ȡ
+	bool pass = upload(port, "/warmup.bin", 4 * 1024 * 1024, false) == 201 && upload(port, "/warmup.bin", 4 * 1024 * 1024, true) == 201;
+	if (!pass)fprintf(stderr, "warm-up upload failed\n");
+
+	struct Case
+	{
+		const char* name;
+		const char* path;
+		bool chunked;
+	};
+	const Case cases[] = {
+		{ "content-length (splice)", "/fixed.bin", false },
+		{ "chunked", "/chunked.bin", true },
+	};
+	size_t bytes = mb * 1024 * 1024;
+	for (const Case& c : cases)
+	{
+		if (!pass)break;
+		long baseline = rssKb(pid);
+		std::atomic<long> peak(baseline);
+		std::atomic<bool> done(false);
+		std::thread sampler([&]() {
+			while (!done.load())
+			{
+				long kb = rssKb(pid);
+				if (kb > peak.load())peak.store(kb);
+				usleep(10000);
+			}
+			});
+		double start = nowSec();
+		int status = upload(port, c.path, bytes, c.chunked);
+		double elapsed = nowSec() - start;
+		done = true;
+		sampler.join();
+
+		struct stat st;
+		std::string file = base + c.path;
+		bool complete = status == 201 && stat(file.c_str(), &st) == 0 && static_cast<size_t>(st.st_size) == bytes;
+		long growth = peak.load() - baseline;
+		bool ok = complete && growth <= MAX_RSS_GROWTH_KB;
+		fprintf(stderr, "%-24s %zu MB in %.2f s (%.0f MB/s), status %d, RSS baseline %ld KB, peak %ld KB (+%ld KB) %s\n",
+			c.name, mb, elapsed, mb / elapsed, status, baseline, peak.load(), growth, ok ? "ok" : complete ? "OVER" : "FAILED");
+		unlink(file.c_str());
+		pass = pass && ok;
+	}
+	fprintf(stderr, "%s\n", pass ? "PASS" : "FAIL");
+
+	kill(pid, SIGKILL);
+	waitpid(pid, nullptr, 0);
+	std::string cleanup = "rm -rf " + base;
+	if (system(cleanup.c_str()) != 0)perror("rm");
+	return pass ? 0 : 1;
+}
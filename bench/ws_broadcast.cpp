@@ -0,0 +1,240 @@
+//WebSocket㲥׼:N,ڵpublish()MϢ,ͳÿ뷢ʹϢ
+//÷:./ws_broadcast [] [Ϣ] [Ϣֽ] [port],дstderr;Ϣûʹʱ1
+//Ϳͻ˷ֳ,Եļ
+#include "HttpServer.h"
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+static double nowSec()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool readAll(int fd, char* p, size_t n)
+{
+	while (n > 0)
+	{
+		ssize_t r = read(fd, p, n);
+		if (r <= 0)return false;
+		p += r;
+		n -= r;
+	}
+	return true;
+}
+
+//:յ(ϢϢ)ڽڵpublish,Ӧô÷һ
+static void runServer(unsigned short port, int cmdFd)
+{
+	std::cout.setstate(std::ios::failbit);
+	HttpServer* server = new HttpServer(port, "/tmp");
+	server->setAdmissionLimits(0, 0, 0);
+	server->websocket("/ws/");
+	std::thread([server, cmdFd]() {
+		int cmd[2];
+		while (readAll(cmdFd, reinterpret_cast<char*>(cmd), sizeof(cmd)))
+		{
+			std::string message(cmd[1], 'x');
+			for (int i = 0; i < cmd[0]; i++)server->publish("bench", message);
+		}
+		//ͻ˽Ѿ˳
+		_exit(0);
+		}).detach();
+	server->run();
+	_exit(0);
+}
+
+static int subscribe(unsigned short port)
+{
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	static const char request[] = "GET /ws/bench HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+		"Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+	if (send(fd, request, sizeof(request) - 1, MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(request) - 1))
+	{
+		close(fd);
+		return -1;
+	}
+	//ֽڶͷ,֮ݶ֡
+	char head[512];
+	size_t have = 0;
+	while (have < sizeof(head) - 1)
+	{
+		if (recv(fd, head + have, 1, 0) != 1)break;
+		have++;
+		if (have >= 4 && memcmp(head + have - 4, "\r\n\r\n", 4) == 0)break;
+	}
+	head[have] = '\0';
+	if (strncmp(head, "HTTP/1.1 101", 12) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	return fd;
+}
+
+//ڷ101֮ŰӼ,ǰͨ/admin/websocketȷ϶ĶЧ
+static long subscriberCount(unsigned short port)
+{
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	static const char request[] = "GET /admin/websocket HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+	char buf[4096];
+	size_t have = 0;
+	if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0 &&
+		send(fd, request, sizeof(request) - 1, MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(request) - 1))
+	{
+		ssize_t n;
+		while (have < sizeof(buf) - 1 && (n = recv(fd, buf + have, sizeof(buf) - 1 - have, 0)) > 0)have += n;
+	}
+	close(fd);
+	buf[have] = '\0';
+	const char* p = strstr(buf, "\"subscribers\":");
+	return p == nullptr ? -1 : atol(p + 14);
+}
+
+int main(int argc, char* argv[])
+{
+	int subscribers = argc > 1 ? atoi(argv[1]) : 10000;
+	int messages = argc > 2 ? atoi(argv[2]) : 100;
+	int payload = argc > 3 ? atoi(argv[3]) : 64;
+	unsigned short port = static_cast<unsigned short>(argc > 4 ? atoi(argv[4]) : 18098);
+	//ֻͳֽ,֡û,ͷΪ2ֽ,12665535ֽڵϢΪ4ֽ
+	if (payload < 0 || payload > 65535)
+	{
+		fprintf(stderr, "payload must be 0..65535 bytes\n");
+		return 1;
+	}
+
+	struct rlimit rl;
+	getrlimit(RLIMIT_NOFILE, &rl);
+	rl.rlim_cur = rl.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &rl);
+	if (static_cast<rlim_t>(subscribers) + 64 > rl.rlim_cur)
+	{
+		fprintf(stderr, "RLIMIT_NOFILE %lu is too small for %d subscribers\n", static_cast<unsigned long>(rl.rlim_cur), subscribers);
+		return 1;
+	}
+
+	int cmd[2];
+	if (pipe(cmd) == -1)
+	{
+		perror("pipe");
+		return 1;
+	}
+	pid_t pid = fork();
+	if (pid == -1)
+	{
+		perror("fork");
+		return 1;
+	}
+	if (pid == 0)
+	{
+		close(cmd[1]);
+		runServer(port, cmd[0]);
+	}
+	close(cmd[0]);
+
+	//ȷʼν
+	int epfd = epoll_create1(0);
+	std::vector<size_t> received;
+	double t0 = nowSec();
+	for (int i = 0; i < subscribers; i++)
+	{
+		int fd = subscribe(port);
+		for (int retry = 0; fd == -1 && i == 0 && retry < 100; retry++)
+		{
+			usleep(50000);
+			fd = subscribe(port);
+		}
+		if (fd == -1)
+		{
+			fprintf(stderr, "subscriber %d failed to connect\n", i);
+			kill(pid, SIGKILL);
+			return 1;
+		}
+		if (received.size() <= static_cast<size_t>(fd))received.resize(fd + 1, 0);
+		struct epoll_event ev = {};
+		ev.events = EPOLLIN;
+		ev.data.fd = fd;
+		epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+	}
+	fprintf(stderr, "%d subscribers connected in %.2f s\n", subscribers, nowSec() - t0);
+
+	for (int i = 0; i < 100 && subscriberCount(port) < subscribers; i++)usleep(10000);
+
+	size_t frameLen = (payload < 126 ? 2 : 4) + payload;
+	size_t expect = static_cast<size_t>(subscribers) * messages * frameLen;
+	size_t total = 0;
+	int order[2] = { messages, payload };
+	double start = nowSec();
+	if (write(cmd[1], order, sizeof(order)) != static_cast<ssize_t>(sizeof(order)))perror("write");
+
+	std::vector<struct epoll_event> events(1024);
+	char buf[65536];
+	double lastProgress = start;
+	while (total < expect && nowSec() - lastProgress < 10)
+	{
+		int n = epoll_wait(epfd, events.data(), static_cast<int>(events.size()), 100);
+		for (int i = 0; i < n; i++)
+		{
+			int fd = events[i].data.fd;
+			ssize_t r;
+			while ((r = recv(fd, buf, sizeof(buf), 0)) > 0)
+			{
+				received[fd] += r;
+				total += r;
+			}
+			if (r == 0)
+			{
+				//Ͽ(緢Ͷг)
+				epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+			}
+		}
+		if (n > 0)lastProgress = nowSec();
+	}
+	double elapsed = nowSec() - start;
+
+	size_t delivered = total / frameLen;
+	size_t complete = 0;
+	for (size_t bytes : received)
+	{
+		if (bytes == static_cast<size_t>(messages) * frameLen)complete++;
+	}
+	fprintf(stderr, "%d messages x %d subscribers, %d bytes each: %zu delivered in %.3f s\n",
+		messages, subscribers, payload, delivered, elapsed);
+	fprintf(stderr, "%.1f messages/s published, %.0f deliveries/s, %.1f MB/s\n",
+		messages / elapsed, delivered / elapsed, total / elapsed / 1e6);
+	fprintf(stderr, "%zu/%d subscribers received every message\n", complete, subscribers);
+
+	kill(pid, SIGKILL);
+	waitpid(pid, nullptr, 0);
+	return total == expect ? 0 : 1;
+}
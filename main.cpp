@@ -9,7 +9,7 @@ int main(int argc,char* argv[]) //两个命令行参数，一个是服务器的
 
 	if (argc < 3)
 	{
-		std::cout<<"./a.out port path\n"<<endl;
+		std::cout<<"./a.out port path [uploadDir]\n"<<endl;
 		return -1;
 	}	
 	unsigned short port = static_cast<unsigned short>(atoi(argv[1])); //获取端口号（把port转换成无符号短整型)
@@ -21,6 +21,29 @@ int main(int argc,char* argv[]) //两个命令行参数，一个是服务器的
 	//可选：设置线程池大小
 	//server.setThreadPoolSize(4,16);
 
+	//可选：第三个参数为PUT上传目录
+	if (argc >= 4)
+	{
+		server.setUploadDir(argv[3]);
+	}
+
+	//可选：设置环境变量HTTP_SERVER_CONFIG指定配置文件,kill -HUP可重新加载
+	const char* configPath = getenv("HTTP_SERVER_CONFIG");
+	if (configPath != NULL && configPath[0] != '\0')
+	{
+		server.loadConfig(configPath);
+	}
+
+	//可选：设置环境变量HTTP_HOT_RESTART_SOCKET开启热重启,新进程会从旧进程接管监听socket
+	const char* hotRestartPath = getenv("HTTP_HOT_RESTART_SOCKET");
+	if (hotRestartPath != NULL && hotRestartPath[0] != '\0')
+	{
+		server.enableHotRestart(hotRestartPath, 30000);
+	}
+
+	//可选：/ws/之后的路径作为主题订阅WebSocket广播,POST /admin/publish/主题 发布消息
+	server.websocket("/ws/");
+
 	//显示初始线程池状态
 	server.printThreadPoolStatus();
 